@@ -4,11 +4,15 @@
 #include "Components/SMEquippableInventoryComponent.h"
 
 #include "AbilitySystemGlobals.h"
+#include "Algo/BinarySearch.h"
 #include "GAS/SMAbilitySystemComponent.h"
+#include "GAS/SMGameplayTags.h"
 #include "Interfaces/SMFirstPersonInterface.h"
 #include "Items/SMEquippableBase.h"
 #include "Net/UnrealNetwork.h"
 #include "SpawnMaster/SpawnMaster.h"
+#include "Subsystems/SMEquippablePoolSubsystem.h"
+#include "Subsystems/SMPickupSubsystem.h"
 
 DECLARE_CYCLE_STAT(TEXT("GiveNewEquippable"), STAT_GiveNewEquippable, STATGROUP_SpawnMaster);
 
@@ -25,6 +29,8 @@ USMEquippableInventoryComponent::USMEquippableInventoryComponent()
 {
 	SetIsReplicatedByDefault(true);
 
+	InventoryEntries.OwnerComponent = this;
+
 	PrimaryComponentTick.bCanEverTick = true;
 	PrimaryComponentTick.bStartWithTickEnabled = true;
 }
@@ -42,6 +48,30 @@ void USMEquippableInventoryComponent::OnRegister()
 	CachedOwnerNetMode = GetNetMode();
 	
 	EquippableInventory = StartingSlots;
+	RebuildInventoryIndex();
+}
+
+void USMEquippableInventoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (bCachedHasAuthority)
+	{
+		if (USMPickupSubsystem* pickupSubsystem = USMPickupSubsystem::Get(GetWorld()))
+		{
+			pickupSubsystem->RegisterInventory(this);
+		}
+	}
+}
+
+void USMEquippableInventoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (USMPickupSubsystem* pickupSubsystem = USMPickupSubsystem::Get(GetWorld()))
+	{
+		pickupSubsystem->UnregisterInventory(this);
+	}
+	
+	Super::EndPlay(EndPlayReason);
 }
 
 void USMEquippableInventoryComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
@@ -105,7 +135,7 @@ void USMEquippableInventoryComponent::NextEquippable()
 {
 	DesiredEquippable.Reset();
 	
-	int32 nextSlotIdxToSearch = 0;
+	int32 cycleIdxToSearch = 0;
 
 	// Depending on if we're already unequippable an equippable, we would like to index our search based on the currently selected equippable on the players HUD.
 	ASMEquippableBase* desiredOrCurrentEquippable = DesiredEquippable.IsValid() ? DesiredEquippable.Get() : CurrentEquippable;
@@ -113,52 +143,33 @@ void USMEquippableInventoryComponent::NextEquippable()
 	// This part of the function checks to see if we have anything after desiredOrCurrentEquippable in it's current slot we can equip, so we can avoid searching through all other slots.
 	if (desiredOrCurrentEquippable)
 	{
-		FInventorySlot* equippableSlot = nullptr;
-		
-		equippableSlot = FindInventorySlotByTag(desiredOrCurrentEquippable->GetSlotTag());
-		check(equippableSlot)
+		const int32* slotIdx = InventoryIndex.SlotIndexByTag.Find(desiredOrCurrentEquippable->GetSlotTag());
+		check(slotIdx)
+
+		const TArray<ASMEquippableBase*>& slotInventory = EquippableInventory[*slotIdx].SlotInventory;
+		const FInventoryEquippableLocation* location = InventoryIndex.LocationByEquippable.Find(desiredOrCurrentEquippable);
 		
-		const int32 currentEquippableIdx = equippableSlot->SlotInventory.Find(desiredOrCurrentEquippable);
-		const int32 nextElement = currentEquippableIdx + 1;
-		if (equippableSlot->SlotInventory.IsValidIndex(nextElement))
+		const int32 nextElement = location ? location->Position + 1 : 0;
+		if (slotInventory.IsValidIndex(nextElement))
 		{
 			// Equip the next equippable in CurrentEquippables current slot.
-			SetDesiredEquippable(equippableSlot->SlotInventory[nextElement]);
+			SetDesiredEquippable(slotInventory[nextElement]);
 			return;
 		}
 
 		// Now we know there isn't anything in the slot our desiredOrCurrentEquippable is in, we need to prepare searching the next slot.
-		
-		nextSlotIdxToSearch = (EquippableInventory.Find(*equippableSlot) + 1) % EquippableInventory.Num();
-		check(nextSlotIdxToSearch != INDEX_NONE)
+		// CycleOrder is laid out slot by slot, so the element after desiredOrCurrentEquippable is the start of the next slot.
+		cycleIdxToSearch = location ? location->CycleIndex + 1 : InventoryIndex.SlotCycleStart[*slotIdx];
 	}
 
 	// At this point, we have established there is no "next equippable" in the current slot our
 	// desiredOrCurrentEquippable is in. This next part will continue the search through all other slots until we can find
 	// a suitable equippable to try and equip.
 	
-	int32 slotsSearched = 0;
-	const int32 slotCount = EquippableInventory.Num();
-	for (int32 Idx = nextSlotIdxToSearch; slotsSearched < slotCount; slotsSearched++)
+	if (ASMEquippableBase* equippable = FindEquippableToCycleTo(cycleIdxToSearch, 1))
 	{
-		if (EquippableInventory.IsValidIndex(Idx))
-		{
-			FInventorySlot& slotToSearch = EquippableInventory[Idx];
-		
-			for (ASMEquippableBase* equippable : slotToSearch.SlotInventory)
-			{
-				check(equippable)
-				
-				const bool bNotMarkedForDrop = DesiredEquippable.IsValid() == true ? equippable != DesiredEquippableToDrop.Get() : true;
-				if (equippable->CanEquip() && bNotMarkedForDrop && equippable != CurrentEquippable)
-				{
-					SetDesiredEquippable(equippable);
-					return;
-				}
-			}
-		}
-
-		Idx = (Idx + 1) % EquippableInventory.Num();
+		SetDesiredEquippable(equippable);
+		return;
 	}
 
 	// @bug: equippable doesn't drop with high latency when spam dropping all equippables. NOTE: this goes same with PreviousEquippable.
@@ -173,7 +184,7 @@ void USMEquippableInventoryComponent::PreviousEquippable()
 {
 	DesiredEquippable.Reset();
 	
-	int32 nextSlotIdxToSearch = 0;
+	int32 cycleIdxToSearch = InventoryIndex.CycleOrder.Num() - 1;
 
 	// Depending on if we're already unequippable an equippable, we would like to index our search based on the currently selected equippable on the players HUD.
 	ASMEquippableBase* desiredOrCurrentEquippable = DesiredEquippable.IsValid() ? DesiredEquippable.Get() : CurrentEquippable;
@@ -181,54 +192,33 @@ void USMEquippableInventoryComponent::PreviousEquippable()
 	// This part of the function checks to see if we have anything after CurrentEquippable in it's current slot we can equip, so we can avoid searching through all other slots.
 	if (desiredOrCurrentEquippable)
 	{
-		FInventorySlot* equippableSlot = nullptr;
-		
-		equippableSlot = FindInventorySlotByTag(desiredOrCurrentEquippable->GetSlotTag());
-		check(equippableSlot)
+		const int32* slotIdx = InventoryIndex.SlotIndexByTag.Find(desiredOrCurrentEquippable->GetSlotTag());
+		check(slotIdx)
+
+		const TArray<ASMEquippableBase*>& slotInventory = EquippableInventory[*slotIdx].SlotInventory;
+		const FInventoryEquippableLocation* location = InventoryIndex.LocationByEquippable.Find(desiredOrCurrentEquippable);
 		
-		const int32 currentEquippableIdx = equippableSlot->SlotInventory.Find(desiredOrCurrentEquippable);
-		const int32 nextElement = currentEquippableIdx + -1;
-		if (equippableSlot->SlotInventory.IsValidIndex(nextElement))
+		const int32 nextElement = location ? location->Position - 1 : INDEX_NONE;
+		if (slotInventory.IsValidIndex(nextElement))
 		{
 			// Equip the previous equippable in CurrentEquippables current slot.
-			SetDesiredEquippable(equippableSlot->SlotInventory[nextElement]);
+			SetDesiredEquippable(slotInventory[nextElement]);
 			return;
 		}
 
-		// Now we know there isn't anything in the slot our desiredOrCurrentEquippable is in, we need to prepare searching the next slot.
-		
-		nextSlotIdxToSearch =  FMath::Abs(EquippableInventory.Find(*equippableSlot) - 1 + EquippableInventory.Num()) % EquippableInventory.Num();
-		check(nextSlotIdxToSearch != INDEX_NONE)
+		// Now we know there isn't anything in the slot our desiredOrCurrentEquippable is in, we need to prepare searching the previous slot.
+		// The element before the start of this slot in CycleOrder is the last element of the previous slot.
+		cycleIdxToSearch = (location ? location->CycleIndex : InventoryIndex.SlotCycleStart[*slotIdx]) - 1;
 	}
 
-	// At this point, we have established there is no "next equippable" in the current slot our
-	// desiredOrCurrentEquippable is in. This next part will continue the search through all other slots until we can find
-	// a suitable equippable to try and equip.
+	// At this point, we have established there is no "previous equippable" in the current slot our
+	// desiredOrCurrentEquippable is in. This next part will continue the search backwards through all other slots until
+	// we can find a suitable equippable to try and equip.
 	
-	int32 slotsSearched = 0;
-	const int32 slotCount = EquippableInventory.Num();
-	for (int32 slotIdx = nextSlotIdxToSearch; slotsSearched < slotCount; slotsSearched++)
+	if (ASMEquippableBase* equippable = FindEquippableToCycleTo(cycleIdxToSearch, -1))
 	{
-		if (EquippableInventory.IsValidIndex(slotIdx))
-		{
-			FInventorySlot& slotToSearch = EquippableInventory[slotIdx];
-
-			// Loop through the slots inventory backwards
-			for (int32 slotEquippableIdx = slotToSearch.SlotInventory.Num() - 1; slotEquippableIdx >= 0; slotEquippableIdx--)
-			{
-				ASMEquippableBase* equippable = slotToSearch.SlotInventory[slotEquippableIdx];
-				check(equippable)
-
-				const bool bNotMarkedForDrop = DesiredEquippable.IsValid() == true ? equippable != DesiredEquippableToDrop.Get() : true;
-				if (equippable->CanEquip() && bNotMarkedForDrop && equippable != CurrentEquippable)
-				{
-					SetDesiredEquippable(equippable);
-					return;
-				}
-			}
-		}
-
-		slotIdx = (slotIdx - 1) % EquippableInventory.Num();
+		SetDesiredEquippable(equippable);
+		return;
 	}
 	
 	if (DesiredEquippable.IsValid())
@@ -282,7 +272,7 @@ void USMEquippableInventoryComponent::SetDesiredEquippable(ASMEquippableBase* de
 			// if we are not already unequipping something
 			if (!GetWorld()->GetTimerManager().IsTimerActive(UnEquipTimerHandle))
 			{
-				AttemptEquip(desiredEquippable, false);
+				AttemptEquip(desiredEquippable);
 			}
 
 			// When picking up your first equippable, you won't be able to drop it if it's your only one. This stops the variable from sitting in limbo and fucking everything else up.
@@ -294,28 +284,19 @@ void USMEquippableInventoryComponent::SetDesiredEquippable(ASMEquippableBase* de
 	}
 }
 
-void USMEquippableInventoryComponent::AttemptEquip(ASMEquippableBase* desiredEquippable, bool bFromReplication)
+void USMEquippableInventoryComponent::AttemptEquip(ASMEquippableBase* desiredEquippable)
 {
 	SM_LOG(Log, TEXT("%s called with equippable: %s, Authority: %i"), ANSI_TO_TCHAR(__FUNCTION__), *AActor::GetDebugName(desiredEquippable), bCachedHasAuthority)
 	
 	// no point going past this if statement if we have nothing to unequip in the first place.
 	if (!CurrentEquippable)
 	{
-		SetCurrentEquippable(desiredEquippable, bFromReplication);
+		SetCurrentEquippable(desiredEquippable, false);
 		return;
 	}
-	
-	if (!bFromReplication)
-	{
-		if (bCachedHasAuthority && !GetIsListenServerOrStandaloneLocalController())
-		{
-			ClientAttemptEquip(desiredEquippable);
-		}
-		else
-		{
-			ServerAttemptEquip(desiredEquippable);
-		}
-	}
+
+	// Nothing is sent to the server here. The unequip is predicted locally and whatever DesiredEquippable is when it
+	// finishes gets sent in a single ServerRequestEquip, so spamming next/previous equippable costs nothing extra.
 	
 	// We don't check if desiredEquippable is nullptr anymore because we might want to set our current equippable
 	// to nullptr, @TODO: we could add a bool here to say bIsNull to define if we are meant to send a nullptr or not.
@@ -343,6 +324,26 @@ bool USMEquippableInventoryComponent::GiveExistingEquippable(ASMEquippableBase*
 	return bSuccess;
 }
 
+ASMEquippableBase* USMEquippableInventoryComponent::GiveNewEquippable(TSubclassOf<ASMEquippableBase> EquippableClass, AActor* EquippableReceiver)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GiveNewEquippable)
+	
+	if (!EquippableClass || !EquippableReceiver || !EquippableReceiver->HasAuthority())
+	{
+		return nullptr;
+	}
+
+	USMEquippablePoolSubsystem* pool = USMEquippablePoolSubsystem::Get(EquippableReceiver->GetWorld());
+	if (!pool)
+	{
+		return nullptr;
+	}
+
+	// The pool hands it to EquippableReceiver through OnExplicitlySpawnedIn, and puts it straight back if that fails.
+	ASMEquippableBase* equippable = pool->AcquireEquippable(EquippableClass, EquippableReceiver->GetActorTransform(), EquippableReceiver);
+	return (equippable && equippable->GetOwner() == EquippableReceiver) ? equippable : nullptr;
+}
+
 void USMEquippableInventoryComponent::DropEquippable(ASMEquippableBase* EquippableToDrop, bool bFromReplication, bool bDontFindNextEquippable, bool bInstantIfCurrent)
 {
 	// We don't want to send more requests to drop the same equippable we are already trying to drop.
@@ -465,6 +466,13 @@ void USMEquippableInventoryComponent::BeginUnEquippingCurrentEquippable()
 		{
 			SetEquippableChangeStatus(EEquippableChangeStatus::UnEquipping);
 		}
+		else
+		{
+			// So the server can pull abilities and show simulated proxies the unequip early. It takes a sequence number of
+			// its own, so corrections the server sent before it arrived are ignored and the request after it is newer.
+			LocalEquipSequence++;
+			ServerNotifyUnEquipping(LocalEquipSequence);
+		}
 	}
 	else
 	{
@@ -485,10 +493,9 @@ void USMEquippableInventoryComponent::ApplyEquippableChangingGameplayTag()
 	USMAbilitySystemComponent* ASC = interface->GetSMAbilitySystemComponent();
 	check(ASC)
 		
-	const FName tagName = FName("Character.IsChangingEquippable");
-	if (!ASC->HasMatchingGameplayTag(FGameplayTag::RequestGameplayTag(tagName)))
+	if (!ASC->HasMatchingGameplayTag(SMGameplayTags::Character_IsChangingEquippable))
 	{
-		interface->GetSMAbilitySystemComponent()->AddLooseGameplayTag(FGameplayTag::RequestGameplayTag(tagName));
+		interface->GetSMAbilitySystemComponent()->AddLooseGameplayTag(SMGameplayTags::Character_IsChangingEquippable);
 	}
 }
 
@@ -542,7 +549,7 @@ void USMEquippableInventoryComponent::OnUnEquipFinish()
 			UE_LOG(LogSpawnMaster, Log, TEXT("OnUnEquipFinish has finished yet the DesiredEquippable is nullptr."))
 			SetCurrentEquippable(nullptr, false);
 			
-			UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(GetOwner())->RemoveLooseGameplayTag(FGameplayTag::RequestGameplayTag(FName("Character.IsChangingEquippable")));
+			UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(GetOwner())->RemoveLooseGameplayTag(SMGameplayTags::Character_IsChangingEquippable);
 		}
 	}
 }
@@ -560,6 +567,8 @@ void USMEquippableInventoryComponent::SetCurrentEquippable(ASMEquippableBase* eq
 	{
 		SM_LOG(Log, TEXT("equippableToSet in SetCurrentEquippable is nullptr. bFromReplication: %i, NetMode: %i"), bFromReplication, static_cast<int32>(CachedOwnerNetMode))
 	}
+
+	ASMEquippableBase* const previousEquippable = CurrentEquippable;
 	
 	if (!bFromReplication)
 	{
@@ -572,14 +581,21 @@ void USMEquippableInventoryComponent::SetCurrentEquippable(ASMEquippableBase* eq
 		const bool bIsListenServerOrStandaloneLocalController = GetIsListenServerOrStandaloneLocalController();
 		if (bCachedHasAuthority && bIsListenServerOrStandaloneLocalController == false) // We want standalone/listen server to use client code.
 		{
-			ClientSetCurrentEquippable(equippableToSet);
+			ClientCorrectEquippable(equippableToSet, LastAcceptedEquipSequence);
 			CurrentEquippable = equippableToSet;
+
+			// The client takes the correction over an unequip it had notified us of, so ours is over too.
+			if (EquippableChangeStatus == EEquippableChangeStatus::UnEquipping)
+			{
+				SetEquippableChangeStatus(EEquippableChangeStatus::Equipping);
+			}
 		}
 		else // if client
 		{
 			if (bIsListenServerOrStandaloneLocalController == false)
 			{
-				ServerSetCurrentEquippable(equippableToSet);
+				LocalEquipSequence++;
+				ServerRequestEquip(equippableToSet, LocalEquipSequence);
 			}
 
 			// If we're switching equippable, we want to detach the old one before we set the new one.
@@ -666,6 +682,17 @@ void USMEquippableInventoryComponent::SetCurrentEquippable(ASMEquippableBase* eq
 
 	if (bCachedHasAuthority)
 	{
+		// Only the equippable in hand stays awake, the one we just put away can go dormant.
+		if (previousEquippable && previousEquippable != CurrentEquippable)
+		{
+			previousEquippable->RefreshNetDormancy();
+		}
+		
+		if (CurrentEquippable)
+		{
+			CurrentEquippable->RefreshNetDormancy();
+		}
+		
 		CheckPerformEquippableDrop();
 		
 		if (CurrentEquippable)
@@ -695,6 +722,9 @@ bool USMEquippableInventoryComponent::AddEquippableToInventory(ASMEquippableBase
 			}
 			else
 			{
+				RebuildInventoryIndex();
+				InventoryEntries.AddEntry(equippableToAdd, equippableToAdd->GetSlotTag());
+				
 				equippableToAdd->SetOwner(this->GetOwner());
 				OnEquippableAddedToInventory.Broadcast(equippableToAdd, equippableToAdd->GetSlotTag(), invSlot);
 				return true;
@@ -726,6 +756,10 @@ void USMEquippableInventoryComponent::CheckPerformEquippableDrop(bool bForceDrop
 				SM_LOG(Warning, TEXT("CheckPerformEquippableDrop could not remove equippable from slot inventory."))
 				return; // @TODO: should we return here?
 			}
+
+			RebuildInventoryIndex();
+			InventoryEntries.RemoveEntry(equippableToDrop);
+			OnEquippableRemovedFromInventory.Broadcast(equippableToDrop, equippableToDrop->GetSlotTag(), slot);
 		}
 
 		// Stops the equippable from being picked up instantly.
@@ -822,19 +856,7 @@ ASMEquippableBase* USMEquippableInventoryComponent::FindEquippableByClass(TSubcl
 
 bool USMEquippableInventoryComponent::FindEquippableInInventory(ASMEquippableBase* equippableToFind)
 {
-	if (equippableToFind)
-	{
-
-		if (const FInventorySlot* invSlot = FindInventorySlotByTag(equippableToFind->GetSlotTag()))
-		{
-			if (invSlot->SlotInventory.Contains(equippableToFind))
-			{
-				return true;
-			}
-		}
-	}
-
-	return false;
+	return equippableToFind && InventoryIndex.LocationByEquippable.Contains(equippableToFind);
 }
 
 bool USMEquippableInventoryComponent::CheckEquippableSlot(FGameplayTag slotGameplayTag)
@@ -842,7 +864,7 @@ bool USMEquippableInventoryComponent::CheckEquippableSlot(FGameplayTag slotGamep
 	if (slotGameplayTag.IsValid())
 	{
 		// Do we always want to equip equippables that are of slot "NoSlot"?
-		if (slotGameplayTag == FGameplayTag::RequestGameplayTag("EquippableSlot.NoSlot"))
+		if (slotGameplayTag == SMGameplayTags::EquippableSlot_NoSlot)
 		{
 			return bDisallowSlotlessEquippables;
 		}
@@ -877,6 +899,30 @@ bool USMEquippableInventoryComponent::CanAddEquippableToInventory(const ASMEquip
 	return true;
 }
 
+bool USMEquippableInventoryComponent::HasFreeSlot() const
+{
+	for (const FInventorySlot& slot : EquippableInventory)
+	{
+		if (!slot.IsFull())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool USMEquippableInventoryComponent::HasRoomForEquippable(const ASMEquippableBase* equippable) const
+{
+	if (!equippable)
+	{
+		return false;
+	}
+	
+	const int32* slotIdx = InventoryIndex.SlotIndexByTag.Find(equippable->GetSlotTag());
+	return slotIdx && !EquippableInventory[*slotIdx].IsFull();
+}
+
 bool USMEquippableInventoryComponent::IsSlotFull(FGameplayTag slotToCheck)
 {
 	if (FInventorySlot* inventorySlot = FindInventorySlotByTag(slotToCheck))
@@ -891,12 +937,9 @@ FInventorySlot* USMEquippableInventoryComponent::FindInventorySlotByTag(FGamepla
 {
 	if (slotTag.IsValid())
 	{
-		for (FInventorySlot& invSlot : EquippableInventory)
+		if (const int32* slotIdx = InventoryIndex.SlotIndexByTag.Find(slotTag))
 		{
-			if (invSlot.SlotTag == slotTag)
-			{
-				return &invSlot;
-			}
+			return &EquippableInventory[*slotIdx];
 		}
 	}
 
@@ -906,11 +949,86 @@ FInventorySlot* USMEquippableInventoryComponent::FindInventorySlotByTag(FGamepla
 
 void USMEquippableInventoryComponent::GetAllEquippablesInInventory(TArray<ASMEquippableBase*>& OutEquippables)
 {
-	for (FInventorySlot& slot : EquippableInventory)
+	OutEquippables.Append(InventoryIndex.CycleOrder);
+}
+
+ASMEquippableBase* USMEquippableInventoryComponent::FindEquippableToCycleTo(int32 StartCycleIdx, int32 Direction) const
+{
+	return InventoryIndex.FindInCycleOrder(StartCycleIdx, Direction, [this](ASMEquippableBase* equippable)
+	{
+		check(equippable)
+
+		const bool bNotMarkedForDrop = DesiredEquippable.IsValid() == true ? equippable != DesiredEquippableToDrop.Get() : true;
+		return equippable->CanEquip() && bNotMarkedForDrop && equippable != CurrentEquippable;
+	});
+}
+
+void USMEquippableInventoryComponent::RebuildInventoryIndex()
+{
+	InventoryIndex.Rebuild(EquippableInventory);
+}
+
+void USMEquippableInventoryComponent::OnReplicatedEquippableAdded(ASMEquippableBase* equippable, FGameplayTag slotTag, uint32 orderKey)
+{
+	FInventorySlot* invSlot = FindInventorySlotByTag(slotTag);
+	if (!equippable || !invSlot || invSlot->SlotInventory.Contains(equippable))
+	{
+		return;
+	}
+
+	invSlot->SlotInventory.Insert(equippable, InventoryEntries.GetSlotPosition(invSlot->SlotInventory, orderKey));
+	InventoryEntries.OrderKeyByEquippable.Add(equippable, orderKey);
+	RebuildInventoryIndex();
+
+	OnEquippableAddedToInventory.Broadcast(equippable, slotTag, invSlot);
+}
+
+void USMEquippableInventoryComponent::OnReplicatedEquippableRemoved(ASMEquippableBase* equippable, FGameplayTag slotTag)
+{
+	InventoryEntries.OrderKeyByEquippable.Remove(equippable);
+	
+	FInventorySlot* invSlot = FindInventorySlotByTag(slotTag);
+	if (!invSlot || !invSlot->RemoveFromSlotInventory(equippable))
 	{
-		for (ASMEquippableBase* equippable : slot.SlotInventory)
+		return;
+	}
+
+	RebuildInventoryIndex();
+
+	OnEquippableRemovedFromInventory.Broadcast(equippable, slotTag, invSlot);
+}
+
+void FInventoryIndex::Rebuild(const TArray<FInventorySlot>& Inventory)
+{
+	SlotIndexByTag.Reset();
+	LocationByEquippable.Reset();
+	CycleOrder.Reset();
+	SlotCycleStart.Reset(Inventory.Num());
+
+	for (int32 slotIdx = 0; slotIdx < Inventory.Num(); slotIdx++)
+	{
+		const FInventorySlot& slot = Inventory[slotIdx];
+		
+		// Keep the first slot with a given tag, same as the old linear search would have found.
+		if (!SlotIndexByTag.Contains(slot.SlotTag))
+		{
+			SlotIndexByTag.Add(slot.SlotTag, slotIdx);
+		}
+
+		SlotCycleStart.Add(CycleOrder.Num());
+		
+		for (int32 position = 0; position < slot.SlotInventory.Num(); position++)
 		{
-			OutEquippables.Add(equippable);
+			ASMEquippableBase* equippable = slot.SlotInventory[position];
+			if (!equippable)
+			{
+				continue;
+			}
+			
+			FInventoryEquippableLocation& location = LocationByEquippable.Add(equippable);
+			location.SlotIndex = slotIdx;
+			location.Position = position;
+			location.CycleIndex = CycleOrder.Add(equippable);
 		}
 	}
 }
@@ -936,24 +1054,78 @@ void USMEquippableInventoryComponent::NetMulticastVisuallyUnEquip_Implementation
 /* Networking
 ***********************************************************************************/
 
-void USMEquippableInventoryComponent::ClientSetCurrentEquippable_Implementation(ASMEquippableBase* equippableToSet)
+void USMEquippableInventoryComponent::ServerRequestEquip_Implementation(ASMEquippableBase* equippableToSet, uint16 sequence)
 {
+	// Reliable RPCs arrive in order so this shouldn't happen, but never let an older request undo a newer one.
+	if (!IsNewerEquipSequence(sequence, LastAcceptedEquipSequence))
+	{
+		return;
+	}
+	
+	LastAcceptedEquipSequence = sequence;
+
+	// nullptr is allowed, that's the client putting everything away.
+	if (equippableToSet && !FindEquippableInInventory(equippableToSet))
+	{
+		SM_LOG(Log, TEXT("Rejected equip request %i for %s, it isn't in the inventory."), sequence, *AActor::GetDebugName(equippableToSet))
+
+		// The client snaps back to what we have, so undo the unequip its notify started.
+		if (EquippableChangeStatus == EEquippableChangeStatus::UnEquipping)
+		{
+			SetCurrentEquippable(CurrentEquippable, true);
+		}
+		
+		ClientCorrectEquippable(CurrentEquippable, sequence);
+		return;
+	}
+
 	SetCurrentEquippable(equippableToSet, true);
+	ClientAckEquip(sequence);
 }
 
-void USMEquippableInventoryComponent::ServerSetCurrentEquippable_Implementation(ASMEquippableBase* equippableToSet)
+void USMEquippableInventoryComponent::ServerNotifyUnEquipping_Implementation(uint16 sequence)
 {
-	SetCurrentEquippable(equippableToSet, true);
+	// Same ordering as ServerRequestEquip. Taking the sequence means a server side change made after this point sends
+	// a correction the client will accept, and one made before it is ignored because the client has moved on.
+	if (!IsNewerEquipSequence(sequence, LastAcceptedEquipSequence))
+	{
+		return;
+	}
+
+	LastAcceptedEquipSequence = sequence;
+	
+	if (EquippableChangeStatus != EEquippableChangeStatus::UnEquipping)
+	{
+		BeginUnEquippingCurrentEquippable();
+	}
 }
 
-void USMEquippableInventoryComponent::ServerAttemptEquip_Implementation(ASMEquippableBase* desiredEquippable)
+void USMEquippableInventoryComponent::ClientAckEquip_Implementation(uint16 sequence)
 {
-	AttemptEquip(desiredEquippable, true);
+	if (IsNewerEquipSequence(sequence, LastAckedEquipSequence))
+	{
+		LastAckedEquipSequence = sequence;
+	}
 }
 
-void USMEquippableInventoryComponent::ClientAttemptEquip_Implementation(ASMEquippableBase* desiredEquippable)
+void USMEquippableInventoryComponent::ClientCorrectEquippable_Implementation(ASMEquippableBase* equippableToSet, uint16 sequence)
 {
-	AttemptEquip(desiredEquippable, true);
+	// We've sent a request since the one this is correcting, the server will answer that one instead.
+	if (!ShouldApplyEquipCorrection(sequence, LocalEquipSequence, LastAckedEquipSequence))
+	{
+		return;
+	}
+
+	LastAckedEquipSequence = sequence;
+	
+	// Throw away whatever we were predicting and take the servers equippable.
+	GetWorld()->GetTimerManager().ClearTimer(UnEquipTimerHandle);
+	DesiredEquippable.Reset();
+
+	if (CurrentEquippable != equippableToSet)
+	{
+		SetCurrentEquippable(equippableToSet, true);
+	}
 }
 
 void USMEquippableInventoryComponent::ServerDropEquippable_Implementation(ASMEquippableBase* equippableToDrop, bool bInstant, bool bDontFindNextEquippable)
@@ -999,6 +1171,83 @@ void USMEquippableInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetim
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME_CONDITION(USMEquippableInventoryComponent, CurrentEquippable, COND_SimulatedOnly);
-	DOREPLIFETIME_CONDITION(USMEquippableInventoryComponent, EquippableInventory, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(USMEquippableInventoryComponent, InventoryEntries, COND_OwnerOnly);
 	DOREPLIFETIME(USMEquippableInventoryComponent, EquippableChangeStatus);
 }
+
+/* Inventory Replication
+***********************************************************************************/
+
+void FInventoryEntry::PreReplicatedRemove(const FInventoryEntryList& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent && AppliedEquippable)
+	{
+		InArraySerializer.OwnerComponent->OnReplicatedEquippableRemoved(AppliedEquippable, SlotTag);
+	}
+
+	AppliedEquippable = nullptr;
+}
+
+void FInventoryEntry::PostReplicatedAdd(const FInventoryEntryList& InArraySerializer)
+{
+	// If the equippable hasn't resolved yet this will be picked up by PostReplicatedChange once it does.
+	if (InArraySerializer.OwnerComponent && Equippable)
+	{
+		InArraySerializer.OwnerComponent->OnReplicatedEquippableAdded(Equippable, SlotTag, OrderKey);
+		AppliedEquippable = Equippable;
+	}
+}
+
+void FInventoryEntry::PostReplicatedChange(const FInventoryEntryList& InArraySerializer)
+{
+	// Entries are never changed on the server, so this only happens when the equippable reference resolves late (or goes
+	// away because the equippable was destroyed).
+	if (!InArraySerializer.OwnerComponent || AppliedEquippable == Equippable)
+	{
+		return;
+	}
+
+	if (AppliedEquippable)
+	{
+		InArraySerializer.OwnerComponent->OnReplicatedEquippableRemoved(AppliedEquippable, SlotTag);
+		AppliedEquippable = nullptr;
+	}
+
+	if (Equippable)
+	{
+		InArraySerializer.OwnerComponent->OnReplicatedEquippableAdded(Equippable, SlotTag, OrderKey);
+		AppliedEquippable = Equippable;
+	}
+}
+
+void FInventoryEntryList::AddEntry(ASMEquippableBase* equippable, FGameplayTag slotTag)
+{
+	FInventoryEntry& entry = Entries.Emplace_GetRef(equippable, slotTag);
+	entry.OrderKey = NextOrderKey++;
+	entry.AppliedEquippable = equippable;
+	MarkItemDirty(entry);
+}
+
+bool FInventoryEntryList::RemoveEntry(const ASMEquippableBase* equippable)
+{
+	const int32 entryIdx = Entries.IndexOfByPredicate([equippable](const FInventoryEntry& entry) { return entry.Equippable == equippable; });
+	if (entryIdx == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// Slot order comes from OrderKey, so the order of the remaining entries doesn't matter.
+	Entries.RemoveAtSwap(entryIdx);
+	MarkArrayDirty();
+	return true;
+}
+
+int32 FInventoryEntryList::GetSlotPosition(const TArray<ASMEquippableBase*>& slotInventory, uint32 orderKey) const
+{
+	// The slot inventory is kept sorted by OrderKey, so insert after every equippable that was added before this one.
+	return Algo::UpperBoundBy(slotInventory, orderKey, [this](const ASMEquippableBase* equippable)
+	{
+		const uint32* equippableOrderKey = OrderKeyByEquippable.Find(equippable);
+		return equippableOrderKey ? *equippableOrderKey : 0;
+	});
+}
@@ -6,8 +6,10 @@
 #include "GameplayEffectExtension.h"
 #include "GAS/SMAbilitySystemComponent.h"
 #include "GAS/AttributeSets/SMHealthAttributeSet.h"
+#include "GAS/SMGameplayTags.h"
 #include "Net/UnrealNetwork.h"
 #include "SpawnMaster/SpawnMaster.h"
+#include "Subsystems/SMTeamSubsystem.h"
 
 // Sets default values for this component's properties
 USMHealthComponent::USMHealthComponent()
@@ -15,6 +17,39 @@ USMHealthComponent::USMHealthComponent()
 	SetIsReplicatedByDefault(true);
 }
 
+void USMHealthComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	RegisterWithTeamSubsystem();
+}
+
+void USMHealthComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (USMTeamSubsystem* teamSubsystem = USMTeamSubsystem::Get(GetWorld()))
+	{
+		teamSubsystem->UnregisterActor(GetOwner());
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void USMHealthComponent::PostLoad()
+{
+	Super::PostLoad();
+
+	// Convert teams saved before they were gameplay tags.
+	if (TeamID != ETeamID::NoTeam)
+	{
+		if (!Team.IsValid())
+		{
+			Team = TeamID == ETeamID::Zombie ? SMGameplayTags::Team_Zombie : SMGameplayTags::Team_Survivor;
+		}
+
+		TeamID = ETeamID::NoTeam;
+	}
+}
+
 void USMHealthComponent::InitializeWithAbilitySystemComponent(USMAbilitySystemComponent* InASC)
 {
 	AActor* Owner = GetOwner();
@@ -97,17 +132,18 @@ void USMHealthComponent::HandleOutOfHealth(AActor* DamageInstigator, AActor* Dam
 #endif
 }
 
-void USMHealthComponent::SetTeam(ETeamID newTeam)
+void USMHealthComponent::SetTeam(FGameplayTag newTeam)
 {
 	if (GetOwnerRole() == ROLE_Authority)
 	{
-		if (TeamID == newTeam)
+		if (Team == newTeam)
 		{
 			return; // Already the same team, no need to continue.
 		}
 
-		const ETeamID oldTeam = TeamID;
-		TeamID = newTeam;
+		const FGameplayTag oldTeam = Team;
+		Team = newTeam;
+		RegisterWithTeamSubsystem();
 		OnTeamChange.Broadcast(oldTeam, newTeam);
 	}
 	else
@@ -116,52 +152,73 @@ void USMHealthComponent::SetTeam(ETeamID newTeam)
 	}
 }
 
-ETeamID USMHealthComponent::GetTeam()
-{
-	return TeamID;
-}
-
-ETeamID USMHealthComponent::GetTeamFromActor(const AActor* actor)
+FGameplayTag USMHealthComponent::GetTeamFromActor(const AActor* actor)
 {
 	if (actor)
 	{
+		if (const USMTeamSubsystem* teamSubsystem = USMTeamSubsystem::Get(actor->GetWorld()))
+		{
+			return teamSubsystem->GetActorTeam(actor);
+		}
+
+		// No team subsystem outside of game worlds
 		if (const USMHealthComponent* healthComponent = actor->FindComponentByClass<USMHealthComponent>())
 		{
-			return healthComponent->TeamID;
+			return healthComponent->Team;
 		}
 	
-		UE_LOG(LogSpawnMaster, Warning, TEXT("Actor found in GetTeam, but no HealthComponent was found."))
-	
-		return ETeamID::NoTeam;
+		return FGameplayTag();
 	}
 
-	UE_LOG(LogSpawnMaster, Warning, TEXT("Actor in function GetTeam is nullptr. Returning NoTeam."))
+	UE_LOG(LogSpawnMaster, Warning, TEXT("Actor in function GetTeam is nullptr. Returning no team."))
 	
-	return ETeamID::NoTeam;
+	return FGameplayTag();
 }
 
-bool USMHealthComponent::IsFriendly(const AActor* actorA, const AActor* actorB) // @TODO: possible we can do this in a cheaper manner? it's fine for now though. (maybe interface?)
+bool USMHealthComponent::IsFriendly(const AActor* actorA, const AActor* actorB)
 {
-	USMHealthComponent* healthComponentA = actorA->FindComponentByClass<USMHealthComponent>();
-	USMHealthComponent* healthComponentB = actorB->FindComponentByClass<USMHealthComponent>();
+	if (!actorA || !actorB)
+	{
+		return true;
+	}
+
+	if (const USMTeamSubsystem* teamSubsystem = USMTeamSubsystem::Get(actorA->GetWorld()))
+	{
+		// Unregistered actors (no Health Component) are never hostile.
+		return !teamSubsystem->AreHostile(actorA, actorB);
+	}
+
+	// No team subsystem outside of game worlds, only tell teams apart.
+	const USMHealthComponent* healthComponentA = actorA->FindComponentByClass<USMHealthComponent>();
+	const USMHealthComponent* healthComponentB = actorB->FindComponentByClass<USMHealthComponent>();
 	if (healthComponentA && healthComponentB)
 	{
-		// We want to be able to inflict damage on anything without a team.
-		if (healthComponentA->TeamID == ETeamID::NoTeam || healthComponentB->TeamID == ETeamID::NoTeam)
-		{
-			return false; // Teamless = hostile to everyone.
-		}
-		
-		return (healthComponentA->GetTeam() == healthComponentB->GetTeam());
+		// Teamless = hostile to everyone.
+		return healthComponentA->Team.IsValid() && healthComponentA->Team == healthComponentB->Team;
 	}
 	
 	return true; // Assume friendly if no Health Component was found.
 }
 
-void USMHealthComponent::OnRep_TeamID(ETeamID oldTeam)
+void USMHealthComponent::OnRep_Team(FGameplayTag oldTeam)
 {
+	RegisterWithTeamSubsystem();
+	
 	// This is how OnTeamChange gets broadcasted for clients.
-	OnTeamChange.Broadcast(oldTeam, TeamID);
+	OnTeamChange.Broadcast(oldTeam, Team);
+}
+
+void USMHealthComponent::RegisterWithTeamSubsystem()
+{
+	if (!HasBegunPlay())
+	{
+		return;
+	}
+
+	if (USMTeamSubsystem* teamSubsystem = USMTeamSubsystem::Get(GetWorld()))
+	{
+		teamSubsystem->SetActorTeam(GetOwner(), Team);
+	}
 }
 
 void USMHealthComponent::OnRep_IsDead(bool bOldIsDead)
@@ -176,6 +233,6 @@ void USMHealthComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& O
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(USMHealthComponent, TeamID);
+	DOREPLIFETIME(USMHealthComponent, Team);
 	DOREPLIFETIME(USMHealthComponent, bIsDead);
 }
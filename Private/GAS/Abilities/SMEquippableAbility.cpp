@@ -4,11 +4,36 @@
 #include "GAS/Abilities/SMEquippableAbility.h"
 
 #include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
 #include "AIController.h"
+#include "Async/ParallelFor.h"
+#include "Components/SkinnedMeshComponent.h"
 #include "Components/SMEquippableInventoryComponent.h"
+#include "GameFramework/Character.h"
+#include "GAS/Executions/SMDamageExecution.h"
+#include "GAS/SMCartridgeTargetData.h"
+#include "GAS/SMDamageMultiplierTable.h"
+#include "GAS/SMPelletDirections.h"
 #include "Items/SMEquippableBase.h"
 #include "Items/SMGunBase.h"
 #include "SpawnMasterSM/SpawnMaster.h"
+#include "Subsystems/SMLagCompensationSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("TraceBulletsInCartridge"), STAT_TraceBulletsInCartridge, STATGROUP_SpawnMaster);
+DECLARE_CYCLE_STAT(TEXT("ApplyDamageToTargets"), STAT_ApplyDamageToTargets, STATGROUP_SpawnMaster);
+
+// Compiled damage multipliers, one per ability class.
+static TSMBakedCurveCache<FSMDamageMultiplierTable>& GetDamageMultiplierTableCache()
+{
+	static TSMBakedCurveCache<FSMDamageMultiplierTable> Cache;
+	return Cache;
+}
+
+// Pellets deal their damage to the first thing they hit that has an ability system.
+static bool CanTakeDamage(const AActor* Actor)
+{
+	return Actor && UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Actor) != nullptr;
+}
 
 namespace SpawnMasterConsoleVariables
 {
@@ -32,6 +57,20 @@ namespace SpawnMasterConsoleVariables
 		DrawBulletHitRadius,
 		TEXT("When bullet hit debug drawing is enabled (see DrawBulletHitDuration), how big should the hit radius be? (in uu)"),
 		ECVF_Default);
+
+	static bool ParallelPelletTraces = true;
+	static FAutoConsoleVariableRef CVarParallelPelletTraces(
+		TEXT("spawnmaster.Weapon.ParallelPelletTraces"),
+		ParallelPelletTraces,
+		TEXT("Should the pellets of a multi bullet cartridge be traced on worker threads (ignored while bullet traces are being drawn)"),
+		ECVF_Default);
+
+	static float MaxCartridgeOriginError = 150.0f;
+	static FAutoConsoleVariableRef CVarMaxCartridgeOriginError(
+		TEXT("spawnmaster.Weapon.MaxCartridgeOriginError"),
+		MaxCartridgeOriginError,
+		TEXT("How far (in uu) the trace origin a client reports can be from where the server has its weapon, on top of how far the shooter could have moved since the shot. Cartridges past it are rejected"),
+		ECVF_Default);
 }
 
 bool USMEquippableAbility::CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags,
@@ -67,7 +106,10 @@ void USMEquippableAbility::ActivateAbility(const FGameplayAbilitySpecHandle Hand
     
     OnTargetDataReadyCallbackDelegateHandle = MyAbilityComponent->AbilityTargetDataSetDelegate(CurrentSpecHandle, CurrentActivationInfo.GetActivationPredictionKey()).AddUObject(this, &ThisClass::OnTargetDataReadyCallback);
 
-	
+	// Cache the trace params for every shot of this activation
+	RefreshWeaponTraceParams(/*bIsSimulated=*/ false);
+
+	NumCartridgesHandled = 0;
 }
 
 void USMEquippableAbility::EndAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, bool bReplicateEndAbility, bool bWasCancelled)
@@ -103,35 +145,26 @@ void USMEquippableAbility::StartRangedTargeting()
 	
 	FScopedPredictionWindow ScopedPrediction(MyAbilityComponent, CurrentActivationInfo.GetActivationPredictionKey());
 
-	TArray<FHitResult> FoundHits;
-	PerformLocalTargeting(/*out*/ FoundHits);
-
 	static uint32 newUniqueID = 0;
 	newUniqueID++;
+
+	// Fill out the target data from the hit results, the whole cartridge goes in a single compact entry
+	FSMCartridgeTargetData CartridgeData;
+	CartridgeData.CartridgeID = newUniqueID;
 	
-	// Fill out the target data from the hit results
 	FGameplayAbilityTargetDataHandle TargetData;
 	TargetData.UniqueId = newUniqueID;
 
-	if (FoundHits.Num() > 0)
+	if (PerformLocalTargeting(/*out*/ CartridgeData))
 	{
-		for (const FHitResult& FoundHit : FoundHits)
-		{
-			FGameplayAbilityTargetData_SingleTargetHit* NewTargetData = new FGameplayAbilityTargetData_SingleTargetHit();
-			NewTargetData->HitResult = FoundHit;
-
-			// NOTE: In the Lyra project, they have a CartridgeID in a class derived from FGameplayAbilityTargetData_SingleTargetHit.
-			// For now, I'm going to use UniqueID as the CartridgeID and see how that goes.
-
-			TargetData.Add(NewTargetData);
-		}
+		TargetData.Add(new FSMCartridgeTargetData(MoveTemp(CartridgeData)));
 	}
 
 	// Process the target data immediately
 	OnTargetDataReadyCallback(TargetData, FGameplayTag());
 }
 
-void USMEquippableAbility::PerformLocalTargeting(TArray<FHitResult>& Hits)
+bool USMEquippableAbility::PerformLocalTargeting(FSMCartridgeTargetData& OutCartridge)
 {
 	APawn* const AvatarPawn = Cast<APawn>(GetAvatarActorFromActorInfo());
 
@@ -144,9 +177,16 @@ void USMEquippableAbility::PerformLocalTargeting(TArray<FHitResult>& Hits)
 
 		//@TODO: Should do more complicated logic here when the player is close to a wall, etc...
 		const FTransform TargetTransform = GetTargetingTransform(AvatarPawn);
-		InputData.AimDir = TargetTransform.GetUnitAxis(EAxis::X);
 		InputData.StartTrace = TargetTransform.GetTranslation();
 
+		// Trace with the quantized aim and spread, the server regenerates the pellets from those
+		OutCartridge.Origin = InputData.StartTrace;
+		OutCartridge.SetAim(TargetTransform.GetUnitAxis(EAxis::X), WeaponData->GetCalculatedSpreadAngle());
+		OutCartridge.SetInterpolationDelay(USMLagCompensationSubsystem::GetInterpolationDelay(Cast<ACharacter>(AvatarPawn)));
+		InputData.AimDir = OutCartridge.GetAimDirection();
+		InputData.SpreadAngle = OutCartridge.GetSpreadAngle();
+		InputData.SpreadSeed = FSMCartridgeTargetData::GetSpreadSeed(CurrentActivationInfo.GetActivationPredictionKey().Current, NumCartridgesHandled);
+
 		InputData.EndAim = InputData.StartTrace + InputData.AimDir * 9999.f; /* @TODO: WeaponData->GetMaxDamageRange(); */
 #if ENABLE_DRAW_DEBUG
 		if (SpawnMasterConsoleVariables::DrawBulletTracesDuration > 0.0f)
@@ -155,34 +195,69 @@ void USMEquippableAbility::PerformLocalTargeting(TArray<FHitResult>& Hits)
 			DrawDebugLine(GetWorld(), InputData.StartTrace, InputData.StartTrace + (InputData.AimDir * 100.0f), FColor::Yellow, false, SpawnMasterConsoleVariables::DrawBulletTracesDuration, 0, DebugThickness);
 		}
 #endif
-		TraceBulletsInCartridge(InputData, /*out*/ Hits);
+		TraceBulletsInCartridge(InputData, /*out*/ OutCartridge);
 	}
+
+	return OutCartridge.Pellets.Num() > 0;
+}
+
+void USMEquippableAbility::GeneratePelletDirections(const FVector& AimDir, float SpreadAngle, int32 SpreadSeed, int32 NumPellets, FSMPelletDirections& OutDirections)
+{
+	const float HalfSpreadAngleInRadians = FMath::DegreesToRadians(SpreadAngle * 0.5f);
+	
+	FRandomStream SpreadStream(SpreadSeed);
+	OutDirections.Generate(AimDir, HalfSpreadAngleInRadians, 1.0f/* @TODO: EquippableData->GetSpreadExponent() */, SpreadStream, NumPellets);
 }
 
-void USMEquippableAbility::TraceBulletsInCartridge(const FRangedEquippableFiringInput& InputData, TArray<FHitResult>& OutHits)
+void USMEquippableAbility::TraceBulletsInCartridge(const FRangedEquippableFiringInput& InputData, FSMCartridgeTargetData& OutCartridge)
 {
+	SCOPE_CYCLE_COUNTER(STAT_TraceBulletsInCartridge)
+	
 	ASMGunBase* EquippableData = InputData.EquippableData;
 	check(EquippableData);
 
-	const int32 BulletsPerCartridge = EquippableData->GetBulletsPerCartridge();
+	const int32 BulletsPerCartridge = FMath::Min(EquippableData->GetBulletsPerCartridge(), static_cast<int32>(MAX_uint8));
+	const float MaxDamageRange = EquippableData->GetMaxDamageRange();
+
+	// Pick every pellet's direction up front on the game thread, from the same stream the server will use.
+	FSMPelletDirections PelletDirections;
+	GeneratePelletDirections(InputData.AimDir, InputData.SpreadAngle, InputData.SpreadSeed, BulletsPerCartridge, /*out*/ PelletDirections);
 
+	// Pellets keep their hit arrays between shots, so steady fire doesn't allocate here.
+	if (PelletTraceScratch.Num() < BulletsPerCartridge)
+	{
+		PelletTraceScratch.SetNum(BulletsPerCartridge);
+	}
+	
 	for (int32 BulletIndex = 0; BulletIndex < BulletsPerCartridge; ++BulletIndex)
 	{
-		const float BaseSpreadAngle = EquippableData->GetCalculatedSpreadAngle();
-		const float SpreadAngleMultiplier = 0.0f /* @TODO: EquippableData->GetCalculatedSpreadAngleMultiplier() */;
-		const float ActualSpreadAngle = BaseSpreadAngle /* @TODO: * SpreadAngleMultiplier */;
-
-		const float HalfSpreadAngleInRadians = FMath::DegreesToRadians(ActualSpreadAngle * 0.5f);
-
-		const FVector BulletDir = VRandConeNormalDistribution(InputData.AimDir, HalfSpreadAngleInRadians, 1.0f/* @TODO: EquippableData->GetSpreadExponent() */);
+		FPelletTrace& PelletTrace = PelletTraceScratch[BulletIndex];
+		PelletTrace.Reset();
+		PelletTrace.EndTrace = InputData.StartTrace + (PelletDirections[BulletIndex] * MaxDamageRange);
+	}
 
-		const FVector EndTrace = InputData.StartTrace + (BulletDir * EquippableData->GetMaxDamageRange());
-		FVector HitLocation = EndTrace;
+	// The traces only read the physics scene, so pellets can run on worker threads. Debug drawing isn't thread safe.
+	bool bTraceInParallel = SpawnMasterConsoleVariables::ParallelPelletTraces && BulletsPerCartridge > 1;
+#if ENABLE_DRAW_DEBUG
+	bTraceInParallel &= SpawnMasterConsoleVariables::DrawBulletTracesDuration <= 0.0f;
+#endif
 
-		TArray<FHitResult> AllImpacts;
+	ParallelFor(BulletsPerCartridge, [&](int32 BulletIndex)
+	{
+		FPelletTrace& PelletTrace = PelletTraceScratch[BulletIndex];
+		PelletTrace.Impact = DoSingleBulletTrace(InputData.StartTrace, PelletTrace.EndTrace, 0.0f /* @TODO: EquippableData->GetBulletTraceSweepRadius() */, WeaponTraceParams, WeaponTraceChannel, /*out*/ PelletTrace);
+	}, bTraceInParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
 
-		FHitResult Impact = DoSingleBulletTrace(InputData.StartTrace, EndTrace, 0.0f /* @TODO: EquippableData->GetBulletTraceSweepRadius() */, /*bIsSimulated=*/ false, /*out*/ AllImpacts);
+	// Hitbox hits carry their hit zone, the server gets it from its own hitboxes instead
+	const USMLagCompensationSubsystem* LagCompensation = USMLagCompensationSubsystem::Get(GetWorld());
 
+	// Gather in pellet order, so the output is the same as tracing them one after the other.
+	for (int32 BulletIndex = 0; BulletIndex < BulletsPerCartridge; ++BulletIndex)
+	{
+		FPelletTrace& PelletTrace = PelletTraceScratch[BulletIndex];
+		FHitResult& Impact = PelletTrace.Impact;
+		const FVector& EndTrace = PelletTrace.EndTrace;
+		
 		const AActor* HitActor = Impact.GetActor();
 
 		if (HitActor)
@@ -194,30 +269,32 @@ void USMEquippableAbility::TraceBulletsInCartridge(const FRangedEquippableFiring
 			}
 #endif
 
-			if (AllImpacts.Num() > 0)
+			// Only send where the pellet stopped, that's the one hit the server will count
+			const int32 StopIdx = FSMCartridgeTargetData::FindPelletStop(PelletTrace.Hits, [](const FHitResult& Hit) { return CanTakeDamage(Hit.GetActor()); });
+			if (PelletTrace.Hits.IsValidIndex(StopIdx))
 			{
-				OutHits.Append(AllImpacts);
+				const FHitResult& Hit = PelletTrace.Hits[StopIdx];
+				OutCartridge.AddHit(Hit, BulletIndex, LagCompensation ? LagCompensation->GetHitZone(Hit) : FGameplayTag());
 			}
-
-			HitLocation = Impact.ImpactPoint;
 		}
 
-		// Make sure there's always an entry in OutHits so the direction can be used for tracers, etc...
-		if (OutHits.Num() == 0)
+		// Make sure there's always an entry in the cartridge so the direction can be used for tracers, etc...
+		if (OutCartridge.Pellets.Num() == 0)
 		{
 			if (!Impact.bBlockingHit)
 			{
 				// Locate the fake 'impact' at the end of the trace
 				Impact.Location = EndTrace;
 				Impact.ImpactPoint = EndTrace;
+				Impact.TraceEnd = EndTrace;
 			}
 
-			OutHits.Add(Impact);
+			OutCartridge.AddHit(Impact, BulletIndex);
 		}
 	}
 }
 
-FHitResult USMEquippableAbility::DoSingleBulletTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, bool bIsSimulated, TArray<FHitResult>& OutHits)
+FHitResult USMEquippableAbility::DoSingleBulletTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, const FCollisionQueryParams& TraceParams, ECollisionChannel TraceChannel, FPelletTrace& PelletTrace) const
 {
 #if ENABLE_DRAW_DEBUG
 	if (SpawnMasterConsoleVariables::DrawBulletTracesDuration > 0.0f)
@@ -228,12 +305,13 @@ FHitResult USMEquippableAbility::DoSingleBulletTrace(const FVector& StartTrace,
 #endif // ENABLE_DRAW_DEBUG
 	
 	FHitResult Impact;
+	TArray<FHitResult>& OutHits = PelletTrace.Hits;
 
 	// Trace and process instant hit if something was hit
 	// First trace without using sweep radius
 	if (FindFirstPawnHitResult(OutHits) == INDEX_NONE)
 	{
-		Impact = WeaponTrace(StartTrace, EndTrace, /*SweepRadius=*/ 0.0f, bIsSimulated, /*out*/ OutHits);
+		Impact = WeaponTrace(StartTrace, EndTrace, /*SweepRadius=*/ 0.0f, TraceParams, TraceChannel, PelletTrace.QueryResults, /*out*/ OutHits);
 	}
 
 	if (FindFirstPawnHitResult(OutHits) == INDEX_NONE)
@@ -241,8 +319,9 @@ FHitResult USMEquippableAbility::DoSingleBulletTrace(const FVector& StartTrace,
 		// If this weapon didn't hit anything with a line trace and supports a sweep radius, try that
 		if (SweepRadius > 0.0f)
 		{
-			TArray<FHitResult> SweepHits;
-			Impact = WeaponTrace(StartTrace, EndTrace, SweepRadius, bIsSimulated, /*out*/ SweepHits);
+			TArray<FHitResult>& SweepHits = PelletTrace.SweepHits;
+			SweepHits.Reset();
+			Impact = WeaponTrace(StartTrace, EndTrace, SweepRadius, TraceParams, TraceChannel, PelletTrace.QueryResults, /*out*/ SweepHits);
 
 			// If the trace with sweep radius enabled hit a pawn, check if we should use its hit results
 			const int32 FirstPawnIdx = FindFirstPawnHitResult(SweepHits);
@@ -268,7 +347,8 @@ FHitResult USMEquippableAbility::DoSingleBulletTrace(const FVector& StartTrace,
 
 				if (bUseSweepHits)
 				{
-					OutHits = SweepHits;
+					// Swap rather than copy, both arrays keep an allocation for the next shot
+					Swap(OutHits, SweepHits);
 				}
 			}
 		}
@@ -277,12 +357,10 @@ FHitResult USMEquippableAbility::DoSingleBulletTrace(const FVector& StartTrace,
 	return Impact;
 }
 
-FHitResult USMEquippableAbility::WeaponTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, bool bIsSimulated, TArray<FHitResult>& OutHitResults) const
+void USMEquippableAbility::RefreshWeaponTraceParams(bool bIsSimulated)
 {
-	TArray<FHitResult> HitResults;
-	
-	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(WeaponTrace), /*bTraceComplex=*/ true, /*IgnoreActor=*/ GetAvatarActorFromActorInfo());
-	TraceParams.bReturnPhysicalMaterial = true;
+	WeaponTraceParams = FCollisionQueryParams(SCENE_QUERY_STAT(WeaponTrace), /*bTraceComplex=*/ true, /*IgnoreActor=*/ GetAvatarActorFromActorInfo());
+	WeaponTraceParams.bReturnPhysicalMaterial = true;
 
 	// AddAdditionalTraceIgnoreActors
 	if (AActor* Avatar = GetAvatarActorFromActorInfo())
@@ -290,37 +368,56 @@ FHitResult USMEquippableAbility::WeaponTrace(const FVector& StartTrace, const FV
 		// Ignore any actors attached to the avatar doing the shooting
 		TArray<AActor*> AttachedActors;
 		Avatar->GetAttachedActors(/*out*/ AttachedActors);
-		TraceParams.AddIgnoredActors(AttachedActors);
+		WeaponTraceParams.AddIgnoredActors(AttachedActors);
 	}
 	// End of AddAdditionalTraceIgnoreActors
 	
-	//TraceParams.bDebugQuery = true;
+	//WeaponTraceParams.bDebugQuery = true;
 
-	const ECollisionChannel TraceChannel = DetermineTraceChannel(TraceParams, bIsSimulated);
+	WeaponTraceChannel = DetermineTraceChannel(WeaponTraceParams, bIsSimulated);
+}
 
+FHitResult USMEquippableAbility::WeaponTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, const FCollisionQueryParams& TraceParams, ECollisionChannel TraceChannel, TArray<FHitResult>& QueryResults, TArray<FHitResult>& OutHitResults) const
+{
+	QueryResults.Reset();
+	
 	if (SweepRadius > 0.0f)
 	{
-		GetWorld()->SweepMultiByChannel(HitResults, StartTrace, EndTrace, FQuat::Identity, TraceChannel, FCollisionShape::MakeSphere(SweepRadius), TraceParams);
+		GetWorld()->SweepMultiByChannel(QueryResults, StartTrace, EndTrace, FQuat::Identity, TraceChannel, FCollisionShape::MakeSphere(SweepRadius), TraceParams);
 	}
 	else
 	{
-		GetWorld()->LineTraceMultiByChannel(HitResults, StartTrace, EndTrace, TraceChannel, TraceParams);
+		GetWorld()->LineTraceMultiByChannel(QueryResults, StartTrace, EndTrace, TraceChannel, TraceParams);
+	}
+
+	// Characters with a hitbox set ignore the bullet channel, their hitboxes are traced separately. The hitbox blocks the
+	// bullet, so anything the physics trace found behind it goes.
+	FHitResult HitboxHit;
+	const USMLagCompensationSubsystem* LagCompensation = USMLagCompensationSubsystem::Get(GetWorld());
+	if (LagCompensation && LagCompensation->TraceHitboxes(StartTrace, EndTrace, SweepRadius, TraceParams, HitboxHit))
+	{
+		QueryResults.RemoveAll([&HitboxHit](const FHitResult& QueryResult) { return QueryResult.Distance >= HitboxHit.Distance; });
+		QueryResults.Add(HitboxHit);
 	}
 
 	FHitResult Hit(ForceInit);
-	if (HitResults.Num() > 0)
+	if (QueryResults.Num() > 0)
 	{
 		// Filter the output list to prevent multiple hits on the same actor;
 		// this is to prevent a single bullet dealing damage multiple times to
 		// a single actor if using an overlap trace
-		for (FHitResult& CurHitResult : HitResults)
+		TSet<const AActor*, DefaultKeyFuncs<const AActor*>, TInlineSetAllocator<16>> HitActors;
+		for (const FHitResult& ExistingHitResult : OutHitResults)
 		{
-			auto Pred = [&CurHitResult](const FHitResult& Other)
-			{
-				return Other.HitObjectHandle == CurHitResult.HitObjectHandle;
-			};
+			HitActors.Add(ExistingHitResult.GetActor());
+		}
+		
+		for (const FHitResult& CurHitResult : QueryResults)
+		{
+			bool bAlreadyHit = false;
+			HitActors.Add(CurHitResult.GetActor(), &bAlreadyHit);
 
-			if (!OutHitResults.ContainsByPredicate(Pred))
+			if (!bAlreadyHit)
 			{
 				OutHitResults.Add(CurHitResult);
 			}
@@ -360,6 +457,13 @@ void USMEquippableAbility::OnTargetDataReadyCallback(const FGameplayAbilityTarge
 			MyAbilityComponent->CallServerSetReplicatedTargetData(CurrentSpecHandle, CurrentActivationInfo.GetActivationPredictionKey(), LocalTargetDataHandle, ApplicationTag, MyAbilityComponent->ScopedPredictionKey);
 		}
 
+		// Hits from remote clients get checked against where the targets were on that client's screen
+		const bool bShouldConfirmHits = CurrentActorInfo->IsNetAuthority() && !CurrentActorInfo->IsLocallyControlled();
+		if (bShouldConfirmHits)
+		{
+			RemoveUnconfirmedHits(LocalTargetDataHandle);
+		}
+
 
 		// See if we still have ammo
 		if (CommitAbility(CurrentSpecHandle, CurrentActorInfo, CurrentActivationInfo))
@@ -379,10 +483,295 @@ void USMEquippableAbility::OnTargetDataReadyCallback(const FGameplayAbilityTarge
 		}
 	}
 
+	// Both sides handle every cartridge of the activation in order, so they agree on the next spread seed
+	++NumCartridgesHandled;
+
 	// We've processed the data
 	MyAbilityComponent->ConsumeClientReplicatedTargetData(CurrentSpecHandle, CurrentActivationInfo.GetActivationPredictionKey());
 }
 
+void USMEquippableAbility::RemoveUnconfirmedHits(FGameplayAbilityTargetDataHandle& TargetData) const
+{
+	const ASMGunBase* EquippableData = Cast<ASMGunBase>(GetEquippable());
+	if (!EquippableData)
+	{
+		return;
+	}
+	
+	const USMLagCompensationSubsystem* LagCompensation = USMLagCompensationSubsystem::Get(GetWorld());
+
+	const int32 BulletsPerCartridge = FMath::Min(EquippableData->GetBulletsPerCartridge(), static_cast<int32>(MAX_uint8));
+	FSMPelletDirections PelletDirections;
+
+	// The origin is the client's word. It has to be near where we have the shooter, give or take how far it could have
+	// moved since it fired, or it could shoot from right next to its target.
+	const APawn* AvatarPawn = Cast<APawn>(GetAvatarActorFromActorInfo());
+	const FVector ServerOrigin = GetEquippableTargetingSourceLocation();
+
+	// A shot is one cartridge. Anything else the client put in the handle (more cartridges, raw hit results) would only
+	// be there to deal more damage.
+	bool bFoundCartridge = false;
+	TargetData.Data.RemoveAll([&bFoundCartridge](const TSharedPtr<FGameplayAbilityTargetData>& Data)
+	{
+		if (bFoundCartridge || !Data.IsValid() || Data->GetScriptStruct() != FSMCartridgeTargetData::StaticStruct())
+		{
+			return true;
+		}
+
+		bFoundCartridge = true;
+		return false;
+	});
+
+	for (const TSharedPtr<FGameplayAbilityTargetData>& Data : TargetData.Data)
+	{
+		if (!Data.IsValid() || Data->GetScriptStruct() != FSMCartridgeTargetData::StaticStruct())
+		{
+			continue;
+		}
+
+		FSMCartridgeTargetData* CartridgeData = static_cast<FSMCartridgeTargetData*>(Data.Get());
+
+		// Rewind to what the client saw, its interpolation delay included
+		const float ShotTime = LagCompensation ? LagCompensation->GetShotTime(CurrentActorInfo->PlayerController.Get(), CartridgeData->GetInterpolationDelay()) : 0.0f;
+		const float TimeSinceShot = LagCompensation ? FMath::Max(GetWorld()->GetTimeSeconds() - ShotTime, 0.0f) : 0.0f;
+		const float MaxOriginError = SpawnMasterConsoleVariables::MaxCartridgeOriginError + (AvatarPawn ? AvatarPawn->GetVelocity().Size() * TimeSinceShot : 0.0f);
+
+		if (FVector::DistSquared(CartridgeData->Origin, ServerOrigin) > FMath::Square(MaxOriginError))
+		{
+			SM_LOG(Warning, TEXT("%s rejected a cartridge fired from %.0fuu away from its shooter."), *GetName(), FVector::Dist(CartridgeData->Origin, ServerOrigin))
+			for (FSMPelletHit& Pellet : CartridgeData->Pellets)
+			{
+				Pellet.bHit = false;
+				Pellet.HitComponent = nullptr;
+			}
+			continue;
+		}
+
+		CartridgeData->RemoveDuplicatePellets(BulletsPerCartridge, [](const FSMPelletHit& Pellet)
+		{
+			const UPrimitiveComponent* HitComponent = Pellet.HitComponent.Get();
+			return HitComponent && CanTakeDamage(HitComponent->GetOwner());
+		});
+
+		// Regenerate the pellets the client traced. The spread can't be tighter than the gun ever gets, and the seed
+		// only comes from the activation and how many cartridges it handled (see GetSpreadSeed for what that allows).
+		const float SpreadAngle = FMath::Max(CartridgeData->GetSpreadAngle(), EquippableData->GetMinSpreadAngle());
+		const int32 SpreadSeed = FSMCartridgeTargetData::GetSpreadSeed(CurrentActivationInfo.GetActivationPredictionKey().Current, NumCartridgesHandled);
+		GeneratePelletDirections(CartridgeData->GetAimDirection(), SpreadAngle, SpreadSeed, BulletsPerCartridge, /*out*/ PelletDirections);
+		CartridgeData->RebuildImpactPoints(PelletDirections);
+
+		// Rejected pellets are turned into misses, so the shot direction is still there for tracers
+		for (FSMPelletHit& Pellet : CartridgeData->Pellets)
+		{
+			const UPrimitiveComponent* HitComponent = Pellet.HitComponent.Get();
+			const AActor* HitActor = HitComponent ? HitComponent->GetOwner() : nullptr;
+			if (!HitActor)
+			{
+				continue;
+			}
+
+			FSMConfirmedHitbox Hitbox;
+			if (LagCompensation && !LagCompensation->ConfirmHit(HitActor, CartridgeData->Origin, Pellet.ImpactPoint, ShotTime, &Hitbox))
+			{
+				SM_LOG(Verbose, TEXT("%s rejected a hit on %s that didn't line up with its hitbox history."), *GetName(), *GetNameSafe(HitActor))
+				Pellet.bHit = false;
+				Pellet.HitComponent = nullptr;
+				continue;
+			}
+
+			// The bone and material pick the damage multiplier, so they come from the hitbox the hit went through
+			// instead of the client. Hits on anything without hitboxes get neither.
+			if (Hitbox.Mesh)
+			{
+				Pellet.HitComponent = Hitbox.Mesh;
+			}
+			Pellet.BoneIndex = Hitbox.BoneIndex;
+			Pellet.HitZone = Hitbox.HitZone;
+			Pellet.PhysicalMaterialIndex = Hitbox.PhysicalMaterialIndex;
+		}
+	}
+}
+
+TArray<FHitResult> USMEquippableAbility::GetHitResultsFromTargetData(const FGameplayAbilityTargetDataHandle& TargetData)
+{
+	TArray<FHitResult> HitResults;
+	
+	for (const TSharedPtr<FGameplayAbilityTargetData>& Data : TargetData.Data)
+	{
+		if (!Data.IsValid())
+		{
+			continue;
+		}
+
+		if (Data->GetScriptStruct() == FSMCartridgeTargetData::StaticStruct())
+		{
+			const FSMCartridgeTargetData* CartridgeData = static_cast<const FSMCartridgeTargetData*>(Data.Get());
+			for (int32 PelletIdx = 0; PelletIdx < CartridgeData->Pellets.Num(); ++PelletIdx)
+			{
+				HitResults.Add(CartridgeData->GetPelletHitResult(PelletIdx));
+			}
+		}
+		else if (const FHitResult* HitResult = Data->GetHitResult())
+		{
+			HitResults.Add(*HitResult);
+		}
+	}
+
+	return HitResults;
+}
+
+int32 USMEquippableAbility::ApplyDamageToTargets(const FGameplayAbilityTargetDataHandle& TargetData)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ApplyDamageToTargets)
+	
+	if (!DamageEffectClass || !CurrentActorInfo || !CurrentActorInfo->IsNetAuthority())
+	{
+		return 0;
+	}
+
+	UAbilitySystemComponent* SourceASC = CurrentActorInfo->AbilitySystemComponent.Get();
+	if (!SourceASC)
+	{
+		return 0;
+	}
+
+	// Everything hit that has an ability system, with the damage of all the pellets that hit it
+	struct FTargetDamage
+	{
+		const AActor* Actor = nullptr;
+		UAbilitySystemComponent* AbilitySystem = nullptr;
+		float DamageMultiplier = 0.0f;
+
+		// Hit the effect context gets, for cues and such
+		FHitResult FirstHit;
+	};
+	TArray<FTargetDamage, TInlineAllocator<16>> Targets;
+
+	const TSharedRef<const FSMDamageMultiplierTable> MultiplierTable = GetDamageMultiplierTable();
+	const USMLagCompensationSubsystem* LagCompensation = USMLagCompensationSubsystem::Get(GetWorld());
+
+	// Same limits RemoveUnconfirmedHits holds client data to: one cartridge, and every pellet counted once.
+	const ASMGunBase* GunData = Cast<ASMGunBase>(GetEquippable());
+	const int32 BulletsPerCartridge = GunData ? FMath::Min(GunData->GetBulletsPerCartridge(), static_cast<int32>(MAX_uint8)) : MAX_uint8 + 1;
+	bool bCountedCartridge = false;
+
+	// Returns false if the actor can't take damage
+	auto AddHit = [&Targets](const AActor* HitActor, float DamageMultiplier, const TFunctionRef<FHitResult()>& MakeHitResult)
+	{
+		if (!HitActor)
+		{
+			return false;
+		}
+
+		// Most pellets of a cartridge hit the same few actors, so check those before looking up the ability system
+		FTargetDamage* Target = Targets.FindByPredicate([HitActor](const FTargetDamage& Other) { return Other.Actor == HitActor; });
+		if (!Target)
+		{
+			UAbilitySystemComponent* AbilitySystem = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(HitActor);
+			if (!AbilitySystem)
+			{
+				return false;
+			}
+
+			Target = Targets.FindByPredicate([AbilitySystem](const FTargetDamage& Other) { return Other.AbilitySystem == AbilitySystem; });
+			if (!Target)
+			{
+				Target = &Targets.AddDefaulted_GetRef();
+				Target->Actor = HitActor;
+				Target->AbilitySystem = AbilitySystem;
+				Target->FirstHit = MakeHitResult();
+			}
+		}
+
+		Target->DamageMultiplier += DamageMultiplier;
+		return true;
+	};
+	
+	for (const TSharedPtr<FGameplayAbilityTargetData>& Data : TargetData.Data)
+	{
+		if (!Data.IsValid())
+		{
+			continue;
+		}
+
+		if (Data->GetScriptStruct() == FSMCartridgeTargetData::StaticStruct())
+		{
+			if (bCountedCartridge)
+			{
+				continue;
+			}
+			bCountedCartridge = true;
+
+			// Read the pellets as they are, a full hit result is only unpacked for the first hit on each target
+			const FSMCartridgeTargetData* CartridgeData = static_cast<const FSMCartridgeTargetData*>(Data.Get());
+			uint64 CountedPellets[4] = {};
+			for (int32 PelletIdx = 0; PelletIdx < CartridgeData->Pellets.Num(); ++PelletIdx)
+			{
+				const FSMPelletHit& Pellet = CartridgeData->Pellets[PelletIdx];
+				const UPrimitiveComponent* HitComponent = Pellet.HitComponent.Get();
+				if (!Pellet.bHit || !HitComponent || Pellet.PelletIndex >= BulletsPerCartridge)
+				{
+					continue;
+				}
+
+				// A pellet deals its damage to the first thing it hit that can take it, hits on anything else don't use it up
+				uint64& CountedWord = CountedPellets[Pellet.PelletIndex >> 6];
+				const uint64 PelletBit = 1ull << (Pellet.PelletIndex & 63);
+				if (CountedWord & PelletBit)
+				{
+					continue;
+				}
+
+				const float DamageMultiplier = MultiplierTable->GetMultiplier(Cast<USkinnedMeshComponent>(HitComponent), Pellet.BoneIndex, Pellet.HitZone, Pellet.PhysicalMaterialIndex, static_cast<float>(Pellet.Distance));
+				if (AddHit(HitComponent->GetOwner(), DamageMultiplier, [CartridgeData, PelletIdx]() { return CartridgeData->GetPelletHitResult(PelletIdx); }))
+				{
+					CountedWord |= PelletBit;
+				}
+			}
+		}
+		else if (const FHitResult* HitResult = Data->GetHitResult())
+		{
+			const FGameplayTag HitZone = LagCompensation ? LagCompensation->GetHitZone(*HitResult) : FGameplayTag();
+			AddHit(HitResult->GetActor(), MultiplierTable->GetMultiplier(*HitResult, HitZone), [HitResult]() { return *HitResult; });
+		}
+	}
+
+	if (Targets.Num() == 0)
+	{
+		return 0;
+	}
+
+	// The source side of the spec is captured once per equip, every target just gets a copy with its own hit
+	ASMEquippableBase* Equippable = GetEquippable();
+	const FGameplayEffectSpec* SpecTemplate = Equippable ? Equippable->GetDamageSpecTemplate(this, DamageEffectClass, GetAbilityLevel()) : nullptr;
+	if (!SpecTemplate)
+	{
+		return 0;
+	}
+
+	const FPredictionKey PredictionKey = CurrentActivationInfo.GetActivationPredictionKey();
+	int32 NumDamaged = 0;
+	
+	for (const FTargetDamage& Target : Targets)
+	{
+		const FGameplayEffectSpec Spec = USMDamageExecution::MakeDamageSpec(*SpecTemplate, Target.FirstHit, Target.DamageMultiplier);
+		SourceASC->ApplyGameplayEffectSpecToTarget(Spec, Target.AbilitySystem, PredictionKey);
+		++NumDamaged;
+	}
+
+	return NumDamaged;
+}
+
+TSharedRef<const FSMDamageMultiplierTable> USMEquippableAbility::GetDamageMultiplierTable() const
+{
+	// Compiled from the class defaults, instances can't change the multipliers
+	const USMEquippableAbility* Defaults = GetClass()->GetDefaultObject<USMEquippableAbility>();
+	return GetDamageMultiplierTableCache().FindOrBake(GetClass(), [Defaults](FSMDamageMultiplierTable& Table)
+	{
+		Table.Compile(Defaults->HitZoneDamageMultipliers, Defaults->HitboxZoneDamageMultipliers, Defaults->PhysicalMaterialDamageMultipliers, Defaults->DamageFalloffCurve);
+	}, Defaults->DamageFalloffCurve);
+}
+
 FTransform USMEquippableAbility::GetTargetingTransform(APawn* SourcePawn) const
 {
 	check(SourcePawn);
@@ -2,7 +2,9 @@
 
 
 #include "GAS/Abilities/SMEquippableAbilityBase.h"
+#include "AbilitySystemComponent.h"
 #include "Items/SMGunBase.h"
+#include "Settings/SMCombatSettings.h"
 
 void USMEquippableAbilityBase::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
 {
@@ -41,6 +43,26 @@ void USMEquippableAbilityBase::EndAbility(const FGameplayAbilitySpecHandle Handl
 	}
 }
 
+bool USMEquippableAbilityBase::CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags,
+                                                  const FGameplayTagContainer* TargetTags, FGameplayTagContainer* OptionalRelevantTags) const
+{
+	if (!Super::CanActivateAbility(Handle, ActorInfo, SourceTags, TargetTags, OptionalRelevantTags))
+	{
+		return false;
+	}
+
+	if (!GetDefault<USMCombatSettings>()->UsePersistentEquippableAbilities())
+	{
+		return true;
+	}
+
+	// Every equippable in the inventory has its abilities granted, only the one in our hands gets to use them.
+	const UAbilitySystemComponent* abilitySystem = ActorInfo ? ActorInfo->AbilitySystemComponent.Get() : nullptr;
+	const FGameplayAbilitySpec* spec = abilitySystem ? abilitySystem->FindAbilitySpecFromHandle(Handle) : nullptr;
+	const ASMEquippableBase* equippable = spec ? Cast<ASMEquippableBase>(spec->SourceObject) : nullptr;
+	return equippable && equippable->IsEquipped();
+}
+
 ASMEquippableBase* USMEquippableAbilityBase::GetEquippable() const
 {
 	if (OwnerEquippable.IsValid())
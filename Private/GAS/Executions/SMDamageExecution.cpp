@@ -4,8 +4,16 @@
 #include "GAS/Executions/SMDamageExecution.h"
 
 #include "AbilitySystemComponent.h"
+#include "GameplayEffect.h"
+#include "GAS/Abilities/SMEquippableAbility.h"
 #include "GAS/AttributeSets/SMCombatAttributeSet.h"
 #include "GAS/AttributeSets/SMHealthAttributeSet.h"
+#include "GAS/SMAbilitySystemComponent.h"
+#include "GAS/SMDamageMultiplierTable.h"
+#include "SpawnMaster/SpawnMaster.h"
+#include "Subsystems/SMLagCompensationSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("DamageExecution"), STAT_DamageExecution, STATGROUP_SpawnMaster);
 
 struct FDamageStatics
 {
@@ -25,6 +33,19 @@ static FDamageStatics& DamageStatics()
 	return Statics;
 }
 
+const FName USMDamageExecution::SetByCallerDamageMultiplier(TEXT("SetByCaller.DamageMultiplier"));
+const FName USMDamageExecution::SetByCallerFromDamageTemplate(TEXT("SetByCaller.FromDamageTemplate"));
+
+FGameplayEffectSpec USMDamageExecution::MakeDamageSpec(const FGameplayEffectSpec& SpecTemplate, const FHitResult& HitResult, float DamageMultiplier)
+{
+	FGameplayEffectContextHandle EffectContext = SpecTemplate.GetContext().Duplicate();
+	EffectContext.AddHitResult(HitResult, /*bReset=*/ true);
+
+	FGameplayEffectSpec Spec(SpecTemplate, EffectContext);
+	Spec.SetSetByCallerMagnitude(SetByCallerDamageMultiplier, DamageMultiplier);
+	Spec.SetSetByCallerMagnitude(SetByCallerFromDamageTemplate, 1.0f);
+	return Spec;
+}
 
 USMDamageExecution::USMDamageExecution()
 {
@@ -39,6 +60,7 @@ USMDamageExecution::USMDamageExecution()
 void USMDamageExecution::Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const
 {
 #if WITH_SERVER_CODE
+	SCOPE_CYCLE_COUNTER(STAT_DamageExecution)
 
 	UAbilitySystemComponent* TargetAbilitySystemComponent = ExecutionParams.GetTargetAbilitySystemComponent();
 	UAbilitySystemComponent* SourceAbilitySystemComponent = ExecutionParams.GetSourceAbilitySystemComponent();
@@ -47,28 +69,57 @@ void USMDamageExecution::Execute_Implementation(const FGameplayEffectCustomExecu
 	AActor* TargetActor = TargetAbilitySystemComponent ? TargetAbilitySystemComponent->GetAvatarActor() : nullptr;
 
 	const FGameplayEffectSpec& Spec = ExecutionParams.GetOwningSpec();
-	FGameplayTagContainer AssetTags;
-	Spec.GetAllAssetTags(AssetTags);
 
-	// Gather the tags from the source and target as that can affect which buffs should be used
-	const FGameplayTagContainer* SourceTags = Spec.CapturedSourceTags.GetAggregatedTags();
-	const FGameplayTagContainer* TargetTags = Spec.CapturedTargetTags.GetAggregatedTags();
+	const USMAbilitySystemComponent* SMTargetAbilitySystemComponent = Cast<USMAbilitySystemComponent>(TargetAbilitySystemComponent);
+	const USMAbilitySystemComponent* SMSourceAbilitySystemComponent = Cast<USMAbilitySystemComponent>(SourceAbilitySystemComponent);
 
-	FAggregatorEvaluateParameters EvaluationParameters;
-	EvaluationParameters.SourceTags = SourceTags;
-	EvaluationParameters.TargetTags = TargetTags;
+	// With nothing conditional on tags, the captures evaluate to the attributes' current values anyway. The source's
+	// BaseDamage is snapshotted, which is only its current value for specs from the template.
+	const bool bFastPath = SMTargetAbilitySystemComponent && !SMTargetAbilitySystemComponent->HasTagConditionalModifiers()
+		&& SMSourceAbilitySystemComponent && !SMSourceAbilitySystemComponent->HasTagConditionalModifiers()
+		&& Spec.SetByCallerNameMagnitudes.Contains(SetByCallerFromDamageTemplate)
+		&& Spec.Def && CanEffectUseFastPath(Spec.Def);
 
 	float CurrentHealth = 0.0f;
-	ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().HealthDef, EvaluationParameters, CurrentHealth);
-
 	float BaseDamage = 0.0f;
-	ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().BaseDamageDef, EvaluationParameters, BaseDamage);
+	
+	if (bFastPath)
+	{
+		CurrentHealth = SMTargetAbilitySystemComponent->GetNumericAttribute(USMHealthAttributeSet::GetHealthAttribute());
+		BaseDamage = SMSourceAbilitySystemComponent->GetNumericAttribute(USMCombatAttributeSet::GetBaseDamageAttribute());
+	}
+	else
+	{
+		// Gather the tags from the source and target as that can affect which buffs should be used
+		FAggregatorEvaluateParameters EvaluationParameters;
+		EvaluationParameters.SourceTags = Spec.CapturedSourceTags.GetAggregatedTags();
+		EvaluationParameters.TargetTags = Spec.CapturedTargetTags.GetAggregatedTags();
+
+		ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().HealthDef, EvaluationParameters, CurrentHealth);
+		ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().BaseDamageDef, EvaluationParameters, BaseDamage);
+	}
+
+	// Damage applied once for several pellets already has every pellet's multiplier summed up, anything else is a
+	// single hit scored from the hit result in its context
+	if (const float* DamageMultiplier = Spec.SetByCallerNameMagnitudes.Find(SetByCallerDamageMultiplier))
+	{
+		BaseDamage *= *DamageMultiplier;
+	}
+	else if (const FHitResult* HitResult = Spec.GetContext().GetHitResult())
+	{
+		// The context's ability is the class default object, it has no world. The ability systems being executed on do.
+		if (const USMEquippableAbility* Ability = Cast<USMEquippableAbility>(Spec.GetContext().GetAbility()))
+		{
+			const UAbilitySystemComponent* WorldContext = TargetAbilitySystemComponent ? TargetAbilitySystemComponent : SourceAbilitySystemComponent;
+			const USMLagCompensationSubsystem* LagCompensation = WorldContext ? USMLagCompensationSubsystem::Get(WorldContext->GetWorld()) : nullptr;
+			const FGameplayTag HitZone = LagCompensation ? LagCompensation->GetHitZone(*HitResult) : FGameplayTag();
+			BaseDamage *= Ability->GetDamageMultiplierTable()->GetMultiplier(*HitResult, HitZone);
+		}
+	}
 
 	// This clamp prevents us from doing more damage than there is health available.
 	const float DamageDone = FMath::Clamp(BaseDamage, 0.0f, CurrentHealth);
 
-	// @TODO: add distance falloff, different damage for body parts, etc (look at lyra example and gas shooter to see how to do this)
-	
 	if (DamageDone > 0.0f)
 	{
 		OutExecutionOutput.AddOutputModifier(FGameplayModifierEvaluatedData(USMHealthAttributeSet::GetHealthAttribute(), EGameplayModOp::Additive, -DamageDone));
@@ -76,3 +127,25 @@ void USMDamageExecution::Execute_Implementation(const FGameplayEffectCustomExecu
 	
 #endif
 }
+
+bool USMDamageExecution::CanEffectUseFastPath(const UGameplayEffect* Effect) const
+{
+	if (const bool* bCached = FastPathEffects.Find(Effect))
+	{
+		return *bCached;
+	}
+
+	// Scoped modifiers only exist inside the capture evaluation, reading attributes directly would skip them
+	bool bCanUseFastPath = true;
+	for (const FGameplayEffectExecutionDefinition& Execution : Effect->Executions)
+	{
+		if (Execution.CalculationClass == GetClass() && Execution.CalculationModifiers.Num() > 0)
+		{
+			bCanUseFastPath = false;
+			break;
+		}
+	}
+
+	FastPathEffects.Add(Effect, bCanUseFastPath);
+	return bCanUseFastPath;
+}
@@ -4,11 +4,14 @@
 #include "GAS/SMAbilitySystemComponent.h"
 
 #include "AbilitySystemGlobals.h"
-#include "EnhancedInputComponent.h"
 #include "GameplayCueManager.h"
+#include "GameplayEffect.h"
 #include "GameFramework/PlayerState.h"
 #include "GAS/SMGameplayAbility.h"
+#include "Input/SMEnhancedInputComponent.h"
+#include "Interfaces/SMFirstPersonInterface.h"
 #include "Net/UnrealNetwork.h"
+#include "Subsystems/SMMontageReplicationSubsystem.h"
 
 static TAutoConsoleVariable<float> CVarReplayMontageErrorThreshold(
 	TEXT("GS.replay.MontageErrorThreshold"),
@@ -16,6 +19,179 @@ static TAutoConsoleVariable<float> CVarReplayMontageErrorThreshold(
 	TEXT("Tolerance level for when montage playback position correction occurs in replays")
 );
 
+namespace SMMontageSlots
+{
+	// One replicated montage slot per EMeshType.
+	static constexpr int32 NumSlots = static_cast<int32>(EMeshType::FirstPersonLegs) + 1;
+
+	namespace Flags
+	{
+		static constexpr uint8 Stopped = 1 << 0;
+		static constexpr uint8 HasPlayRate = 1 << 1;
+		static constexpr uint8 HasBlendTime = 1 << 2;
+	}
+
+	// Montage reference not included, that depends on the package map.
+	static int32 GetSerializedBytes(uint8 flags)
+	{
+		int32 numBytes = 6; // Flags, ids and position
+		numBytes += (flags & Flags::HasPlayRate) ? 2 : 0;
+		numBytes += (flags & Flags::HasBlendTime) ? 2 : 0;
+		return numBytes;
+	}
+}
+
+void FSMRepAnimMontage::Quantize()
+{
+	PlayRate = FMath::Clamp(FMath::RoundToFloat(PlayRate * 100.0f), static_cast<float>(MIN_int16), static_cast<float>(MAX_int16)) / 100.0f;
+	Position = FMath::Clamp(FMath::RoundToFloat(Position * 100.0f), 0.0f, static_cast<float>(MAX_uint16)) / 100.0f;
+	BlendTime = FMath::Clamp(FMath::RoundToFloat(BlendTime * 100.0f), 0.0f, static_cast<float>(MAX_uint16)) / 100.0f;
+}
+
+bool FSMRepAnimMontage::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	UObject* montage = AnimMontage;
+	bOutSuccess = Map->SerializeObject(Ar, UAnimMontage::StaticClass(), montage);
+	AnimMontage = Cast<UAnimMontage>(montage);
+
+	uint8 flags = 0;
+	if (Ar.IsSaving())
+	{
+		flags |= bIsStopped ? SMMontageSlots::Flags::Stopped : 0;
+		flags |= PlayRate != 1.0f ? SMMontageSlots::Flags::HasPlayRate : 0;
+		flags |= BlendTime != 0.0f ? SMMontageSlots::Flags::HasBlendTime : 0;
+	}
+
+	Ar << flags;
+	Ar << PlayInstanceId;
+	Ar << NextSectionID;
+	Ar << SectionIdToPlay;
+
+	bIsStopped = (flags & SMMontageSlots::Flags::Stopped) != 0;
+
+	uint16 positionCentiseconds = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(Position * 100.0f), 0, static_cast<int32>(MAX_uint16)));
+	Ar << positionCentiseconds;
+	Position = positionCentiseconds / 100.0f;
+
+	if (flags & SMMontageSlots::Flags::HasPlayRate)
+	{
+		int16 playRateHundredths = static_cast<int16>(FMath::Clamp(FMath::RoundToInt(PlayRate * 100.0f), static_cast<int32>(MIN_int16), static_cast<int32>(MAX_int16)));
+		Ar << playRateHundredths;
+		PlayRate = playRateHundredths / 100.0f;
+	}
+	else if (Ar.IsLoading())
+	{
+		PlayRate = 1.0f;
+	}
+
+	if (flags & SMMontageSlots::Flags::HasBlendTime)
+	{
+		uint16 blendTimeCentiseconds = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(BlendTime * 100.0f), 0, static_cast<int32>(MAX_uint16)));
+		Ar << blendTimeCentiseconds;
+		BlendTime = blendTimeCentiseconds / 100.0f;
+	}
+	else if (Ar.IsLoading())
+	{
+		BlendTime = 0.0f;
+	}
+
+	if (Ar.IsSaving())
+	{
+		USMMontageReplicationSubsystem::AddBytesSent(SMMontageSlots::GetSerializedBytes(flags));
+	}
+
+	return true;
+}
+
+bool FSMRepAnimMontage::operator==(const FSMRepAnimMontage& other) const
+{
+	return AnimMontage == other.AnimMontage
+		&& PlayRate == other.PlayRate
+		&& Position == other.Position
+		&& BlendTime == other.BlendTime
+		&& NextSectionID == other.NextSectionID
+		&& SectionIdToPlay == other.SectionIdToPlay
+		&& PlayInstanceId == other.PlayInstanceId
+		&& bIsStopped == other.bIsStopped;
+}
+
+void FSMRepAnimMontageSlot::PostReplicatedAdd(const FSMRepAnimMontageSlots& InArraySerializer)
+{
+	PostReplicatedChange(InArraySerializer);
+}
+
+void FSMRepAnimMontageSlot::PostReplicatedChange(const FSMRepAnimMontageSlots& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->OnRep_AnimMontageSlot(*this);
+	}
+}
+
+USMAbilitySystemComponent::USMAbilitySystemComponent()
+{
+	RepAnimMontageSlots.OwnerComponent = this;
+}
+
+void USMAbilitySystemComponent::InitializeComponent()
+{
+	Super::InitializeComponent();
+
+	OnActiveGameplayEffectAddedDelegateToSelf.AddUObject(this, &ThisClass::OnActiveEffectAdded);
+	OnAnyGameplayEffectRemovedDelegate().AddUObject(this, &ThisClass::OnActiveEffectRemoved);
+}
+
+void USMAbilitySystemComponent::InitAbilityActorInfo(AActor* InOwnerActor, AActor* InAvatarActor)
+{
+	Super::InitAbilityActorInfo(InOwnerActor, InAvatarActor);
+
+	// Retry the montage slots that arrived before we had an avatar to play them on.
+	for (const FSMRepAnimMontageSlot& RepSlot : RepAnimMontageSlots.Slots)
+	{
+		if (PendingMontageSlots & (1 << RepSlot.MeshType))
+		{
+			OnRep_AnimMontageSlot(RepSlot);
+		}
+	}
+}
+
+bool USMAbilitySystemComponent::EffectHasTagConditionalModifiers(const UGameplayEffect* Effect)
+{
+	check(IsInGameThread());
+
+	static TMap<TObjectKey<UGameplayEffect>, bool> CachedEffects;
+	if (const bool* bCached = CachedEffects.Find(Effect))
+	{
+		return *bCached;
+	}
+
+	bool bHasTagConditionalModifiers = false;
+	for (const FGameplayModifierInfo& Modifier : Effect->Modifiers)
+	{
+		if (!Modifier.SourceTags.IsEmpty() || !Modifier.TargetTags.IsEmpty())
+		{
+			bHasTagConditionalModifiers = true;
+			break;
+		}
+	}
+
+	CachedEffects.Add(Effect, bHasTagConditionalModifiers);
+	return bHasTagConditionalModifiers;
+}
+
+void USMAbilitySystemComponent::OnActiveEffectAdded(UAbilitySystemComponent* Target, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle)
+{
+	if (Spec.Def && EffectHasTagConditionalModifiers(Spec.Def))
+	{
+		TagConditionalEffects.Add(Handle);
+	}
+}
+
+void USMAbilitySystemComponent::OnActiveEffectRemoved(const FActiveGameplayEffect& Effect)
+{
+	TagConditionalEffects.Remove(Effect.Handle);
+}
+
 float USMAbilitySystemComponent::PlayMontageForMesh(USkeletalMeshComponent* InMesh, USMGameplayAbility* InAnimatingAbility,
                                                     FGameplayAbilityActivationInfo ActivationInfo,
                                                     UAnimMontage* NewAnimMontage, float InPlayRate, FName StartSectionName,
@@ -70,26 +246,35 @@ float USMAbilitySystemComponent::PlayMontageForMesh(USkeletalMeshComponent* InMe
 			{
 				if (bReplicateMontage)
 				{
-					FGameplayAbilityRepAnimMontageForMesh& MutableRepAnimMontageInfo = GetGameplayAbilityRepAnimMontageForMesh(InMesh);
+					FSMRepAnimMontageSlot* RepSlot = GetRepAnimMontageSlotForMesh(InMesh);
+					if (!RepSlot)
+					{
+						UE_LOG(LogTemp, Warning, TEXT("PlayMontageForMesh: %s isn't one of the avatar's mesh types, montage %s won't replicate."), *GetNameSafe(InMesh), *GetNameSafe(NewAnimMontage));
+						return Duration;
+					}
+
+					FSMRepAnimMontage& RepMontage = RepSlot->Montage;
 
 					// Those are static parameters, they are only set when the montage is played. They are not changed after that.
-					MutableRepAnimMontageInfo.RepMontageInfo.AnimMontage = NewAnimMontage;
-					MutableRepAnimMontageInfo.RepMontageInfo.PlayInstanceId = (MutableRepAnimMontageInfo.RepMontageInfo.PlayInstanceId < UINT8_MAX ? MutableRepAnimMontageInfo.RepMontageInfo.PlayInstanceId + 1 : 0);
+					RepMontage.AnimMontage = NewAnimMontage;
+					RepMontage.PlayInstanceId = (RepMontage.PlayInstanceId < UINT8_MAX ? RepMontage.PlayInstanceId + 1 : 0);
 
-					MutableRepAnimMontageInfo.RepMontageInfo.SectionIdToPlay = 0;
-					if (MutableRepAnimMontageInfo.RepMontageInfo.AnimMontage && StartSectionName != NAME_None)
+					RepMontage.SectionIdToPlay = 0;
+					if (StartSectionName != NAME_None)
 					{
 						// we add one so INDEX_NONE can be used in the on rep
-						MutableRepAnimMontageInfo.RepMontageInfo.SectionIdToPlay = MutableRepAnimMontageInfo.RepMontageInfo.AnimMontage->GetSectionIndex(StartSectionName) + 1;
+						RepMontage.SectionIdToPlay = NewAnimMontage->GetSectionIndex(StartSectionName) + 1;
 					}
 
-					// Update parameters that change during Montage life time.
-					AnimMontage_UpdateReplicatedDataForMesh(InMesh);
+					// Update parameters that change during Montage life time. A new play always has to go out.
+					AnimMontage_UpdateReplicatedDataForMesh(InMesh, *RepSlot, /*bForceDirty=*/ true);
+
+					RequestMontageNetUpdate();
 
-					// Force net update on our avatar actor
-					if (AbilityActorInfo->AvatarActor != nullptr)
+					// Keep the position in sync while it plays.
+					if (USMMontageReplicationSubsystem* MontageReplication = USMMontageReplicationSubsystem::Get(GetWorld()))
 					{
-						AbilityActorInfo->AvatarActor->ForceNetUpdate();
+						MontageReplication->RegisterAbilitySystem(this);
 					}
 				}
 			}
@@ -190,81 +375,200 @@ FGameplayAbilityLocalAnimMontageForMesh& USMAbilitySystemComponent::GetLocalAnim
 	return LocalAnimMontageInfoForMeshes.Last();
 }
 
-FGameplayAbilityRepAnimMontageForMesh& USMAbilitySystemComponent::GetGameplayAbilityRepAnimMontageForMesh(
-	USkeletalMeshComponent* InMesh)
+bool USMAbilitySystemComponent::HasActiveReplicatedMontage() const
 {
-	for (FGameplayAbilityRepAnimMontageForMesh& RepMontageInfo : RepAnimMontageInfoForMeshes)
+	for (const FSMRepAnimMontageSlot& RepSlot : RepAnimMontageSlots.Slots)
 	{
-		if (RepMontageInfo.Mesh == InMesh)
+		if (RepSlot.Montage.AnimMontage && !RepSlot.Montage.bIsStopped)
 		{
-			return RepMontageInfo;
+			return true;
 		}
 	}
 
-	FGameplayAbilityRepAnimMontageForMesh RepMontageInfo = FGameplayAbilityRepAnimMontageForMesh(InMesh);
-	RepAnimMontageInfoForMeshes.Add(RepMontageInfo);
-	return RepAnimMontageInfoForMeshes.Last();
+	return false;
 }
 
-void USMAbilitySystemComponent::AnimMontage_UpdateReplicatedDataForMesh(USkeletalMeshComponent* InMesh)
+void USMAbilitySystemComponent::UpdateReplicatedMontagePositions()
 {
 	check(IsOwnerActorAuthoritative());
 
-	AnimMontage_UpdateReplicatedDataForMesh(GetGameplayAbilityRepAnimMontageForMesh(InMesh));
+	for (FSMRepAnimMontageSlot& RepSlot : RepAnimMontageSlots.Slots)
+	{
+		if (RepSlot.Montage.AnimMontage && !RepSlot.Montage.bIsStopped)
+		{
+			AnimMontage_UpdateReplicatedDataForMesh(GetMeshForSlot(RepSlot.MeshType), RepSlot);
+		}
+	}
 }
 
-void USMAbilitySystemComponent::AnimMontage_UpdateReplicatedDataForMesh(FGameplayAbilityRepAnimMontageForMesh& OutRepAnimMontageInfo)
+void USMAbilitySystemComponent::UpdateReplicatedMontageStops()
 {
-	UAnimInstance* AnimInstance = IsValid(OutRepAnimMontageInfo.Mesh) ? OutRepAnimMontageInfo.Mesh->GetAnimInstance() : nullptr;
-	if (AnimInstance && LocalAnimMontageInfo.AnimMontage)
+	check(IsOwnerActorAuthoritative());
+
+	for (FSMRepAnimMontageSlot& RepSlot : RepAnimMontageSlots.Slots)
 	{
-		FGameplayAbilityRepAnimMontage& RepMontageInfo = OutRepAnimMontageInfo.RepMontageInfo;
-		
-		RepMontageInfo.AnimMontage = LocalAnimMontageInfo.AnimMontage;
+		if (!RepSlot.Montage.AnimMontage || RepSlot.Montage.bIsStopped)
+		{
+			continue;
+		}
 
-		// Compressed Flags
-		bool bIsStopped = AnimInstance->Montage_GetIsStopped(LocalAnimMontageInfo.AnimMontage);
+		USkeletalMeshComponent* Mesh = GetMeshForSlot(RepSlot.MeshType);
+		const UAnimInstance* AnimInstance = IsValid(Mesh) ? Mesh->GetAnimInstance() : nullptr;
+		if (!AnimInstance)
+		{
+			continue;
+		}
 
-		if (!bIsStopped)
+		const UAnimMontage* LocalMontage = GetLocalAnimMontageInfoForMesh(Mesh).LocalMontageInfo.AnimMontage;
+		if (LocalMontage && AnimInstance->Montage_GetIsStopped(LocalMontage))
 		{
-			RepMontageInfo.PlayRate = AnimInstance->Montage_GetPlayRate(LocalAnimMontageInfo.AnimMontage);
-			RepMontageInfo.Position = AnimInstance->Montage_GetPosition(LocalAnimMontageInfo.AnimMontage);
-			RepMontageInfo.BlendTime = AnimInstance->Montage_GetBlendTime(LocalAnimMontageInfo.AnimMontage);
+			AnimMontage_UpdateReplicatedDataForMesh(Mesh, RepSlot);
 		}
+	}
+}
+
+void USMAbilitySystemComponent::RequestMontageNetUpdate() const
+{
+	AActor* AvatarActor = GetAvatarActor_Direct();
+	if (!AvatarActor)
+	{
+		return;
+	}
+
+	if (USMMontageReplicationSubsystem* MontageReplication = USMMontageReplicationSubsystem::Get(GetWorld()))
+	{
+		MontageReplication->RequestNetUpdate(AvatarActor);
+	}
+	else
+	{
+		AvatarActor->ForceNetUpdate();
+	}
+}
 
-		if (RepMontageInfo.IsStopped != bIsStopped)
+int32 USMAbilitySystemComponent::GetMeshSlot(const USkeletalMeshComponent* InMesh) const
+{
+	ISMFirstPersonInterface* FirstPersonInterface = Cast<ISMFirstPersonInterface>(GetAvatarActor_Direct());
+	if (!InMesh || !FirstPersonInterface)
+	{
+		return INDEX_NONE;
+	}
+
+	for (int32 Slot = 0; Slot < SMMontageSlots::NumSlots; Slot++)
+	{
+		if (FirstPersonInterface->GetMeshOfType(static_cast<EMeshType>(Slot)) == InMesh)
 		{
-			// Set this prior to calling UpdateShouldTick, so we start ticking if we are playing a Montage
-			RepMontageInfo.IsStopped = bIsStopped;
+			return Slot;
+		}
+	}
 
-			// When we start or stop an animation, update the clients right away for the Avatar Actor
-			if (AbilityActorInfo->AvatarActor != nullptr)
-			{
-				AbilityActorInfo->AvatarActor->ForceNetUpdate();
-			}
+	return INDEX_NONE;
+}
 
-			// When this changes, we should update whether or not we should be ticking
-			UpdateShouldTick();
+USkeletalMeshComponent* USMAbilitySystemComponent::GetMeshForSlot(int32 Slot) const
+{
+	ISMFirstPersonInterface* FirstPersonInterface = Cast<ISMFirstPersonInterface>(GetAvatarActor_Direct());
+	if (!FirstPersonInterface || Slot < 0 || Slot >= SMMontageSlots::NumSlots)
+	{
+		return nullptr;
+	}
+
+	USkeletalMeshComponent* Mesh = FirstPersonInterface->GetMeshOfType(static_cast<EMeshType>(Slot));
+	return Mesh && Mesh->GetOwner() == AbilityActorInfo->AvatarActor ? Mesh : nullptr;
+}
+
+FSMRepAnimMontageSlot* USMAbilitySystemComponent::GetRepAnimMontageSlotForMesh(USkeletalMeshComponent* InMesh)
+{
+	const int32 Slot = GetMeshSlot(InMesh);
+	if (Slot == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	// Every slot is added up front, so slot N stays at index N.
+	if (RepAnimMontageSlots.Slots.Num() == 0)
+	{
+		RepAnimMontageSlots.Slots.SetNum(SMMontageSlots::NumSlots);
+		for (int32 SlotIdx = 0; SlotIdx < SMMontageSlots::NumSlots; SlotIdx++)
+		{
+			RepAnimMontageSlots.Slots[SlotIdx].MeshType = static_cast<uint8>(SlotIdx);
+			RepAnimMontageSlots.MarkItemDirty(RepAnimMontageSlots.Slots[SlotIdx]);
 		}
+	}
+
+	return &RepAnimMontageSlots.Slots[Slot];
+}
+
+void USMAbilitySystemComponent::AnimMontage_UpdateReplicatedDataForMesh(USkeletalMeshComponent* InMesh)
+{
+	check(IsOwnerActorAuthoritative());
+
+	if (FSMRepAnimMontageSlot* RepSlot = GetRepAnimMontageSlotForMesh(InMesh))
+	{
+		AnimMontage_UpdateReplicatedDataForMesh(InMesh, *RepSlot);
+	}
+}
 
-		// Replicate NextSectionID to keep it in sync.
-		// We actually replicate NextSectionID+1 on a BYTE to put INDEX_NONE in there.
-		int32 CurrentSectionID = LocalAnimMontageInfo.AnimMontage->GetSectionIndexFromPosition(RepMontageInfo.Position);
-		if (CurrentSectionID != INDEX_NONE)
+void USMAbilitySystemComponent::AnimMontage_UpdateReplicatedDataForMesh(USkeletalMeshComponent* InMesh, FSMRepAnimMontageSlot& RepSlot, bool bForceDirty)
+{
+	UAnimInstance* AnimInstance = IsValid(InMesh) ? InMesh->GetAnimInstance() : nullptr;
+	UAnimMontage* LocalMontage = GetLocalAnimMontageInfoForMesh(InMesh).LocalMontageInfo.AnimMontage;
+	if (!AnimInstance || !LocalMontage)
+	{
+		if (bForceDirty)
 		{
-			int32 NextSectionID = AnimInstance->Montage_GetNextSectionID(LocalAnimMontageInfo.AnimMontage, CurrentSectionID);
-			if (NextSectionID >= (256 - 1))
-			{
-				UE_LOG(LogTemp,  Error, TEXT("AnimMontage_UpdateReplicatedData. NextSectionID = %d.  RepAnimMontageInfo.Position: %.2f, CurrentSectionID: %d. LocalAnimMontageInfo.AnimMontage %s"), 
-					NextSectionID, RepMontageInfo.Position, CurrentSectionID, *GetNameSafe(LocalAnimMontageInfo.AnimMontage) );
-				ensure(NextSectionID < (256 - 1));
-			}
-			RepMontageInfo.NextSectionID = uint8(NextSectionID + 1);
+			RepAnimMontageSlots.MarkItemDirty(RepSlot);
 		}
-		else
+		return;
+	}
+
+	FSMRepAnimMontage RepMontage = RepSlot.Montage;
+	RepMontage.AnimMontage = LocalMontage;
+
+	// Compressed Flags
+	RepMontage.bIsStopped = AnimInstance->Montage_GetIsStopped(LocalMontage);
+
+	if (!RepMontage.bIsStopped)
+	{
+		RepMontage.PlayRate = AnimInstance->Montage_GetPlayRate(LocalMontage);
+		RepMontage.Position = AnimInstance->Montage_GetPosition(LocalMontage);
+		RepMontage.BlendTime = AnimInstance->Montage_GetBlendTime(LocalMontage);
+	}
+
+	// Replicate NextSectionID to keep it in sync.
+	// We actually replicate NextSectionID+1 on a BYTE to put INDEX_NONE in there.
+	int32 CurrentSectionID = LocalMontage->GetSectionIndexFromPosition(RepMontage.Position);
+	if (CurrentSectionID != INDEX_NONE)
+	{
+		int32 NextSectionID = AnimInstance->Montage_GetNextSectionID(LocalMontage, CurrentSectionID);
+		if (NextSectionID >= (256 - 1))
 		{
-			RepMontageInfo.NextSectionID = 0;
+			UE_LOG(LogTemp,  Error, TEXT("AnimMontage_UpdateReplicatedData. NextSectionID = %d.  RepAnimMontageInfo.Position: %.2f, CurrentSectionID: %d. LocalAnimMontageInfo.AnimMontage %s"), 
+				NextSectionID, RepMontage.Position, CurrentSectionID, *GetNameSafe(LocalMontage) );
+			ensure(NextSectionID < (256 - 1));
 		}
+		RepMontage.NextSectionID = uint8(NextSectionID + 1);
+	}
+	else
+	{
+		RepMontage.NextSectionID = 0;
+	}
+
+	RepMontage.Quantize();
+
+	const bool bStoppedChanged = RepSlot.Montage.bIsStopped != RepMontage.bIsStopped;
+	if (bForceDirty || RepSlot.Montage != RepMontage)
+	{
+		RepSlot.Montage = RepMontage;
+		RepAnimMontageSlots.MarkItemDirty(RepSlot);
+	}
+
+	if (bStoppedChanged)
+	{
+		// When we start or stop an animation, update the clients right away for the Avatar Actor
+		RequestMontageNetUpdate();
+
+		// When this changes, we should update whether or not we should be ticking
+		UpdateShouldTick();
 	}
 }
 
@@ -307,6 +611,8 @@ void USMAbilitySystemComponent::RemoveGameplayCueLocal(const FGameplayTag Gamepl
 
 void USMAbilitySystemComponent::OnGiveAbility(FGameplayAbilitySpec& AbilitySpec)
 {
+	AddToAbilityTagIndex(AbilitySpec);
+
 	USMGameplayAbility* ability = Cast<USMGameplayAbility>(AbilitySpec.Ability);
 	if (ability && GetNetMode() != NM_DedicatedServer) // @TODO: stop this code running on listen servers for simulated proxies
 	{
@@ -317,25 +623,15 @@ void USMAbilitySystemComponent::OnGiveAbility(FGameplayAbilitySpec& AbilitySpec)
 			return;
 		}
 
-		// Bind the Input Action to the AbilityLocalInputX functions with the correct InputIDs
+		// Route the Input Action to this spec, the input component only binds actions it hasn't seen yet
 		OwnerPlayerInputComponent = GetInputComponent();
 		if (OwnerPlayerInputComponent)
 		{
-			FAbilityInput inputStruct;
-
-			AbilitySpec.InputID = GetNextInputID();
-			inputStruct.InputID = AbilitySpec.InputID;
-
-			inputStruct.PressedHandle = OwnerPlayerInputComponent->BindAction(ability->InputAction, ETriggerEvent::Started, this, &UAbilitySystemComponent::AbilityLocalInputPressed, AbilitySpec.InputID).GetHandle();
-			inputStruct.ReleasedHandle = OwnerPlayerInputComponent->BindAction(ability->InputAction, ETriggerEvent::Completed,this, &UAbilitySystemComponent::AbilityLocalInputReleased, AbilitySpec.InputID).GetHandle();
-			// We may not need to bind for ETriggerEvent::Cancelled, but this is an attempt to fix a strange buug.
-			inputStruct.CancelledHandle = OwnerPlayerInputComponent->BindAction(ability->InputAction, ETriggerEvent::Canceled,this, &UAbilitySystemComponent::AbilityLocalInputReleased, AbilitySpec.InputID).GetHandle();
-
-			AbilityInputArray.AddUnique(inputStruct);
+			OwnerPlayerInputComponent->AddAbilityInput(ability->InputAction, AbilitySpec.Handle, this);
 		}
 		else
 		{
-			UE_LOG(LogTemp, Error, TEXT("InputComponent not found in OnGiveAbility in %s"), *GetNameSafe(this))
+			UE_LOG(LogTemp, Error, TEXT("SMEnhancedInputComponent not found in OnGiveAbility in %s"), *GetNameSafe(this))
 		}
 	}
 
@@ -345,187 +641,275 @@ void USMAbilitySystemComponent::OnGiveAbility(FGameplayAbilitySpec& AbilitySpec)
 void USMAbilitySystemComponent::OnRemoveAbility(FGameplayAbilitySpec& AbilitySpec)
 {
 	Super::OnRemoveAbility(AbilitySpec);
+
+	RemoveFromAbilityTagIndex(AbilitySpec);
 	
 	if (bCachedIsNetSimulated && GetNetMode() == NM_DedicatedServer)
 	{
 		return;
 	}
 
-	// @TODO: how the fuck is this nullptr, the debugger shows that the cast is successful?????? HELLO???
-	// (game will still work for now, but the input component will never unbind old abilities).
-	
-	UEnhancedInputComponent* inputComponent = GetInputComponent();
-	if (inputComponent == nullptr)
+	if (USMEnhancedInputComponent* inputComponent = GetInputComponent())
+	{
+		inputComponent->RemoveAbilityInput(AbilitySpec.Handle);
+	}
+}
+
+void USMAbilitySystemComponent::AbilityHandleInputPressed(FGameplayAbilitySpecHandle Handle)
+{
+	ABILITYLIST_SCOPE_LOCK();
+	FGameplayAbilitySpec* Spec = FindAbilitySpecFromHandle(Handle);
+	if (!Spec || !Spec->Ability)
 	{
-		UE_LOG(LogTemp, Error, TEXT("inputComponent in OnRemoveAbility returned nullptr in %s. Has the owner changed or something somehow? Server/Client: %i"), *GetNameSafe(this), (int32)bCachedIsNetSimulated)
 		return;
 	}
 
-	for (const FAbilityInput abilityInput : AbilityInputArray)
+	Spec->InputPressed = true;
+	if (Spec->IsActive())
 	{
-		FGameplayAbilitySpec* spec = FindAbilitySpecFromHandle(abilityInput.Handle);
-		if (spec)
+		if (Spec->Ability->bReplicateInputDirectly && IsOwnerActorAuthoritative() == false)
 		{
-			if (spec->InputID == abilityInput.InputID)
-			{
-				inputComponent->RemoveBindingByHandle(abilityInput.PressedHandle);
-				inputComponent->RemoveBindingByHandle(abilityInput.ReleasedHandle);
-				inputComponent->RemoveBindingByHandle(abilityInput.CancelledHandle);
-
-				AbilityInputArray.Remove(abilityInput);
-				break;
-			}
+			ServerSetInputPressed(Spec->Handle);
 		}
+
+		AbilitySpecInputPressed(*Spec);
+
+		// Invoke the InputPressed event. This is not replicated here. If someone is listening, they may replicate the InputPressed event to the server.
+		InvokeReplicatedEvent(EAbilityGenericReplicatedEvent::InputPressed, Spec->Handle, Spec->ActivationInfo.GetActivationPredictionKey());
+	}
+	else
+	{
+		// Ability is not active, so try to activate it
+		TryActivateAbility(Spec->Handle);
 	}
 }
 
-void USMAbilitySystemComponent::OnRep_ReplicatedAnimMontageForMesh()
+void USMAbilitySystemComponent::AbilityHandleInputReleased(FGameplayAbilitySpecHandle Handle)
 {
-	for (FGameplayAbilityRepAnimMontageForMesh& NewRepMontageInfoForMesh : RepAnimMontageInfoForMeshes)
+	ABILITYLIST_SCOPE_LOCK();
+	FGameplayAbilitySpec* Spec = FindAbilitySpecFromHandle(Handle);
+	if (!Spec)
 	{
-		UWorld* World = GetWorld();
+		return;
+	}
 
-		FGameplayAbilityRepAnimMontageForMesh& AnimMontageInfo = GetGameplayAbilityRepAnimMontageForMesh(NewRepMontageInfoForMesh.Mesh);
-		FGameplayAbilityRepAnimMontage& RepAnimMontage = AnimMontageInfo.RepMontageInfo;
-		
-		if (RepAnimMontage.bSkipPlayRate)
+	Spec->InputPressed = false;
+	if (Spec->Ability && Spec->IsActive())
+	{
+		if (Spec->Ability->bReplicateInputDirectly && IsOwnerActorAuthoritative() == false)
 		{
-			GetGameplayAbilityRepAnimMontageForMesh(NewRepMontageInfoForMesh.Mesh).RepMontageInfo.PlayRate = 1.f;
+			ServerSetInputReleased(Spec->Handle);
 		}
 
-		const bool bIsPlayingReplay = World && World->IsPlayingReplay();
+		AbilitySpecInputReleased(*Spec);
 
-		const float MONTAGE_REP_POS_ERR_THRESH = bIsPlayingReplay ? CVarReplayMontageErrorThreshold.GetValueOnGameThread() : 0.1f;
+		InvokeReplicatedEvent(EAbilityGenericReplicatedEvent::InputReleased, Spec->Handle, Spec->ActivationInfo.GetActivationPredictionKey());
+	}
+}
 
-		UAnimInstance* AnimInstance = IsValid(NewRepMontageInfoForMesh.Mesh) && NewRepMontageInfoForMesh.Mesh->GetOwner()
-			== AbilityActorInfo->AvatarActor ? NewRepMontageInfoForMesh.Mesh->GetAnimInstance() : nullptr;
-		if (AnimInstance == nullptr || !IsReadyForReplicatedMontageForMesh(NewRepMontageInfoForMesh.Mesh))
+void USMAbilitySystemComponent::AddToAbilityTagIndex(const FGameplayAbilitySpec& AbilitySpec)
+{
+	if (!AbilitySpec.Ability)
+	{
+		return;
+	}
+
+	// Parents too, so looking up a parent tag finds the same specs HasAll would match
+	for (const FGameplayTag& Tag : AbilitySpec.Ability->AbilityTags.GetGameplayTagParents())
+	{
+		AbilityTagIndex.AddUnique(Tag, AbilitySpec.Handle);
+	}
+}
+
+void USMAbilitySystemComponent::RemoveFromAbilityTagIndex(const FGameplayAbilitySpec& AbilitySpec)
+{
+	if (!AbilitySpec.Ability)
+	{
+		return;
+	}
+
+	for (const FGameplayTag& Tag : AbilitySpec.Ability->AbilityTags.GetGameplayTagParents())
+	{
+		AbilityTagIndex.RemoveSingle(Tag, AbilitySpec.Handle);
+	}
+}
+
+void USMAbilitySystemComponent::FindSpecsByTag(const FGameplayTag& Tag, TArray<FGameplayAbilitySpecHandle>& OutHandles) const
+{
+	AbilityTagIndex.MultiFind(Tag, OutHandles);
+}
+
+bool USMAbilitySystemComponent::TryActivateAbilityByTagFast(const FGameplayTag& Tag, bool bAllowRemoteActivation)
+{
+	// Copied out first, activating an ability can give or remove abilities
+	TArray<FGameplayAbilitySpecHandle, TInlineAllocator<4>> Handles;
+	for (auto It = AbilityTagIndex.CreateConstKeyIterator(Tag); It; ++It)
+	{
+		Handles.Add(It.Value());
+	}
+
+	bool bSuccess = false;
+	for (const FGameplayAbilitySpecHandle& Handle : Handles)
+	{
+		// Same filter as TryActivateAbilitiesByTag, so blocked abilities don't report failed activations
+		const FGameplayAbilitySpec* Spec = FindAbilitySpecFromHandle(Handle);
+		if (Spec && Spec->Ability && Spec->Ability->DoesAbilitySatisfyTagRequirements(*this))
 		{
-			// We can't handle this yet
-			bPendingMontageRep = true;
-			return;
+			bSuccess |= TryActivateAbility(Handle, bAllowRemoteActivation);
 		}
-		bPendingMontageRep = false;
+	}
+
+	return bSuccess;
+}
 
-		if (!AbilityActorInfo->IsLocallyControlled())
+void USMAbilitySystemComponent::OnRep_AnimMontageSlot(const FSMRepAnimMontageSlot& RepSlot)
+{
+	const FSMRepAnimMontage& RepMontage = RepSlot.Montage;
+
+	UWorld* World = GetWorld();
+	const bool bIsPlayingReplay = World && World->IsPlayingReplay();
+
+	const float MONTAGE_REP_POS_ERR_THRESH = bIsPlayingReplay ? CVarReplayMontageErrorThreshold.GetValueOnGameThread() : 0.1f;
+
+	USkeletalMeshComponent* Mesh = GetMeshForSlot(RepSlot.MeshType);
+	UAnimInstance* AnimInstance = IsValid(Mesh) ? Mesh->GetAnimInstance() : nullptr;
+	if (AnimInstance == nullptr || !IsReadyForReplicatedMontageForMesh(Mesh))
+	{
+		// We can't handle this yet
+		PendingMontageSlots |= 1 << RepSlot.MeshType;
+		return;
+	}
+	PendingMontageSlots &= ~(1 << RepSlot.MeshType);
+
+	if (AbilityActorInfo->IsLocallyControlled())
+	{
+		return;
+	}
+
+	FGameplayAbilityLocalAnimMontage& LocalMontageInfo = GetLocalAnimMontageInfoForMesh(Mesh).LocalMontageInfo;
+
+	static const auto CVar = IConsoleManager::Get().FindTConsoleVariableDataInt(TEXT("net.Montage.Debug"));
+	bool DebugMontage = (CVar && CVar->GetValueOnGameThread() == 1);
+	if (DebugMontage)
+	{
+		UE_LOG(LogTemp,  Warning, TEXT("\n\nOnRep_AnimMontageSlot, %s, slot %d"), *GetNameSafe(this), RepSlot.MeshType);
+		UE_LOG(LogTemp,  Warning, TEXT("\tAnimMontage: %s\n\tPlayRate: %f\n\tPosition: %f\n\tBlendTime: %f\n\tNextSectionID: %d\n\tIsStopped: %d\n\tPlayInstanceId: %d"),
+			*GetNameSafe(RepMontage.AnimMontage),
+			RepMontage.PlayRate,
+			RepMontage.Position,
+			RepMontage.BlendTime,
+			RepMontage.NextSectionID,
+			RepMontage.bIsStopped,
+			RepMontage.PlayInstanceId);
+		UE_LOG(LogTemp, Warning, TEXT("\tLocalAnimMontageInfo.AnimMontage: %s\n\tPosition: %f"),
+			*GetNameSafe(LocalMontageInfo.AnimMontage), AnimInstance->Montage_GetPosition(LocalMontageInfo.AnimMontage));
+	}
+
+	if (!RepMontage.AnimMontage)
+	{
+		return;
+	}
+
+	// New Montage to play
+	if ((LocalMontageInfo.AnimMontage != RepMontage.AnimMontage) || (LocalMontageInfo.PlayInstanceId != RepMontage.PlayInstanceId))
+	{
+		LocalMontageInfo.PlayInstanceId = RepMontage.PlayInstanceId;
+		PlayMontageSimulatedForMesh(Mesh, RepMontage.AnimMontage, RepMontage.PlayRate);
+	}
+
+	UAnimMontage* Montage = LocalMontageInfo.AnimMontage;
+	if (Montage == nullptr)
+	{ 
+		UE_LOG(LogTemp, Warning, TEXT("OnRep_AnimMontageSlot: PlayMontageSimulated failed. Name: %s, AnimMontage: %s"), *GetNameSafe(this), *GetNameSafe(RepMontage.AnimMontage));
+		return;
+	}
+
+	// Play Rate has changed
+	if (AnimInstance->Montage_GetPlayRate(Montage) != RepMontage.PlayRate)
+	{
+		AnimInstance->Montage_SetPlayRate(Montage, RepMontage.PlayRate);
+	}
+
+	const int32 SectionIdToPlay = (static_cast<int32>(RepMontage.SectionIdToPlay) - 1);
+	if (SectionIdToPlay != INDEX_NONE)
+	{
+		FName SectionNameToJumpTo = Montage->GetSectionName(SectionIdToPlay);
+		if (SectionNameToJumpTo != NAME_None)
 		{
-			static const auto CVar = IConsoleManager::Get().FindTConsoleVariableDataInt(TEXT("net.Montage.Debug"));
-			bool DebugMontage = (CVar && CVar->GetValueOnGameThread() == 1);
-			if (DebugMontage)
-			{
-				UE_LOG(LogTemp,  Warning, TEXT("\n\nOnRep_ReplicatedAnimMontageForMesh, %s"), *GetNameSafe(this));
-				UE_LOG(LogTemp,  Warning, TEXT("\tAnimMontage: %s\n\tPlayRate: %f\n\tPosition: %f\n\tBlendTime: %f\n\tNextSectionID: %d\n\tIsStopped: %d\n\tPlayInstanceId: %d"),
-					*GetNameSafe(RepAnimMontage.AnimMontage),
-					RepAnimMontage.PlayRate,
-					RepAnimMontage.Position,
-					RepAnimMontage.BlendTime,
-					RepAnimMontage.NextSectionID,
-					RepAnimMontage.IsStopped,
-					RepAnimMontage.PlayInstanceId);
-				UE_LOG(LogTemp, Warning, TEXT("\tLocalAnimMontageInfo.AnimMontage: %s\n\tPosition: %f"),
-					*GetNameSafe(RepAnimMontage.AnimMontage), AnimInstance->Montage_GetPosition(RepAnimMontage.AnimMontage));
-			}
+			AnimInstance->Montage_JumpToSection(SectionNameToJumpTo);
+		}
+	}
 
-			if (NewRepMontageInfoForMesh.RepMontageInfo.AnimMontage)
-			{
-				// New Montage to play
-				if ((RepAnimMontage.AnimMontage != NewRepMontageInfoForMesh.RepMontageInfo.AnimMontage) || 
-				    (RepAnimMontage.PlayInstanceId != NewRepMontageInfoForMesh.RepMontageInfo.PlayInstanceId))
-				{
-					RepAnimMontage.PlayInstanceId = NewRepMontageInfoForMesh.RepMontageInfo.PlayInstanceId;
-					PlayMontageSimulatedForMesh(NewRepMontageInfoForMesh.Mesh, NewRepMontageInfoForMesh.RepMontageInfo.AnimMontage, NewRepMontageInfoForMesh.RepMontageInfo.PlayRate);
-				}
+	// Compressed Flags
+	const bool bIsStopped = AnimInstance->Montage_GetIsStopped(Montage);
 
-				if (RepAnimMontage.AnimMontage == nullptr)
-				{ 
-					UE_LOG(LogTemp, Warning, TEXT("OnRep_ReplicatedAnimMontage: PlayMontageSimulated failed. Name: %s, AnimMontage: %s"), *GetNameSafe(this), *GetNameSafe(NewRepMontageInfoForMesh.RepMontageInfo.AnimMontage));
-					return;
-				}
+	// Process stopping first, so we don't change sections and cause blending to pop.
+	if (RepMontage.bIsStopped)
+	{
+		if (!bIsStopped)
+		{
+			CurrentMontageStopForMesh(Mesh, RepMontage.BlendTime);
+		}
+		return;
+	}
 
-				// Play Rate has changed
-				if (AnimInstance->Montage_GetPlayRate(RepAnimMontage.AnimMontage) != NewRepMontageInfoForMesh.RepMontageInfo.PlayRate)
-				{
-					AnimInstance->Montage_SetPlayRate(RepAnimMontage.AnimMontage, NewRepMontageInfoForMesh.RepMontageInfo.PlayRate);
-				}
+	// Far away viewers only follow starts and stops, position corrections aren't worth it there.
+	const USMMontageReplicationSubsystem* MontageReplication = USMMontageReplicationSubsystem::Get(World);
+	if (MontageReplication && !MontageReplication->IsWithinPositionSyncRange(Mesh->GetComponentLocation()))
+	{
+		return;
+	}
 
-				const int32 SectionIdToPlay = (static_cast<int32>(NewRepMontageInfoForMesh.RepMontageInfo.SectionIdToPlay) - 1);
-				if (SectionIdToPlay != INDEX_NONE)
-				{
-					FName SectionNameToJumpTo = RepAnimMontage.AnimMontage->GetSectionName(SectionIdToPlay);
-					if (SectionNameToJumpTo != NAME_None)
-					{
-						AnimInstance->Montage_JumpToSection(SectionNameToJumpTo);
-					}
-				}
+	const int32 RepSectionID = Montage->GetSectionIndexFromPosition(RepMontage.Position);
+	const int32 RepNextSectionID = int32(RepMontage.NextSectionID) - 1;
 
-				// Compressed Flags
-				const bool bIsStopped = AnimInstance->Montage_GetIsStopped(RepAnimMontage.AnimMontage);
-				const bool bReplicatedIsStopped = bool(NewRepMontageInfoForMesh.RepMontageInfo.IsStopped);
+	// And NextSectionID for the replicated SectionID.
+	if( RepSectionID != INDEX_NONE )
+	{
+		const int32 NextSectionID = AnimInstance->Montage_GetNextSectionID(Montage, RepSectionID);
 
-				// Process stopping first, so we don't change sections and cause blending to pop.
-				if (bReplicatedIsStopped)
-				{
-					if (!bIsStopped)
-					{
-						CurrentMontageStopForMesh(NewRepMontageInfoForMesh.Mesh, NewRepMontageInfoForMesh.RepMontageInfo.BlendTime);
-					}
-				}
-				else if (!NewRepMontageInfoForMesh.RepMontageInfo.SkipPositionCorrection)
-				{
-					const int32 RepSectionID = RepAnimMontage.AnimMontage->GetSectionIndexFromPosition(NewRepMontageInfoForMesh.RepMontageInfo.Position);
-					const int32 RepNextSectionID = int32(NewRepMontageInfoForMesh.RepMontageInfo.NextSectionID) - 1;
-			
-					// And NextSectionID for the replicated SectionID.
-					if( RepSectionID != INDEX_NONE )
-					{
-						const int32 NextSectionID = AnimInstance->Montage_GetNextSectionID(RepAnimMontage.AnimMontage, RepSectionID);
-
-						// If NextSectionID is different than the replicated one, then set it.
-						if( NextSectionID != RepNextSectionID )
-						{
-							AnimInstance->Montage_SetNextSection(RepAnimMontage.AnimMontage->GetSectionName(RepSectionID), RepAnimMontage.AnimMontage->GetSectionName(RepNextSectionID), RepAnimMontage.AnimMontage);
-						}
-
-						// Make sure we haven't received that update too late and the client hasn't already jumped to another section. 
-						const int32 CurrentSectionID = RepAnimMontage.AnimMontage->GetSectionIndexFromPosition(AnimInstance->Montage_GetPosition(RepAnimMontage.AnimMontage));
-						if ((CurrentSectionID != RepSectionID) && (CurrentSectionID != RepNextSectionID))
-						{
-							// Client is in a wrong section, teleport him into the begining of the right section
-							const float SectionStartTime = RepAnimMontage.AnimMontage->GetAnimCompositeSection(RepSectionID).GetTime();
-							AnimInstance->Montage_SetPosition(RepAnimMontage.AnimMontage, SectionStartTime);
-						}
-					}
+		// If NextSectionID is different than the replicated one, then set it.
+		if( NextSectionID != RepNextSectionID )
+		{
+			AnimInstance->Montage_SetNextSection(Montage->GetSectionName(RepSectionID), Montage->GetSectionName(RepNextSectionID), Montage);
+		}
+
+		// Make sure we haven't received that update too late and the client hasn't already jumped to another section. 
+		const int32 CurrentSectionID = Montage->GetSectionIndexFromPosition(AnimInstance->Montage_GetPosition(Montage));
+		if ((CurrentSectionID != RepSectionID) && (CurrentSectionID != RepNextSectionID))
+		{
+			// Client is in a wrong section, teleport him into the begining of the right section
+			const float SectionStartTime = Montage->GetAnimCompositeSection(RepSectionID).GetTime();
+			AnimInstance->Montage_SetPosition(Montage, SectionStartTime);
+		}
+	}
 
-					// Update Position. If error is too great, jump to replicated position.
-					const float CurrentPosition = AnimInstance->Montage_GetPosition(RepAnimMontage.AnimMontage);
-					const int32 CurrentSectionID = RepAnimMontage.AnimMontage->GetSectionIndexFromPosition(CurrentPosition);
-					const float DeltaPosition = NewRepMontageInfoForMesh.RepMontageInfo.Position - CurrentPosition;
+	// Update Position. If error is too great, jump to replicated position.
+	const float CurrentPosition = AnimInstance->Montage_GetPosition(Montage);
+	const int32 CurrentSectionID = Montage->GetSectionIndexFromPosition(CurrentPosition);
+	const float DeltaPosition = RepMontage.Position - CurrentPosition;
 
-					// Only check threshold if we are located in the same section. Different sections require a bit more work as we could be jumping around the timeline.
-					// And therefore DeltaPosition is not as trivial to determine.
-					if ((CurrentSectionID == RepSectionID) && (FMath::Abs(DeltaPosition) > MONTAGE_REP_POS_ERR_THRESH) && (NewRepMontageInfoForMesh.RepMontageInfo.IsStopped == 0))
-					{
-						// fast forward to server position and trigger notifies
-						if (FAnimMontageInstance* MontageInstance = AnimInstance->GetActiveInstanceForMontage(NewRepMontageInfoForMesh.RepMontageInfo.AnimMontage))
-						{
-							// Skip triggering notifies if we're going backwards in time, we've already triggered them.
-							const float DeltaTime = !FMath::IsNearlyZero(NewRepMontageInfoForMesh.RepMontageInfo.PlayRate) ? (DeltaPosition / NewRepMontageInfoForMesh.RepMontageInfo.PlayRate) : 0.f;
-							if (DeltaTime >= 0.f)
-							{
-								MontageInstance->UpdateWeight(DeltaTime);
-								MontageInstance->HandleEvents(CurrentPosition, NewRepMontageInfoForMesh.RepMontageInfo.Position, nullptr);
-								AnimInstance->TriggerAnimNotifies(DeltaTime);
-							}
-						}
-						AnimInstance->Montage_SetPosition(RepAnimMontage.AnimMontage, NewRepMontageInfoForMesh.RepMontageInfo.Position);
-					}
-				}
+	// Only check threshold if we are located in the same section. Different sections require a bit more work as we could be jumping around the timeline.
+	// And therefore DeltaPosition is not as trivial to determine.
+	if ((CurrentSectionID == RepSectionID) && (FMath::Abs(DeltaPosition) > MONTAGE_REP_POS_ERR_THRESH))
+	{
+		// fast forward to server position and trigger notifies
+		if (FAnimMontageInstance* MontageInstance = AnimInstance->GetActiveInstanceForMontage(Montage))
+		{
+			// Skip triggering notifies if we're going backwards in time, we've already triggered them.
+			const float DeltaTime = !FMath::IsNearlyZero(RepMontage.PlayRate) ? (DeltaPosition / RepMontage.PlayRate) : 0.f;
+			if (DeltaTime >= 0.f)
+			{
+				MontageInstance->UpdateWeight(DeltaTime);
+				MontageInstance->HandleEvents(CurrentPosition, RepMontage.Position, nullptr);
+				AnimInstance->TriggerAnimNotifies(DeltaTime);
 			}
 		}
+		AnimInstance->Montage_SetPosition(Montage, RepMontage.Position);
 	}
 }
 
-UEnhancedInputComponent* USMAbilitySystemComponent::GetInputComponent() const
+USMEnhancedInputComponent* USMAbilitySystemComponent::GetInputComponent() const
 {
 	// I don't want to cast each time we want to get the InputComponent, i'd rather sacrifice for an extra nullptr check instead of a cast each time to get it.
 
@@ -541,7 +925,7 @@ UEnhancedInputComponent* USMAbilitySystemComponent::GetInputComponent() const
 		{
 			if (APlayerController* controller = Cast<APlayerController>(state->GetPlayerController()))
 			{
-				return Cast<UEnhancedInputComponent>(controller->InputComponent.Get());
+				return Cast<USMEnhancedInputComponent>(controller->InputComponent.Get());
 			}
 		}
 	}
@@ -553,5 +937,5 @@ void USMAbilitySystemComponent::GetLifetimeReplicatedProps(TArray<FLifetimePrope
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(USMAbilitySystemComponent, RepAnimMontageInfoForMeshes);
+	DOREPLIFETIME(USMAbilitySystemComponent, RepAnimMontageSlots);
 }
\ No newline at end of file
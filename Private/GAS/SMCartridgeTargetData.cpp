@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GAS/SMCartridgeTargetData.h"
+
+#include "Components/SkinnedMeshComponent.h"
+#include "GAS/SMPelletDirections.h"
+#include "Settings/SMCombatSettings.h"
+
+// Bits of the per pellet flags byte, so optional fields are only sent when set.
+namespace SMPelletFlags
+{
+	static constexpr uint8 Hit = 1 << 0;
+	static constexpr uint8 HasComponent = 1 << 1;
+	static constexpr uint8 HasBone = 1 << 2;
+	static constexpr uint8 HasPhysicalMaterial = 1 << 3;
+}
+
+void FSMCartridgeTargetData::SetAim(const FVector& aimDirection, float spreadAngle)
+{
+	const FRotator aimRotation = aimDirection.Rotation();
+	AimPitch = FRotator::CompressAxisToShort(aimRotation.Pitch);
+	AimYaw = FRotator::CompressAxisToShort(aimRotation.Yaw);
+
+	SpreadAngleCentidegrees = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(spreadAngle * 100.0f), 0, static_cast<int32>(MAX_uint16)));
+}
+
+FVector FSMCartridgeTargetData::GetAimDirection() const
+{
+	return FRotator(FRotator::DecompressAxisFromShort(AimPitch), FRotator::DecompressAxisFromShort(AimYaw), 0.0f).Vector();
+}
+
+float FSMCartridgeTargetData::GetSpreadAngle() const
+{
+	return SpreadAngleCentidegrees * 0.01f;
+}
+
+void FSMCartridgeTargetData::SetInterpolationDelay(float interpolationDelay)
+{
+	InterpolationDelayMs = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(interpolationDelay * 1000.0f), 0, static_cast<int32>(MAX_uint8)));
+}
+
+float FSMCartridgeTargetData::GetInterpolationDelay() const
+{
+	return InterpolationDelayMs * 0.001f;
+}
+
+void FSMCartridgeTargetData::AddHit(const FHitResult& hit, int32 pelletIdx, const FGameplayTag& hitZone)
+{
+	FSMPelletHit& pellet = Pellets.AddDefaulted_GetRef();
+	pellet.PelletIndex = static_cast<uint8>(pelletIdx);
+	pellet.HitZone = hitZone;
+	pellet.bHit = hit.bBlockingHit || hit.HasValidHitObjectHandle();
+	pellet.ImpactPoint = pellet.bHit ? hit.ImpactPoint : hit.TraceEnd;
+	pellet.Distance = static_cast<uint32>(FMath::Max(FMath::RoundToInt(FVector::Dist(Origin, pellet.ImpactPoint)), 0));
+
+	if (!pellet.bHit)
+	{
+		return;
+	}
+
+	UPrimitiveComponent* hitComponent = hit.GetComponent();
+	pellet.HitComponent = hitComponent;
+
+	if (const USkinnedMeshComponent* skinnedMesh = Cast<USkinnedMeshComponent>(hitComponent))
+	{
+		pellet.BoneIndex = static_cast<int16>(skinnedMesh->GetBoneIndex(hit.BoneName));
+	}
+
+	pellet.PhysicalMaterialIndex = GetDefault<USMCombatSettings>()->GetPhysicalMaterialIndex(hit.PhysMaterial.Get());
+}
+
+int32 FSMCartridgeTargetData::FindPelletStop(TConstArrayView<FHitResult> hits, TFunctionRef<bool(const FHitResult&)> canTakeDamage)
+{
+	// Hitbox and sweep hits get merged into the trace results, so they aren't always sorted by distance
+	int32 stopIdx = INDEX_NONE;
+	for (int32 hitIdx = 0; hitIdx < hits.Num(); ++hitIdx)
+	{
+		const FHitResult& hit = hits[hitIdx];
+		if (stopIdx != INDEX_NONE && hit.Distance >= hits[stopIdx].Distance)
+		{
+			continue;
+		}
+
+		if (hit.bBlockingHit || canTakeDamage(hit))
+		{
+			stopIdx = hitIdx;
+		}
+	}
+
+	return stopIdx;
+}
+
+void FSMCartridgeTargetData::RemoveDuplicatePellets(int32 numPellets, TFunctionRef<bool(const FSMPelletHit&)> canTakeDamage)
+{
+	// Entry kept for every pellet index, and one bit per pellet index once that entry can take damage
+	TArray<int32, TInlineAllocator<16>> keptEntries;
+	keptEntries.Init(INDEX_NONE, FMath::Clamp(numPellets, 0, MAX_uint8 + 1));
+	uint64 damageablePellets[4] = {};
+
+	for (int32 entryIdx = 0; entryIdx < Pellets.Num(); ++entryIdx)
+	{
+		const FSMPelletHit& pellet = Pellets[entryIdx];
+		uint64& damageableWord = damageablePellets[pellet.PelletIndex >> 6];
+		const uint64 pelletBit = 1ull << (pellet.PelletIndex & 63);
+		if (!keptEntries.IsValidIndex(pellet.PelletIndex) || (damageableWord & pelletBit) != 0)
+		{
+			continue;
+		}
+
+		int32& keptEntry = keptEntries[pellet.PelletIndex];
+		if (canTakeDamage(pellet))
+		{
+			keptEntry = entryIdx;
+			damageableWord |= pelletBit;
+		}
+		else if (keptEntry == INDEX_NONE)
+		{
+			keptEntry = entryIdx;
+		}
+	}
+
+	// RemoveAll visits the entries in order
+	int32 entryIdx = 0;
+	Pellets.RemoveAll([&keptEntries, &entryIdx](const FSMPelletHit& pellet)
+	{
+		const int32 thisEntryIdx = entryIdx++;
+		return !keptEntries.IsValidIndex(pellet.PelletIndex) || keptEntries[pellet.PelletIndex] != thisEntryIdx;
+	});
+}
+
+void FSMCartridgeTargetData::RebuildImpactPoints(const FSMPelletDirections& pelletDirections)
+{
+	for (FSMPelletHit& pellet : Pellets)
+	{
+		if (!pelletDirections.IsValidIndex(pellet.PelletIndex))
+		{
+			pellet.bHit = false;
+			pellet.HitComponent = nullptr;
+			pellet.ImpactPoint = Origin;
+			continue;
+		}
+
+		pellet.ImpactPoint = Origin + pelletDirections[pellet.PelletIndex] * static_cast<float>(pellet.Distance);
+	}
+}
+
+FHitResult FSMCartridgeTargetData::GetPelletHitResult(int32 pelletIdx) const
+{
+	const FSMPelletHit& pellet = Pellets[pelletIdx];
+
+	UPrimitiveComponent* hitComponent = pellet.HitComponent.Get();
+	const FVector shotDirection = (pellet.ImpactPoint - Origin).GetSafeNormal();
+
+	FHitResult hit(hitComponent ? hitComponent->GetOwner() : nullptr, hitComponent, pellet.ImpactPoint, -shotDirection);
+	hit.bBlockingHit = pellet.bHit;
+	hit.TraceStart = Origin;
+	hit.TraceEnd = pellet.ImpactPoint;
+	hit.Distance = FVector::Dist(Origin, pellet.ImpactPoint);
+
+	const USkinnedMeshComponent* skinnedMesh = Cast<USkinnedMeshComponent>(hitComponent);
+	if (skinnedMesh && pellet.BoneIndex != INDEX_NONE)
+	{
+		hit.BoneName = skinnedMesh->GetBoneName(pellet.BoneIndex);
+	}
+
+	hit.PhysMaterial = GetDefault<USMCombatSettings>()->GetPhysicalMaterialFromIndex(pellet.PhysicalMaterialIndex);
+
+	return hit;
+}
+
+TArray<TWeakObjectPtr<AActor>> FSMCartridgeTargetData::GetActors() const
+{
+	TArray<TWeakObjectPtr<AActor>> actors;
+	for (const FSMPelletHit& pellet : Pellets)
+	{
+		if (const UPrimitiveComponent* hitComponent = pellet.HitComponent.Get())
+		{
+			actors.Add(hitComponent->GetOwner());
+		}
+	}
+
+	return actors;
+}
+
+FString FSMCartridgeTargetData::ToString() const
+{
+	return FString::Printf(TEXT("FSMCartridgeTargetData (Cartridge %u, %d pellets)"), CartridgeID, Pellets.Num());
+}
+
+bool FSMCartridgeTargetData::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar.SerializeIntPacked(CartridgeID);
+	Ar << AimPitch;
+	Ar << AimYaw;
+	Ar << SpreadAngleCentidegrees;
+	Ar << InterpolationDelayMs;
+
+	bOutSuccess = true;
+	Origin.NetSerialize(Ar, Map, bOutSuccess);
+
+	uint8 numPellets = static_cast<uint8>(FMath::Min(Pellets.Num(), static_cast<int32>(MAX_uint8)));
+	Ar << numPellets;
+
+	if (Ar.IsLoading())
+	{
+		Pellets.SetNum(numPellets);
+	}
+
+	for (int32 pelletIdx = 0; pelletIdx < numPellets; pelletIdx++)
+	{
+		FSMPelletHit& pellet = Pellets[pelletIdx];
+
+		uint8 flags = 0;
+		if (Ar.IsSaving())
+		{
+			flags |= pellet.bHit ? SMPelletFlags::Hit : 0;
+			flags |= pellet.HitComponent.IsValid() ? SMPelletFlags::HasComponent : 0;
+			flags |= pellet.BoneIndex != INDEX_NONE ? SMPelletFlags::HasBone : 0;
+			flags |= pellet.PhysicalMaterialIndex != 0 ? SMPelletFlags::HasPhysicalMaterial : 0;
+		}
+
+		Ar << flags;
+
+		pellet.bHit = (flags & SMPelletFlags::Hit) != 0;
+
+		if (flags & SMPelletFlags::HasComponent)
+		{
+			UObject* hitComponent = pellet.HitComponent.Get();
+			bOutSuccess &= Map->SerializeObject(Ar, UPrimitiveComponent::StaticClass(), hitComponent);
+			pellet.HitComponent = Cast<UPrimitiveComponent>(hitComponent);
+		}
+		else if (Ar.IsLoading())
+		{
+			pellet.HitComponent = nullptr;
+		}
+
+		if (flags & SMPelletFlags::HasBone)
+		{
+			Ar << pellet.BoneIndex;
+		}
+		else if (Ar.IsLoading())
+		{
+			pellet.BoneIndex = INDEX_NONE;
+		}
+
+		if (flags & SMPelletFlags::HasPhysicalMaterial)
+		{
+			Ar << pellet.PhysicalMaterialIndex;
+		}
+		else if (Ar.IsLoading())
+		{
+			pellet.PhysicalMaterialIndex = 0;
+		}
+
+		Ar << pellet.PelletIndex;
+		Ar.SerializeIntPacked(pellet.Distance);
+	}
+
+	return true;
+}
@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GAS/SMDamageMultiplierTable.h"
+
+#include "Components/SkinnedMeshComponent.h"
+#include "Curves/CurveFloat.h"
+#include "Engine/SkinnedAsset.h"
+#include "Settings/SMCombatSettings.h"
+
+void FSMDamageMultiplierTable::Compile(const TMap<FName, float>& boneMultipliers, const TMap<FGameplayTag, float>& zoneMultipliers, const TMap<UPhysicalMaterial*, float>& physicalMaterialMultipliers, const UCurveFloat* falloffCurve)
+{
+	BoneMultipliersByName = boneMultipliers;
+	BoneMultipliersByAsset.Reset();
+
+	ZoneMultipliersByTag = zoneMultipliers;
+	ResolvedZoneMultipliers.Reset();
+
+	// Only replicated materials can be told apart on the server, the rest stay at 1
+	PhysicalMaterialMultipliers.Init(1.0f, MAX_uint8 + 1);
+	const USMCombatSettings* combatSettings = GetDefault<USMCombatSettings>();
+	for (const TPair<UPhysicalMaterial*, float>& pair : physicalMaterialMultipliers)
+	{
+		const uint8 materialIdx = combatSettings->GetPhysicalMaterialIndex(pair.Key);
+		if (materialIdx != 0)
+		{
+			PhysicalMaterialMultipliers[materialIdx] = pair.Value;
+		}
+	}
+
+	bHasFalloff = falloffCurve != nullptr;
+	if (bHasFalloff)
+	{
+		Falloff.Bake(falloffCurve->FloatCurve);
+	}
+}
+
+float FSMDamageMultiplierTable::GetMultiplier(const USkinnedMeshComponent* mesh, int32 boneIndex, const FGameplayTag& hitZone, uint8 physicalMaterialIndex, float distance) const
+{
+	float multiplier = PhysicalMaterialMultipliers.IsValidIndex(physicalMaterialIndex) ? PhysicalMaterialMultipliers[physicalMaterialIndex] : 1.0f;
+
+	if (hitZone.IsValid())
+	{
+		multiplier *= GetZoneMultiplier(hitZone);
+	}
+	else if (mesh && boneIndex != INDEX_NONE)
+	{
+		multiplier *= GetBoneMultiplier(mesh, boneIndex);
+	}
+
+	if (bHasFalloff)
+	{
+		multiplier *= Falloff.Eval(distance);
+	}
+
+	return multiplier;
+}
+
+float FSMDamageMultiplierTable::GetMultiplier(const FHitResult& hit, const FGameplayTag& hitZone) const
+{
+	const USkinnedMeshComponent* mesh = Cast<USkinnedMeshComponent>(hit.GetComponent());
+	const int32 boneIndex = mesh && !hit.BoneName.IsNone() ? mesh->GetBoneIndex(hit.BoneName) : INDEX_NONE;
+	const uint8 physicalMaterialIndex = GetDefault<USMCombatSettings>()->GetPhysicalMaterialIndex(hit.PhysMaterial.Get());
+
+	return GetMultiplier(mesh, boneIndex, hitZone, physicalMaterialIndex, hit.Distance);
+}
+
+float FSMDamageMultiplierTable::GetBoneMultiplier(const USkinnedMeshComponent* mesh, int32 boneIndex) const
+{
+	const USkinnedAsset* asset = mesh->GetSkinnedAsset();
+	if (!asset || BoneMultipliersByName.Num() == 0)
+	{
+		return 1.0f;
+	}
+
+	TArray<float>* boneMultipliers = BoneMultipliersByAsset.Find(asset);
+	if (!boneMultipliers)
+	{
+		const FReferenceSkeleton& refSkeleton = asset->GetRefSkeleton();
+		const int32 numBones = refSkeleton.GetNum();
+
+		boneMultipliers = &BoneMultipliersByAsset.Add(asset);
+		boneMultipliers->SetNumUninitialized(numBones);
+
+		// Parents always come before their children in the reference skeleton, so one pass hands multipliers down
+		for (int32 idx = 0; idx < numBones; idx++)
+		{
+			if (const float* multiplier = BoneMultipliersByName.Find(refSkeleton.GetBoneName(idx)))
+			{
+				(*boneMultipliers)[idx] = *multiplier;
+				continue;
+			}
+
+			const int32 parentIdx = refSkeleton.GetParentIndex(idx);
+			(*boneMultipliers)[idx] = parentIdx != INDEX_NONE ? (*boneMultipliers)[parentIdx] : 1.0f;
+		}
+	}
+
+	return boneMultipliers->IsValidIndex(boneIndex) ? (*boneMultipliers)[boneIndex] : 1.0f;
+}
+
+float FSMDamageMultiplierTable::GetZoneMultiplier(const FGameplayTag& hitZone) const
+{
+	if (ZoneMultipliersByTag.Num() == 0)
+	{
+		return 1.0f;
+	}
+
+	if (const float* resolved = ResolvedZoneMultipliers.Find(hitZone))
+	{
+		return *resolved;
+	}
+
+	// Closest tag up the hierarchy with a multiplier, so HitZone.Head covers HitZone.Head.Jaw
+	float multiplier = 1.0f;
+	for (FGameplayTag zone = hitZone; zone.IsValid(); zone = zone.RequestDirectParent())
+	{
+		if (const float* zoneMultiplier = ZoneMultipliersByTag.Find(zone))
+		{
+			multiplier = *zoneMultiplier;
+			break;
+		}
+	}
+
+	ResolvedZoneMultipliers.Add(hitZone, multiplier);
+	return multiplier;
+}
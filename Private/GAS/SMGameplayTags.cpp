@@ -0,0 +1,13 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GAS/SMGameplayTags.h"
+
+namespace SMGameplayTags
+{
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Character_Aiming, "Character.Aiming", "The character is aiming down sights.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Character_IsChangingEquippable, "Character.IsChangingEquippable", "The character is equipping or unequipping something.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(EquippableSlot_NoSlot, "EquippableSlot.NoSlot", "The equippable doesn't take up an inventory slot.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Team_Survivor, "Team.Survivor", "Players and anyone on their side.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(Team_Zombie, "Team.Zombie", "Zombies spawned by the Spawn Master.");
+}
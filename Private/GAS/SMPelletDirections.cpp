@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GAS/SMPelletDirections.h"
+
+void FSMPelletDirections::Generate(const FVector& aimDir, float coneHalfAngleRad, float exponent, FRandomStream& stream, int32 numDirections)
+{
+	NumDirections = numDirections;
+
+	const int32 numPadded = Align(numDirections, 4);
+	X.SetNumUninitialized(numPadded);
+	Y.SetNumUninitialized(numPadded);
+	Z.SetNumUninitialized(numPadded);
+
+	if (coneHalfAngleRad <= 0.0f)
+	{
+		const FVector3f direction(aimDir.GetSafeNormal());
+		for (int32 directionIdx = 0; directionIdx < numPadded; directionIdx++)
+		{
+			X[directionIdx] = direction.X;
+			Y[directionIdx] = direction.Y;
+			Z[directionIdx] = direction.Z;
+		}
+
+		return;
+	}
+
+	// The random numbers are drawn up front (in pellet order, away from the center first then around) and parked in X
+	// and Y. Each block of 4 reads them back before writing its directions over them.
+	for (int32 directionIdx = 0; directionIdx < numPadded; directionIdx++)
+	{
+		const bool bPadding = directionIdx >= numDirections;
+		X[directionIdx] = bPadding ? 0.0f : stream.FRand();
+		Y[directionIdx] = bPadding ? 0.0f : stream.FRand();
+	}
+
+	// Forward, right and up of the aim, a pellet is forward tilted towards a point on the right/up circle.
+	const FMatrix aimBasis = FRotationMatrix(aimDir.Rotation());
+	const FVector3f forward(aimBasis.GetScaledAxis(EAxis::X));
+	const FVector3f right(aimBasis.GetScaledAxis(EAxis::Y));
+	const FVector3f up(aimBasis.GetScaledAxis(EAxis::Z));
+
+	const VectorRegister4Float forwardX = VectorSetFloat1(forward.X);
+	const VectorRegister4Float forwardY = VectorSetFloat1(forward.Y);
+	const VectorRegister4Float forwardZ = VectorSetFloat1(forward.Z);
+	const VectorRegister4Float rightX = VectorSetFloat1(right.X);
+	const VectorRegister4Float rightY = VectorSetFloat1(right.Y);
+	const VectorRegister4Float rightZ = VectorSetFloat1(right.Z);
+	const VectorRegister4Float upX = VectorSetFloat1(up.X);
+	const VectorRegister4Float upY = VectorSetFloat1(up.Y);
+	const VectorRegister4Float upZ = VectorSetFloat1(up.Z);
+
+	const VectorRegister4Float coneHalfAngle = VectorSetFloat1(coneHalfAngleRad);
+	const VectorRegister4Float twoPi = VectorSetFloat1(UE_TWO_PI);
+	const VectorRegister4Float exponentV = VectorSetFloat1(exponent);
+	const bool bApplyExponent = exponent != 1.0f;
+
+	for (int32 directionIdx = 0; directionIdx < numPadded; directionIdx += 4)
+	{
+		// A larger exponent clusters the pellets more tightly around the center.
+		VectorRegister4Float fromCenter = VectorLoad(X.GetData() + directionIdx);
+		if (bApplyExponent)
+		{
+			fromCenter = VectorPow(fromCenter, exponentV);
+		}
+
+		const VectorRegister4Float angleFromCenter = VectorMultiply(fromCenter, coneHalfAngle);
+		const VectorRegister4Float angleAround = VectorMultiply(VectorLoad(Y.GetData() + directionIdx), twoPi);
+
+		VectorRegister4Float sinFromCenter;
+		VectorRegister4Float cosFromCenter;
+		VectorSinCos(&sinFromCenter, &cosFromCenter, &angleFromCenter);
+
+		VectorRegister4Float sinAround;
+		VectorRegister4Float cosAround;
+		VectorSinCos(&sinAround, &cosAround, &angleAround);
+
+		const VectorRegister4Float alongRight = VectorMultiply(sinFromCenter, cosAround);
+		const VectorRegister4Float alongUp = VectorMultiply(sinFromCenter, sinAround);
+
+		// forward * cos(from center) + right * sin(from center) * cos(around) + up * sin(from center) * sin(around)
+		VectorStore(VectorMultiplyAdd(upX, alongUp, VectorMultiplyAdd(rightX, alongRight, VectorMultiply(forwardX, cosFromCenter))), X.GetData() + directionIdx);
+		VectorStore(VectorMultiplyAdd(upY, alongUp, VectorMultiplyAdd(rightY, alongRight, VectorMultiply(forwardY, cosFromCenter))), Y.GetData() + directionIdx);
+		VectorStore(VectorMultiplyAdd(upZ, alongUp, VectorMultiplyAdd(rightZ, alongRight, VectorMultiply(forwardZ, cosFromCenter))), Z.GetData() + directionIdx);
+	}
+}
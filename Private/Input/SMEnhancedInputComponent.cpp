@@ -2,4 +2,104 @@
 
 
 #include "Input/SMEnhancedInputComponent.h"
-#include "GameplayAbilitySpec.h"
+
+#include "GAS/SMAbilitySystemComponent.h"
+#include "SpawnMaster/SpawnMaster.h"
+
+void USMEnhancedInputComponent::AddAbilityInput(const UInputAction* inputAction, FGameplayAbilitySpecHandle handle, USMAbilitySystemComponent* abilitySystem)
+{
+	if (!inputAction || !handle.IsValid() || !abilitySystem)
+	{
+		return;
+	}
+
+	// Handles only mean something to the ability system that made them
+	if (AbilitySystem.Get() != abilitySystem)
+	{
+		if (AbilitySystem.IsValid())
+		{
+			SM_LOG(Warning, TEXT("USMEnhancedInputComponent: %s switched ability systems from %s to %s, dropping the old ability inputs."), *GetNameSafe(GetOwner()), *GetNameSafe(AbilitySystem.Get()), *GetNameSafe(abilitySystem))
+		}
+
+		ClearAbilityInputs();
+		AbilitySystem = abilitySystem;
+	}
+
+	RemoveAbilityInput(handle);
+
+	ActionToSpecs.Add(inputAction, handle);
+	SpecToAction.Add(handle, inputAction);
+
+	BindAbilityInputAction(inputAction);
+}
+
+void USMEnhancedInputComponent::RemoveAbilityInput(FGameplayAbilitySpecHandle handle)
+{
+	TObjectKey<UInputAction> inputAction;
+	if (SpecToAction.RemoveAndCopyValue(handle, inputAction))
+	{
+		ActionToSpecs.RemoveSingle(inputAction, handle);
+	}
+}
+
+void USMEnhancedInputComponent::ClearAbilityInputs()
+{
+	ActionToSpecs.Reset();
+	SpecToAction.Reset();
+}
+
+void USMEnhancedInputComponent::BindAbilityInputAction(const UInputAction* inputAction)
+{
+	bool bAlreadyBound = false;
+	BoundActions.Add(inputAction, &bAlreadyBound);
+	if (bAlreadyBound)
+	{
+		return;
+	}
+
+	BindAction(inputAction, ETriggerEvent::Started, this, &ThisClass::OnAbilityInputPressed, inputAction);
+	BindAction(inputAction, ETriggerEvent::Completed, this, &ThisClass::OnAbilityInputReleased, inputAction);
+	// Canceled releases too, otherwise an action cancelled by its triggers leaves the ability thinking it's still held.
+	BindAction(inputAction, ETriggerEvent::Canceled, this, &ThisClass::OnAbilityInputReleased, inputAction);
+}
+
+void USMEnhancedInputComponent::OnAbilityInputPressed(const UInputAction* inputAction)
+{
+	USMAbilitySystemComponent* abilitySystem = AbilitySystem.Get();
+	if (!abilitySystem)
+	{
+		return;
+	}
+
+	// Copied out first, activating an ability can give or remove abilities
+	TArray<FGameplayAbilitySpecHandle, TInlineAllocator<4>> handles;
+	for (auto it = ActionToSpecs.CreateConstKeyIterator(inputAction); it; ++it)
+	{
+		handles.Add(it.Value());
+	}
+
+	for (const FGameplayAbilitySpecHandle& handle : handles)
+	{
+		abilitySystem->AbilityHandleInputPressed(handle);
+	}
+}
+
+void USMEnhancedInputComponent::OnAbilityInputReleased(const UInputAction* inputAction)
+{
+	USMAbilitySystemComponent* abilitySystem = AbilitySystem.Get();
+	if (!abilitySystem)
+	{
+		return;
+	}
+
+	TArray<FGameplayAbilitySpecHandle, TInlineAllocator<4>> handles;
+	for (auto it = ActionToSpecs.CreateConstKeyIterator(inputAction); it; ++it)
+	{
+		handles.Add(it.Value());
+	}
+
+	for (const FGameplayAbilitySpecHandle& handle : handles)
+	{
+		abilitySystem->AbilityHandleInputReleased(handle);
+	}
+}
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Items/SMBakedCurve.h"
+
+#include "Curves/RichCurve.h"
+
+void FSMBakedCurve::Bake(const FRichCurve& curve)
+{
+	float minTime = 0.0f;
+	float maxTime = 0.0f;
+	curve.GetTimeRange(/*out*/ minTime, /*out*/ maxTime);
+
+	Bake(curve, minTime, maxTime);
+}
+
+void FSMBakedCurve::Bake(const FRichCurve& curve, float minTime, float maxTime)
+{
+	MinTime = minTime;
+
+	// Flat or empty curve, every sample ends up the same value anyway.
+	const float range = maxTime - minTime;
+	InvSampleSpacing = range > KINDA_SMALL_NUMBER ? static_cast<float>(SampleCount - 1) / range : 0.0f;
+
+	for (int32 sampleIdx = 0; sampleIdx < SampleCount; sampleIdx++)
+	{
+		const float alpha = static_cast<float>(sampleIdx) / static_cast<float>(SampleCount - 1);
+		Samples[sampleIdx] = curve.Eval(minTime + range * alpha);
+	}
+}
@@ -6,13 +6,26 @@
 #include "AbilitySystemGlobals.h"
 #include "Components/SMEquippableInventoryComponent.h"
 #include "Curves/CurveVector.h"
+#include "GameplayEffect.h"
+#include "GAS/AttributeSets/SMCombatAttributeSet.h"
 #include "GAS/SMAbilitySystemComponent.h"
 #include "GAS/SMGameplayAbility.h"
+#include "GAS/SMGameplayTags.h"
 #include "Interfaces/SMFirstPersonInterface.h"
 #include "Net/UnrealNetwork.h"
 #include "Player/SMPlayerController.h"
 #include "Possessables/SMBaseCharacter.h"
+#include "Settings/SMCombatSettings.h"
 #include "SpawnMaster/SpawnMaster.h"
+#include "Subsystems/SMEquippablePoolSubsystem.h"
+#include "Subsystems/SMPickupSubsystem.h"
+
+// Baked recoil curves, one per curve asset.
+static TSMBakedCurveCache<FSMBakedRecoilCurve>& GetRecoilBakedCurveCache()
+{
+	static TSMBakedCurveCache<FSMBakedRecoilCurve> cache;
+	return cache;
+}
 
 #if WITH_EDITOR
 void ASMEquippableBase::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
@@ -47,6 +60,19 @@ void ASMEquippableBase::SetOwner(AActor* NewOwner)
 	{
 		return;
 	}
+
+	// Dropped equippables nobody picks up go back in the pool after a while, if the equippable asks for it.
+	if (UWorld* world = GetWorld())
+	{
+		if (NewOwner == nullptr && !bIsInPool && DroppedLifeSpan > 0.f)
+		{
+			world->GetTimerManager().SetTimer(DroppedLifeSpanTimerHandle, this, &ASMEquippableBase::OnDroppedLifeSpanExpired, DroppedLifeSpan, false);
+		}
+		else
+		{
+			world->GetTimerManager().ClearTimer(DroppedLifeSpanTimerHandle);
+		}
+	}
 	
 	OnOwnerUpdated(NewOwner);
 }
@@ -79,6 +105,15 @@ void ASMEquippableBase::PostInitializeComponents()
 	Super::PostInitializeComponents();
 
 	CurrentAmmo = StartingAmmo == -1 ? MaxCurrentAmmo : StartingAmmo;
+
+	if (const UCurveVector* recoilCurve = RecoilSettings.RecoilCurve)
+	{
+		BakedRecoilCurve = GetRecoilBakedCurveCache().FindOrBake(recoilCurve, [recoilCurve](FSMBakedRecoilCurve& baked)
+		{
+			baked.X.Bake(recoilCurve->FloatCurves[0], 0.0f, 1.0f);
+			baked.Y.Bake(recoilCurve->FloatCurves[1], 0.0f, 1.0f);
+		});
+	}
 }
 
 #if WITH_EDITOR
@@ -95,6 +130,37 @@ void ASMEquippableBase::OnPickUp(USMEquippableInventoryComponent* inventory)
 	}
 }
 
+bool ASMEquippableBase::CanPickUp()
+{
+	return Super::CanPickUp() && !bIsInPool;
+}
+
+ENetDormancy ASMEquippableBase::GetDesiredNetDormancy() const
+{
+	if (bIsInPool)
+	{
+		return DORM_DormantAll;
+	}
+
+	// Held but not in hand. Nothing about this equippable changes for simulated proxies until it gets equipped or dropped,
+	// and the owner only needs ammo changes which flush dormancy themselves.
+	if (AActor* owner = GetOwner())
+	{
+		const USMEquippableInventoryComponent* inventory = USMEquippableInventoryComponent::GetInventoryComponent(owner);
+		if (inventory && inventory->GetCurrentEquippable() != this)
+		{
+			return DORM_DormantAll;
+		}
+	}
+
+	return Super::GetDesiredNetDormancy();
+}
+
+bool ASMEquippableBase::CanBePickedUpBy(USMEquippableInventoryComponent* inventory) const
+{
+	return inventory && inventory->HasRoomForEquippable(this);
+}
+
 bool ASMEquippableBase::CanEquip()
 {
 	return (GetOwner() != nullptr) && BP_CanEquip();
@@ -140,6 +206,12 @@ void ASMEquippableBase::OnOwnerUpdated(AActor* NewOwner)
 			{
 				ASC->CancelAbilityHandle(Handle);
 			}
+
+			// Persistent abilities are still granted, they go with us.
+			if (HasAuthority())
+			{
+				ClearAbilitiesFromOwner(ASC);
+			}
 		}
 
 		// Owner has changed, maybe we have been dropped out of the player inventory, clear interface pointer.
@@ -153,6 +225,13 @@ void ASMEquippableBase::OnOwnerUpdated(AActor* NewOwner)
 		{
 			OwnerFirstPersonInterface = Cast<ISMFirstPersonInterface>(NewOwner);
 			check(OwnerFirstPersonInterface)
+
+			// Grant persistent abilities on pickup, equipping is then just what lets them activate.
+			USMAbilitySystemComponent* ASC = OwnerFirstPersonInterface->GetSMAbilitySystemComponent();
+			if (ASC && HasAuthority() && GetDefault<USMCombatSettings>()->UsePersistentEquippableAbilities())
+			{
+				GiveAbilitiesToOwner(ASC);
+			}
 		}
 		else
 		{
@@ -161,26 +240,18 @@ void ASMEquippableBase::OnOwnerUpdated(AActor* NewOwner)
 	}
 
 	// We use the "Owner" to determine if this equippable has been picked up.
-	if (GetOwner() != nullptr)
-	{
-		WorldMeshComponent->SetVisibility(false);
-		WorldMeshComponent->SetSimulatePhysics(false);
-		WorldMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-		
-		EquippableMesh3P->SetCastHiddenShadow(true);
+	SetWorldMeshActive(GetOwner() == nullptr);
+}
 
-		SetReplicateMovement(false);
-	}
-	else
-	{
-		WorldMeshComponent->SetVisibility(true);
-		WorldMeshComponent->SetSimulatePhysics(true);
-		WorldMeshComponent->SetCollisionEnabled(ECollisionEnabled::PhysicsOnly);
-		
-		EquippableMesh3P->SetCastHiddenShadow(false);
+void ASMEquippableBase::SetWorldMeshActive(bool bActive)
+{
+	WorldMeshComponent->SetVisibility(bActive);
+	WorldMeshComponent->SetSimulatePhysics(bActive);
+	WorldMeshComponent->SetCollisionEnabled(bActive ? ECollisionEnabled::PhysicsOnly : ECollisionEnabled::NoCollision);
+	
+	EquippableMesh3P->SetCastHiddenShadow(!bActive);
 
-		SetReplicateMovement(true);
-	}
+	SetReplicateMovement(bActive);
 }
 
 void ASMEquippableBase::AttachToPawn(bool bFirstPerson) const
@@ -227,10 +298,9 @@ void ASMEquippableBase::AttachToPawn(bool bFirstPerson) const
 
 					UAbilitySystemComponent* ASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(GetOwner());
 					
-					const FName tagName = FName("Character.IsChangingEquippable");
-					if (!ASC->HasMatchingGameplayTag(FGameplayTag::RequestGameplayTag(tagName)))
+					if (!ASC->HasMatchingGameplayTag(SMGameplayTags::Character_IsChangingEquippable))
 					{
-						ASC->AddLooseGameplayTag(FGameplayTag::RequestGameplayTag(tagName));
+						ASC->AddLooseGameplayTag(SMGameplayTags::Character_IsChangingEquippable);
 					}
 					
 					const FTimerDelegate functionDelegate = FTimerDelegate::CreateUObject(this, &ASMEquippableBase::OnEquippableReadyToFire);
@@ -363,11 +433,10 @@ void ASMEquippableBase::AddAbilitiesToOwner()
 	USMAbilitySystemComponent* ASC = OwnerFirstPersonInterface->GetSMAbilitySystemComponent();
 	check(ASC)
 
-	for (TSubclassOf<USMGameplayAbility>& Ability : Abilities)
-	{
-		AbilitySpecHandles.Add(ASC->GiveAbility(
-			FGameplayAbilitySpec(Ability, 0, INDEX_NONE, this)));
-	}
+	// New equip, capture the damage source again in case anything changed while holstered
+	InvalidateDamageSpecTemplates();
+
+	GiveAbilitiesToOwner(ASC);
 }
 
 void ASMEquippableBase::RemoveAbilitiesFromOwner()
@@ -388,10 +457,99 @@ void ASMEquippableBase::RemoveAbilitiesFromOwner()
 		return;
 	}
 	
+	if (GetDefault<USMCombatSettings>()->UsePersistentEquippableAbilities())
+	{
+		// Stay granted while holstered, just don't leave anything running.
+		for (FGameplayAbilitySpecHandle& SpecHandle : AbilitySpecHandles)
+		{
+			ASC->CancelAbilityHandle(SpecHandle);
+		}
+		return;
+	}
+
+	ClearAbilitiesFromOwner(ASC);
+}
+
+void ASMEquippableBase::GiveAbilitiesToOwner(USMAbilitySystemComponent* ASC)
+{
+	// Already granted, persistent abilities are only given once per pickup.
+	if (AbilitySpecHandles.Num() > 0)
+	{
+		return;
+	}
+
+	for (TSubclassOf<USMGameplayAbility>& Ability : Abilities)
+	{
+		AbilitySpecHandles.Add(ASC->GiveAbility(
+			FGameplayAbilitySpec(Ability, 0, INDEX_NONE, this)));
+	}
+}
+
+void ASMEquippableBase::ClearAbilitiesFromOwner(USMAbilitySystemComponent* ASC)
+{
 	for (FGameplayAbilitySpecHandle& SpecHandle : AbilitySpecHandles)
 	{
 		ASC->ClearAbility(SpecHandle);
 	}
+
+	AbilitySpecHandles.Reset();
+}
+
+bool ASMEquippableBase::IsEquipped() const
+{
+	const USMEquippableInventoryComponent* inventory = OwnerFirstPersonInterface ? OwnerFirstPersonInterface->GetInventoryComponent() : nullptr;
+	return inventory && inventory->GetCurrentEquippable() == this;
+}
+
+const FGameplayEffectSpec* ASMEquippableBase::GetDamageSpecTemplate(const UGameplayAbility* ability, TSubclassOf<UGameplayEffect> effectClass, float level)
+{
+	if (!ability || !effectClass)
+	{
+		return nullptr;
+	}
+
+	UAbilitySystemComponent* sourceASC = ability->GetAbilitySystemComponentFromActorInfo();
+	if (!sourceASC)
+	{
+		return nullptr;
+	}
+
+	// Every template shares the owner's ability system, a new one makes all of them stale
+	if (DamageSpecTemplateSource.Get() != sourceASC)
+	{
+		InvalidateDamageSpecTemplates();
+
+		DamageSpecTemplateSource = sourceASC;
+		BaseDamageChangedHandle = sourceASC->GetGameplayAttributeValueChangeDelegate(USMCombatAttributeSet::GetBaseDamageAttribute()).AddUObject(this, &ThisClass::OnBaseDamageChanged);
+	}
+
+	FGameplayEffectSpecHandle& damageSpecTemplate = DamageSpecTemplates.FindOrAdd(ability);
+
+	const FGameplayEffectSpec* spec = damageSpecTemplate.Data.Get();
+	if (spec && spec->Def && spec->Def->GetClass() == effectClass && spec->GetLevel() == level)
+	{
+		return spec;
+	}
+
+	damageSpecTemplate = ability->MakeOutgoingGameplayEffectSpec(effectClass, level);
+	return damageSpecTemplate.Data.Get();
+}
+
+void ASMEquippableBase::InvalidateDamageSpecTemplates()
+{
+	if (UAbilitySystemComponent* sourceASC = DamageSpecTemplateSource.Get())
+	{
+		sourceASC->GetGameplayAttributeValueChangeDelegate(USMCombatAttributeSet::GetBaseDamageAttribute()).Remove(BaseDamageChangedHandle);
+	}
+
+	BaseDamageChangedHandle.Reset();
+	DamageSpecTemplateSource.Reset();
+	DamageSpecTemplates.Reset();
+}
+
+void ASMEquippableBase::OnBaseDamageChanged(const FOnAttributeChangeData& changeData)
+{
+	InvalidateDamageSpecTemplates();
 }
 
 void ASMEquippableBase::CancelEquippableAbilities()
@@ -412,18 +570,88 @@ void ASMEquippableBase::OnExplicitlySpawnedIn()
 		if (USMEquippableInventoryComponent* inventory = USMEquippableInventoryComponent::GetInventoryComponent(ActorToReceivePostSpawn.Get()))
 		{
 			const bool bSuccess = inventory->GiveExistingEquippable(this);
+			ActorToReceivePostSpawn.Reset();
+			
+			// Recycle instead of destroying, this happens a lot when giving equippables to full inventories.
 			if (!bSuccess)
 			{
-				Destroy();
-			}
-			else
-			{
-				ActorToReceivePostSpawn.Reset();
+				ReleaseToPool();
 			}
 		}
 	}
 }
 
+void ASMEquippableBase::OnDroppedLifeSpanExpired()
+{
+	if (HasAuthority() && !GetOwner() && !bIsInPool)
+	{
+		ReleaseToPool();
+	}
+}
+
+void ASMEquippableBase::ReleaseToPool()
+{
+	if (USMEquippablePoolSubsystem* pool = USMEquippablePoolSubsystem::Get(GetWorld()))
+	{
+		pool->ReleaseEquippable(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
+void ASMEquippableBase::ResetForPool()
+{
+	if (const UWorld* world = GetWorld())
+	{
+		world->GetTimerManager().ClearAllTimersForObject(this);
+	}
+
+	if (USMPickupSubsystem* pickupSubsystem = USMPickupSubsystem::Get(GetWorld()))
+	{
+		pickupSubsystem->UnregisterItem(this);
+	}
+
+	// Abilities were already removed when we were dropped, the handles are stale at this point.
+	AbilitySpecHandles.Reset();
+	InvalidateDamageSpecTemplates();
+	OwnerFirstPersonInterface = nullptr;
+	ActorToReceivePostSpawn.Reset();
+	
+	CurrentAmmo = StartingAmmo == -1 ? MaxCurrentAmmo : StartingAmmo;
+	bHasBeenPickedUpBefore = false;
+	EquippableInteractionCount = 0;
+	bIsBeingInteracted = false;
+	bIsInPool = true;
+
+	SetWorldMeshActive(false);
+	SetActorHiddenInGame(true);
+	ForceNetUpdate();
+	RefreshNetDormancy();
+}
+
+void ASMEquippableBase::OnAcquiredFromPool(const FTransform& transform, AActor* receiver)
+{
+	bIsInPool = false;
+	SetDropTime(0.f);
+	RefreshNetDormancy();
+	
+	SetActorTransform(transform, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetWorldMeshActive(true);
+
+	if (USMPickupSubsystem* pickupSubsystem = USMPickupSubsystem::Get(GetWorld()))
+	{
+		pickupSubsystem->RegisterItem(this);
+	}
+	
+	ForceNetUpdate();
+
+	ActorToReceivePostSpawn = receiver;
+	OnExplicitlySpawnedIn();
+}
+
 void ASMEquippableBase::OnUnEquipAnimationFinished(bool bFirstPerson)
 {
 	if (bFirstPerson)
@@ -460,7 +688,7 @@ void ASMEquippableBase::OnUnEquipAnimationFinished(bool bFirstPerson)
 void ASMEquippableBase::OnEquippableReadyToFire() const
 {
 	ISMFirstPersonInterface* interface = GetOwnerFirstPersonInterface();
-	interface->GetSMAbilitySystemComponent()->RemoveLooseGameplayTag(FGameplayTag::RequestGameplayTag(FName("Character.IsChangingEquippable")));
+	interface->GetSMAbilitySystemComponent()->RemoveLooseGameplayTag(SMGameplayTags::Character_IsChangingEquippable);
 	
 	if (bIsBeingInteracted == false)
 	{
@@ -480,7 +708,7 @@ void ASMEquippableBase::ApplyRecoilToController()
 	
 	if (controller != nullptr && controller->IsLocalController())
 	{
-		if (RecoilSettings.RecoilCurve)
+		if (BakedRecoilCurve.IsValid())
 		{
 			float Xmultiplier = 1.0f;
 			float Ymultiplier = 1.0f;
@@ -491,7 +719,7 @@ void ASMEquippableBase::ApplyRecoilToController()
 				ISMFirstPersonInterface* interface = GetOwnerFirstPersonInterface();
 				check(interface)
 	
-				const bool bIsAiming = interface->GetSMAbilitySystemComponent()->HasMatchingGameplayTag(FGameplayTag::RequestGameplayTag(FName("Character.Aiming")));
+				const bool bIsAiming = interface->GetSMAbilitySystemComponent()->HasMatchingGameplayTag(SMGameplayTags::Character_Aiming);
 				const float recoilMultiplier = (GetRecoilHeatMultiplier() * (bIsAiming ? AimRecoilMultiplier : 1.0f));
 				
 				if (bMultiplyRecoilToHeatX)
@@ -505,8 +733,8 @@ void ASMEquippableBase::ApplyRecoilToController()
 				}
 			}
 			
-			float X = RecoilSettings.RecoilCurve->GetVectorValue(FMath::RandRange(0.f, 1.f)).X * Xmultiplier;
-			float Y = RecoilSettings.RecoilCurve->GetVectorValue(FMath::RandRange(0.f, 1.f)).Y * Ymultiplier;
+			float X = BakedRecoilCurve->X.Eval(FMath::RandRange(0.f, 1.f)) * Xmultiplier;
+			float Y = BakedRecoilCurve->Y.Eval(FMath::RandRange(0.f, 1.f)) * Ymultiplier;
 			const FVector2D RecoilAmount(X, Y);
 			controller->ApplyRecoil(RecoilAmount, RecoilSettings.RecoilSpeed, RecoilSettings.RecoilResetSpeed);
 		}
@@ -521,6 +749,7 @@ void ASMEquippableBase::SetAmmo(float AmountToSet)
 {
 	float OldAmmo = CurrentAmmo;
 	CurrentAmmo = AmountToSet;
+	FlushNetDormancy();
 	OnCurrentAmmoChanged.Broadcast(OldAmmo, CurrentAmmo);
 }
 
@@ -537,6 +766,9 @@ void ASMEquippableBase::AddAmmo(float AmountToAdd, bool bClamp)
 		CurrentAmmo = FMath::Clamp(CurrentAmmo + AmountToAdd, 0, MaxCurrentAmmo);
 	}
 
+	// Held equippables that aren't in hand are dormant, make sure the owner still gets the new ammo.
+	FlushNetDormancy();
+
 	OnCurrentAmmoChanged.Broadcast(OldAmmo, CurrentAmmo);
 }
 
@@ -4,28 +4,52 @@
 #include "Items/SMGunBase.h"
 
 #include "GAS/SMAbilitySystemComponent.h"
+#include "GAS/SMGameplayTags.h"
 #include "Interfaces/SMFirstPersonInterface.h"
 #include "Net/UnrealNetwork.h"
 
-ASMGunBase::ASMGunBase()
+// Cooldown step while the cooldown rates depend on the heat, a 60fps frame.
+static constexpr float HeatUpdateStep = 1.0f / 60.0f;
+
+// Baked heat curves, one set per gun class.
+static TSMBakedCurveCache<FSMGunBakedCurves>& GetGunBakedCurveCache()
 {
-	PrimaryActorTick.bStartWithTickEnabled = true;
+	static TSMBakedCurveCache<FSMGunBakedCurves> cache;
+	return cache;
 }
 
-void ASMGunBase::Tick(float DeltaSeconds)
+void ASMGunBase::PostInitializeComponents()
 {
-	Super::Tick(DeltaSeconds);
+	Super::PostInitializeComponents();
 
-	UpdateSpread(DeltaSeconds);
+	BakedCurves = GetGunBakedCurveCache().FindOrBake(GetClass(), [this](FSMGunBakedCurves& baked)
+	{
+		baked.HeatToSpread.Bake(*HeatToSpreadCurve.GetRichCurveConst());
+		baked.HeatToCooldownPerSecond.Bake(*HeatToCooldownPerSecondCurve.GetRichCurveConst());
+		baked.HeatToHeatPerShot.Bake(*HeatToHeatPerShotCurve.GetRichCurveConst());
+		baked.RecoilHeatToCooldownPerSecond.Bake(*RecoilHeatToCooldownPerSecondCurve.GetRichCurveConst());
+		baked.RecoilHeatToHeatPerShot.Bake(*RecoilHeatToHeatPerShotCurve.GetRichCurveConst());
+	});
 
-#if WITH_EDITOR
-	if (bDebugSpreadValues && GEngine)
+	ComputeHeatRange(/*out*/ MinHeatRange, /*out*/ MaxHeatRange);
+	CurrentHeat = ClampHeat(CurrentHeat);
+	CurrentSpreadAngle = BakedCurves->HeatToSpread.Eval(CurrentHeat);
+
+	if (const UWorld* world = GetWorld())
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 0.0f, FColor::White, FString("CurrentHeat: ") + FString::SanitizeFloat(CurrentHeat));
-		GEngine->AddOnScreenDebugMessage(-1, 0.0f, FColor::White, FString("CurrentSpreadAngle: ") + FString::SanitizeFloat(CurrentSpreadAngle));
+		LastHeatUpdateTime = world->GetTimeSeconds();
+	}
+}
+
+void ASMGunBase::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Heat is updated lazily so guns don't need to tick themselves, but Blueprint guns with an Event Tick still do.
+	if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ASMGunBase, ReceiveTick)))
+	{
+		SetActorTickEnabled(true);
 	}
-#endif
-	
 }
 
 void ASMGunBase::OnPickUp(USMEquippableInventoryComponent* inventory)
@@ -33,12 +57,19 @@ void ASMGunBase::OnPickUp(USMEquippableInventoryComponent* inventory)
 	Super::OnPickUp(inventory);
 
 	// Start heat in the middle
-	float MinHeatRange;
-	float MaxHeatRange;
-	ComputeHeatRange(/*out*/ MinHeatRange, /*out*/ MaxHeatRange);
 	//CurrentHeat = (MinHeatRange + MaxHeatRange) * 0.5f;
 }
 
+void ASMGunBase::ResetForPool()
+{
+	Super::ResetForPool();
+
+	CurrentHeat = ClampHeat(0.0f);
+	CurrentRecoilHeat = 0.0f;
+	CurrentSpreadAngle = BakedCurves->HeatToSpread.Eval(CurrentHeat);
+	LastHeatUpdateTime = GetWorld()->GetTimeSeconds();
+}
+
 void ASMGunBase::ComputeHeatRange(float& MinHeat, float& MaxHeat)
 {
 	float Min1;
@@ -57,19 +88,54 @@ void ASMGunBase::ComputeHeatRange(float& MinHeat, float& MaxHeat)
 	MaxHeat = FMath::Max(FMath::Max(Max1, Max2), Max3);
 }
 
-void ASMGunBase::UpdateSpread(float deltaSeconds)
+void ASMGunBase::UpdateHeat() const
 {
-	float CooldownRate = HeatToCooldownPerSecondCurve.GetRichCurveConst()->Eval(CurrentHeat);
-	CurrentHeat = ClampHeat(CurrentHeat - (CooldownRate * deltaSeconds));
-	CurrentSpreadAngle = HeatToSpreadCurve.GetRichCurveConst()->Eval(CurrentHeat);
+	const UWorld* world = GetWorld();
+	if (!world)
+	{
+		return;
+	}
+	
+	const float timeSeconds = world->GetTimeSeconds();
+	const float elapsed = timeSeconds - LastHeatUpdateTime;
+	LastHeatUpdateTime = timeSeconds;
 
-	float RecoilCooldownRate = RecoilHeatToCooldownPerSecondCurve.GetRichCurveConst()->Eval(CurrentRecoilHeat);
-	CurrentRecoilHeat = CurrentRecoilHeat - (RecoilCooldownRate * deltaSeconds);
+	if (elapsed <= 0.0f)
+	{
+		return;
+	}
 
-#if WITH_EDITOR
-	Debug_CurrentHeat = CurrentHeat;
-	Debug_CurrentSpreadAngle = CurrentSpreadAngle;
-#endif
+	CoolDownHeat(*BakedCurves, MinHeatRange, MaxHeatRange, elapsed, /*out*/ CurrentHeat, /*out*/ CurrentRecoilHeat);
+	CurrentSpreadAngle = BakedCurves->HeatToSpread.Eval(CurrentHeat);
+}
+
+void ASMGunBase::CoolDownHeat(const FSMGunBakedCurves& curves, float minHeat, float maxHeat, float elapsedSeconds, float& heat, float& recoilHeat)
+{
+	const float heatFlatBelow = curves.HeatToCooldownPerSecond.GetFlatBelow();
+	const float recoilFlatBelow = curves.RecoilHeatToCooldownPerSecond.GetFlatBelow();
+
+	float remaining = elapsedSeconds;
+	while (remaining > 0.0f)
+	{
+		const float cooldownRate = curves.HeatToCooldownPerSecond.Eval(heat);
+		const float recoilCooldownRate = curves.RecoilHeatToCooldownPerSecond.Eval(recoilHeat);
+
+		// A rate stays the same from here on if it's zero, or if cooling moves further into the flat part of its curve.
+		const bool bHeatRateConstant = cooldownRate == 0.0f || (cooldownRate > 0.0f && heat <= heatFlatBelow);
+		const bool bRecoilRateConstant = recoilCooldownRate == 0.0f || (recoilCooldownRate > 0.0f && recoilHeat <= recoilFlatBelow);
+		if (bHeatRateConstant && bRecoilRateConstant)
+		{
+			// Heat only moves towards minHeat here, so clamping once is the same as clamping every step.
+			heat = FMath::Clamp(heat - (cooldownRate * remaining), minHeat, maxHeat);
+			recoilHeat -= recoilCooldownRate * remaining;
+			return;
+		}
+
+		const float stepSeconds = FMath::Min(HeatUpdateStep, remaining);
+		heat = FMath::Clamp(heat - (cooldownRate * stepSeconds), minHeat, maxHeat);
+		recoilHeat -= recoilCooldownRate * stepSeconds;
+		remaining -= stepSeconds;
+	}
 }
 
 void ASMGunBase::AddSpread()
@@ -77,13 +143,29 @@ void ASMGunBase::AddSpread()
 	ISMFirstPersonInterface* interface = GetOwnerFirstPersonInterface();
 	check(interface)
 	
-	const bool bIsAiming = interface->GetSMAbilitySystemComponent()->HasMatchingGameplayTag(FGameplayTag::RequestGameplayTag(FName("Character.Aiming")));
+	const bool bIsAiming = interface->GetSMAbilitySystemComponent()->HasMatchingGameplayTag(SMGameplayTags::Character_Aiming);
+
+	// Cool down to now before adding this shot's heat.
+	UpdateHeat();
 	
-	const float HeatPerShot = HeatToHeatPerShotCurve.GetRichCurveConst()->Eval(CurrentHeat) * (bIsAiming ? AimSpreadMultiplier : 1.0f);
+	const float HeatPerShot = BakedCurves->HeatToHeatPerShot.Eval(CurrentHeat) * (bIsAiming ? AimSpreadMultiplier : 1.0f);
 	CurrentHeat = ClampHeat(CurrentHeat + HeatPerShot);
 
-	const float RecoilHeatPerShot = RecoilHeatToHeatPerShotCurve.GetRichCurveConst()->Eval(CurrentRecoilHeat);
+	const float RecoilHeatPerShot = BakedCurves->RecoilHeatToHeatPerShot.Eval(CurrentRecoilHeat);
 	const float NewRecoilHeat = CurrentRecoilHeat + RecoilHeatPerShot;
 	const float MaxRecoil = MaxRecoilHeat != 0.0f ? MaxRecoilHeat : 1000.f;
 	CurrentRecoilHeat = FMath::Clamp(NewRecoilHeat, 0.0f, MaxRecoil);
+
+	CurrentSpreadAngle = BakedCurves->HeatToSpread.Eval(CurrentHeat);
+
+#if WITH_EDITOR
+	Debug_CurrentHeat = CurrentHeat;
+	Debug_CurrentSpreadAngle = CurrentSpreadAngle;
+
+	if (bDebugSpreadValues && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 1.0f, FColor::White, FString("CurrentHeat: ") + FString::SanitizeFloat(CurrentHeat));
+		GEngine->AddOnScreenDebugMessage(-1, 1.0f, FColor::White, FString("CurrentSpreadAngle: ") + FString::SanitizeFloat(CurrentSpreadAngle));
+	}
+#endif
 }
\ No newline at end of file
@@ -4,8 +4,7 @@
 #include "Items/SMItemBase.h"
 #include "Components/SMEquippableInventoryComponent.h"
 #include "SpawnMaster/SpawnMaster.h"
-
-DECLARE_CYCLE_STAT(TEXT("ItemTick"), STAT_ItemTick, STATGROUP_SpawnMaster);
+#include "Subsystems/SMPickupSubsystem.h"
 
 ASMItemBase::ASMItemBase()
 {
@@ -18,12 +17,14 @@ ASMItemBase::ASMItemBase()
 	WorldMeshComponent->SetCollisionResponseToAllChannels(ECR_Ignore);
 	WorldMeshComponent->SetCollisionResponseToChannel(ECC_WorldStatic, ECR_Block);
 	WorldMeshComponent->SetLinearDamping(0.5f);
+	WorldMeshComponent->BodyInstance.bGenerateWakeEvents = true;
 	RootComponent = WorldMeshComponent;
 	
+	// Pickups are handled by USMPickupSubsystem, the sphere is only kept around for its radius.
 	SphereCollisionComponent = CreateDefaultSubobject<USphereComponent>(TEXT("SphereComp"));
-	SphereCollisionComponent->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	SphereCollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	SphereCollisionComponent->SetCollisionResponseToChannels(ECollisionResponse::ECR_Ignore);
-	SphereCollisionComponent->SetCollisionResponseToChannel(COLLISION_SMCHARACTERBASE, ECollisionResponse::ECR_Overlap);
+	SphereCollisionComponent->SetGenerateOverlapEvents(false);
 	SphereCollisionComponent->SetupAttachment(RootComponent);
 
 	bReplicates = true;
@@ -33,48 +34,6 @@ ASMItemBase::ASMItemBase()
 /* Item Functions
 ***********************************************************************************/
 
-void ASMItemBase::PickUpTick()
-{
-	SCOPE_CYCLE_COUNTER(STAT_ItemTick)
-	
-	if (!HasAuthority())
-	{
-		return;
-	}
-
-	if (GetWorld()->GetTimeSeconds() < DropTime)
-	{
-		return;
-	}
-
-	// Get all actors that are overlapping
-	TArray<AActor*> outOverlappingActors;
-	GetOverlappingActors(outOverlappingActors);
-
-	// We do this check so when there are no actors overlapping, we can turn off tick.
-	if (outOverlappingActors.Num() > 0)
-	{
-		for (AActor* actor : outOverlappingActors)
-		{
-			check(actor) // Not sure if we need this, but from experience i've has such a rare case where the element in a foreach loop can be nullptr.
-
-			// @TODO: change this to just check if the actor has an equippable inventory component, then just pass the actor to OnPickUp. 
-			// We check if it has the component first, so if it doesn't have it we can skip doing the cast.
-			if (UActorComponent* actorComponent = actor->GetComponentByClass(USMEquippableInventoryComponent::StaticClass()))
-			{
-				if (USMEquippableInventoryComponent* inventoryComponent = Cast<USMEquippableInventoryComponent>(actorComponent))
-				{
-					OnPickUp(inventoryComponent);
-				}
-			}
-		}
-	}
-	else
-	{
-		GetWorld()->GetTimerManager().ClearTimer(PickupTickTimerHandle);
-	}
-}
-
 void ASMItemBase::OnPickUp(USMEquippableInventoryComponent* inventory)
 {
 	if (inventory)
@@ -110,14 +69,102 @@ void ASMItemBase::NetMulticastReceiveDropInformation_Implementation(FVector_NetQ
 /* Other (uncategorized)
 ***********************************************************************************/
 
-void ASMItemBase::NotifyActorBeginOverlap(AActor* OtherActor)
+void ASMItemBase::BeginPlay()
 {
-	Super::NotifyActorBeginOverlap(OtherActor);
+	Super::BeginPlay();
+
+	if (HasAuthority())
+	{
+		WorldMeshComponent->OnComponentSleep.AddDynamic(this, &ASMItemBase::OnWorldMeshSleep);
+		WorldMeshComponent->OnComponentWake.AddDynamic(this, &ASMItemBase::OnWorldMeshWake);
+	}
+
+	if (HasAuthority() && !GetOwner())
+	{
+		if (USMPickupSubsystem* pickupSubsystem = USMPickupSubsystem::Get(GetWorld()))
+		{
+			pickupSubsystem->RegisterItem(this);
+		}
+	}
+}
 
-	// enable tick if the overlapping actor has an inventory component (server only).
-	if (HasAuthority() && !GetOwner() && OtherActor->GetComponentByClass(USMEquippableInventoryComponent::StaticClass()))
+void ASMItemBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (USMPickupSubsystem* pickupSubsystem = USMPickupSubsystem::Get(GetWorld()))
 	{
-		GetWorld()->GetTimerManager().SetTimer(PickupTickTimerHandle, this, &ASMItemBase::PickUpTick, 0.25f, true, 0.0f);
+		pickupSubsystem->UnregisterItem(this);
 	}
+	
+	Super::EndPlay(EndPlayReason);
 }
 
+void ASMItemBase::SetOwner(AActor* NewOwner)
+{
+	// We may be dormant, make sure the owner change actually gets sent.
+	if (HasAuthority())
+	{
+		FlushNetDormancy();
+	}
+	
+	Super::SetOwner(NewOwner);
+
+	if (HasAuthority())
+	{
+		// Either picked up or freshly dropped, the world mesh isn't resting anymore.
+		bWorldMeshAsleep = false;
+		RefreshNetDormancy();
+		
+		// Only items without an owner are lying in the world waiting to be picked up.
+		if (USMPickupSubsystem* pickupSubsystem = USMPickupSubsystem::Get(GetWorld()))
+		{
+			if (NewOwner)
+			{
+				pickupSubsystem->UnregisterItem(this);
+			}
+			else
+			{
+				pickupSubsystem->RegisterItem(this);
+			}
+		}
+	}
+}
+
+/* Replication Policy
+***********************************************************************************/
+
+void ASMItemBase::RefreshNetDormancy()
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	const ENetDormancy desiredDormancy = GetDesiredNetDormancy();
+	if (desiredDormancy != NetDormancy)
+	{
+		SetNetDormancy(desiredDormancy);
+	}
+}
+
+ENetDormancy ASMItemBase::GetDesiredNetDormancy() const
+{
+	// Lying still on the ground, nothing to replicate until it gets picked up or knocked.
+	if (GetOwner() == nullptr && bWorldMeshAsleep)
+	{
+		return DORM_DormantAll;
+	}
+
+	return DORM_Awake;
+}
+
+void ASMItemBase::OnWorldMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName)
+{
+	bWorldMeshAsleep = true;
+	RefreshNetDormancy();
+}
+
+void ASMItemBase::OnWorldMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName)
+{
+	bWorldMeshAsleep = false;
+	RefreshNetDormancy();
+}
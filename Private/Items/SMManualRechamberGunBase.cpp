@@ -46,10 +46,7 @@ void ASMManualRechamberGunBase::CheckForReChamber()
 	USMAbilitySystemComponent* ASC = interface->GetSMAbilitySystemComponent();
 	check(ASC)
 
-	FGameplayTagContainer TagContainer;
-	TagContainer.AddTag(ReChamberAbilityTag);
-	
-	ASC->TryActivateAbilitiesByTag(TagContainer);
+	ASC->TryActivateAbilityByTagFast(ReChamberAbilityTag);
 }
 
 void ASMManualRechamberGunBase::OnExplicitlySpawnedIn()
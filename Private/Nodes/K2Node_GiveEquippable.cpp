@@ -10,6 +10,7 @@
 #include "K2Node_SpawnActorFromClass.h"
 #include "KismetCompiler.h"
 #include "Components/SMEquippableInventoryComponent.h"
+#include "Items/SMEquippableBase.h"
 #include "Kismet/GameplayStatics.h"
 
 #define LOCTEXT_NAMESPACE "K2Node_GiveEquippable"
@@ -21,7 +22,7 @@ FText UK2Node_GiveEquippable::GetNodeTitle(ENodeTitleType::Type TitleType) const
 
 FText UK2Node_GiveEquippable::GetTooltipText() const
 {
-	return LOCTEXT("GiveEquippableK2Node_Tooltip", "Gives brand new Equippable to a character.");
+	return LOCTEXT("GiveEquippableK2Node_Tooltip", "Gives brand new Equippable to a character. Reuses a pooled Equippable of the same class when there is one.");
 }
 
 FText UK2Node_GiveEquippable::GetMenuCategory() const
@@ -29,16 +30,29 @@ FText UK2Node_GiveEquippable::GetMenuCategory() const
 	return LOCTEXT("GiveEquippableK2Node_MenuCategory", "nfPopulationSystem");
 }
 
+namespace GiveEquippableHelper
+{
+	const FName EquippableReceiverPinName(TEXT("EquippableReceiver"));
+}
+
 void UK2Node_GiveEquippable::AllocateDefaultPins()
 {
-	// Add execution pins
-	CreatePin(EGPD_Input, UEdGraphSchema_K2::PC_Exec, UEdGraphSchema_K2::PN_Execute);
-	CreatePin(EGPD_Output, UEdGraphSchema_K2::PC_Exec, UEdGraphSchema_K2::PN_Then);
+	// Exec, then, class and result pins.
+	Super::AllocateDefaultPins();
 
-	// Add blueprint pin
-	UEdGraphPin* ClassPin = CreatePin(EGPD_Input, UEdGraphSchema_K2::PC_Class, GetClassPinBaseClass(), TEXT("EquippableClass"));
+	// Add receiver pin
+	UEdGraphPin* ReceiverPin = CreatePin(EGPD_Input, UEdGraphSchema_K2::PC_Object, AActor::StaticClass(), GiveEquippableHelper::EquippableReceiverPinName);
+	ReceiverPin->PinToolTip = LOCTEXT("GiveEquippableK2Node_ReceiverTooltip", "Actor with an equippable inventory to give the equippable to.").ToString();
+}
 
-	Super::AllocateDefaultPins();
+UClass* UK2Node_GiveEquippable::GetClassPinBaseClass() const
+{
+	return ASMEquippableBase::StaticClass();
+}
+
+UEdGraphPin* UK2Node_GiveEquippable::GetReceiverPin() const
+{
+	return FindPinChecked(GiveEquippableHelper::EquippableReceiverPinName);
 }
 
 void UK2Node_GiveEquippable::GetMenuActions(FBlueprintActionDatabaseRegistrar& ActionRegistrar) const
@@ -52,12 +66,12 @@ void UK2Node_GiveEquippable::GetMenuActions(FBlueprintActionDatabaseRegistrar& A
 		ActionRegistrar.AddBlueprintAction(Action, Spawner);
 	}
 }
-/*
+
 void UK2Node_GiveEquippable::ExpandNode(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
 {
 	Super::ExpandNode(CompilerContext, SourceGraph);
 
-	static const FName SpawnEquippableFuncName = GET_FUNCTION_NAME_CHECKED(USMEquippableInventoryComponent, GiveNewEquippable);
+	static const FName GiveEquippableFuncName = GET_FUNCTION_NAME_CHECKED(USMEquippableInventoryComponent, GiveNewEquippable);
 	static const FName EquippableClassParamName(TEXT("EquippableClass"));
 	static const FName EquippableActorParamName(TEXT("EquippableReceiver"));
 
@@ -65,45 +79,54 @@ void UK2Node_GiveEquippable::ExpandNode(FKismetCompilerContext& CompilerContext,
 	UEdGraphPin* GiveNodeExec = GiveNode->GetExecPin();
 	UEdGraphPin* GiveClassPin = GiveNode->GetClassPin();
 	UEdGraphPin* GiveNodeThen = GiveNode->GetThenPin();
+	UEdGraphPin* GiveReceiverPin = GiveNode->GetReceiverPin();
+	UEdGraphPin* GiveResultPin = GiveNode->GetResultPin();
 
 	UClass* GiveClass = (GiveClassPin != NULL) ? Cast<UClass>(GiveClassPin->DefaultObject) : NULL;
 	if ( !GiveClassPin || ((0 == GiveClassPin->LinkedTo.Num()) && (NULL == GiveClass)))
 	{
-		CompilerContext.MessageLog.Error(*LOCTEXT("GiveEquippableNodeMissingClass_Error", "Spawn node @@ must have a @@ specified.").ToString(), GiveNode, GiveClassPin);
-		// we break exec links so this is the only error we get, don't want the SpawnActor node being considered and giving 'unexpected node' type warnings
+		CompilerContext.MessageLog.Error(*LOCTEXT("GiveEquippableNodeMissingClass_Error", "Give Equippable node @@ must have a @@ specified.").ToString(), GiveNode, GiveClassPin);
+		// we break exec links so this is the only error we get, don't want the node being considered and giving 'unexpected node' type warnings
 		GiveNode->BreakAllNodeLinks();
 		return;
 	}
 
 	UK2Node_CallFunction* CallGiveEquippableNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(GiveNode, SourceGraph);
-	CallGiveEquippableNode->FunctionReference.SetExternalMember(SpawnEquippableFuncName, USMEquippableInventoryComponent::StaticClass());
+	CallGiveEquippableNode->FunctionReference.SetExternalMember(GiveEquippableFuncName, USMEquippableInventoryComponent::StaticClass());
 	CallGiveEquippableNode->AllocateDefaultPins();
 
-	UEdGraphPin* CallBeginExec = CallGiveEquippableNode->GetExecPin();
-	UEdGraphPin* CallFinishThen = CallGiveEquippableNode->GetThenPin();
+	UEdGraphPin* CallExec = CallGiveEquippableNode->GetExecPin();
+	UEdGraphPin* CallThen = CallGiveEquippableNode->GetThenPin();
 	UEdGraphPin* CallGiveEquippable_ClassPin = CallGiveEquippableNode->FindPinChecked(EquippableClassParamName);
 	UEdGraphPin* CallGiveEquippable_ActorPin = CallGiveEquippableNode->FindPinChecked(EquippableActorParamName);
+	UEdGraphPin* CallResult = CallGiveEquippableNode->GetReturnValuePin();
 
-	// Move 'exec' connection from spawn node to 'begin spawn'
-	CompilerContext.MovePinLinksToIntermediate(*GiveNodeExec, *CallBeginExec);
+	// Move 'exec' connection from give node to the function call
+	CompilerContext.MovePinLinksToIntermediate(*GiveNodeExec, *CallExec);
 
-	// Move 'then' connection from spawn node to 'finish spawn'
-	CompilerContext.MovePinLinksToIntermediate(*GiveNodeThen, *CallFinishThen);
+	// Move 'then' connection from give node to the function call
+	CompilerContext.MovePinLinksToIntermediate(*GiveNodeThen, *CallThen);
 
 	if(GiveClassPin->LinkedTo.Num() > 0)
 	{
-		// Copy the 'blueprint' connection from the spawn node to 'begin spawn'
-		CompilerContext.MovePinLinksToIntermediate(*GiveClassPin, *CallGiveEquippable_ActorPin);
+		// Copy the 'class' connection from the give node to the function call
+		CompilerContext.MovePinLinksToIntermediate(*GiveClassPin, *CallGiveEquippable_ClassPin);
 	}
 	else
 	{
-		// Copy blueprint literal onto begin spawn call 
+		// Copy class literal onto the function call
 		CallGiveEquippable_ClassPin->DefaultObject = GiveClass;
 	}
 
+	CompilerContext.MovePinLinksToIntermediate(*GiveReceiverPin, *CallGiveEquippable_ActorPin);
+
+	// Keep the result pin typed to the selected class.
+	CallResult->PinType = GiveResultPin->PinType;
+	CompilerContext.MovePinLinksToIntermediate(*GiveResultPin, *CallResult);
+
 	// Break any links to the expanded node
 	GiveNode->BreakAllNodeLinks();
-}*/
+}
 
 
 #undef LOCTEXT_NAMESPACE
@@ -4,10 +4,12 @@
 #include "Player/SMPlayerController.h"
 
 #include "EnhancedInputComponent.h"
+#include "Input/SMEnhancedInputComponent.h"
 
 ASMPlayerController::ASMPlayerController()
 {
-	
+	// Ability input is routed through our input component, whatever the project's default input component class is
+	OverrideInputComponentClass = USMEnhancedInputComponent::StaticClass();
 }
 
 void ASMPlayerController::ApplyRecoil(const FVector2D& RecoilAmount, const float RecoilSpeed, const float RecoilResetSpeed)
@@ -17,6 +17,7 @@
 #include "GAS/AttributeSets/SMCharacterAttributeSet.h"
 
 #include "SpawnMaster/SpawnMaster.h"
+#include "Subsystems/SMLagCompensationSubsystem.h"
 
 // Sets default values
 ASMBaseCharacter::ASMBaseCharacter(const class FObjectInitializer& ObjectInitializer) :
@@ -51,6 +52,12 @@ void ASMBaseCharacter::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
+	// Bullets trace the hitbox set through the lag compensation subsystem instead.
+	if (HitboxSet)
+	{
+		GetMesh()->SetCollisionResponseToChannel(TRACECHANNEL_BULLET, ECR_Ignore);
+	}
+
 	// We do this check here for players who join late.
 	if (!InventoryComponent->GetCurrentEquippable())
 	{
@@ -73,6 +80,15 @@ void ASMBaseCharacter::OnRep_PlayerState()
 void ASMBaseCharacter::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// Clients need the hitboxes too when bullets can only hit those.
+	if (HasAuthority() || HitboxSet)
+	{
+		if (USMLagCompensationSubsystem* lagCompensationSubsystem = USMLagCompensationSubsystem::Get(GetWorld()))
+		{
+			lagCompensationSubsystem->RegisterCharacter(this, HitboxSet);
+		}
+	}
 }
 
 void ASMBaseCharacter::NotifyActorBeginOverlap(AActor* OtherActor)
@@ -132,6 +148,11 @@ void ASMBaseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 	
 	OnAbilitySystemComponentUnInitialized();
 	
+	if (USMLagCompensationSubsystem* lagCompensationSubsystem = USMLagCompensationSubsystem::Get(GetWorld()))
+	{
+		lagCompensationSubsystem->UnregisterCharacter(this);
+	}
+
 	Super::EndPlay(EndPlayReason);
 }
 
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Settings/SMCombatSettings.h"
+
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+uint8 USMCombatSettings::GetPhysicalMaterialIndex(const UPhysicalMaterial* physicalMaterial) const
+{
+	if (!physicalMaterial)
+	{
+		return 0;
+	}
+
+	const int32 numMaterials = FMath::Min(ReplicatedPhysicalMaterials.Num(), static_cast<int32>(MAX_uint8));
+	for (int32 materialIdx = 0; materialIdx < numMaterials; materialIdx++)
+	{
+		if (ReplicatedPhysicalMaterials[materialIdx].Get() == physicalMaterial)
+		{
+			return static_cast<uint8>(materialIdx + 1);
+		}
+	}
+
+	return 0;
+}
+
+UPhysicalMaterial* USMCombatSettings::GetPhysicalMaterialFromIndex(uint8 physicalMaterialIndex) const
+{
+	if (physicalMaterialIndex == 0 || !ReplicatedPhysicalMaterials.IsValidIndex(physicalMaterialIndex - 1))
+	{
+		return nullptr;
+	}
+
+	return ReplicatedPhysicalMaterials[physicalMaterialIndex - 1].LoadSynchronous();
+}
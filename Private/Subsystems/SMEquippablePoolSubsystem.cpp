@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SMEquippablePoolSubsystem.h"
+
+#include "Items/SMEquippableBase.h"
+#include "SpawnMaster/SpawnMaster.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Equippable Pool Hits"), STAT_EquippablePoolHits, STATGROUP_SpawnMaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Equippable Pool Misses"), STAT_EquippablePoolMisses, STATGROUP_SpawnMaster);
+
+USMEquippablePoolSubsystem* USMEquippablePoolSubsystem::Get(const UWorld* World)
+{
+	return World ? World->GetSubsystem<USMEquippablePoolSubsystem>() : nullptr;
+}
+
+bool USMEquippablePoolSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* world = Cast<UWorld>(Outer);
+	return world && (world->WorldType == EWorldType::Game || world->WorldType == EWorldType::PIE);
+}
+
+void USMEquippablePoolSubsystem::Deinitialize()
+{
+	Pools.Reset();
+	
+	Super::Deinitialize();
+}
+
+ASMEquippableBase* USMEquippablePoolSubsystem::AcquireEquippable(TSubclassOf<ASMEquippableBase> equippableClass, const FTransform& transform, AActor* receiver)
+{
+	UWorld* world = GetWorld();
+	if (!equippableClass || !world || world->GetNetMode() == NM_Client)
+	{
+		return nullptr;
+	}
+
+	if (FEquippablePool* pool = Pools.Find(equippableClass.Get()))
+	{
+		while (pool->PooledEquippables.Num() > 0)
+		{
+			ASMEquippableBase* equippable = pool->PooledEquippables.Pop(false);
+			if (IsValid(equippable))
+			{
+				INC_DWORD_STAT(STAT_EquippablePoolHits)
+				equippable->OnAcquiredFromPool(transform, receiver);
+				return equippable;
+			}
+		}
+	}
+
+	INC_DWORD_STAT(STAT_EquippablePoolMisses)
+
+	// Deferred so ActorToReceivePostSpawn is set before BeginPlay, same as the Expose On Spawn pin on Spawn Actor From Class.
+	ASMEquippableBase* equippable = world->SpawnActorDeferred<ASMEquippableBase>(equippableClass, transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (equippable)
+	{
+		equippable->SetActorToReceivePostSpawn(receiver);
+		equippable->FinishSpawning(transform);
+	}
+
+	return equippable;
+}
+
+void USMEquippablePoolSubsystem::ReleaseEquippable(ASMEquippableBase* equippable)
+{
+	if (!IsValid(equippable) || !equippable->HasAuthority() || equippable->IsInPool())
+	{
+		return;
+	}
+
+	if (equippable->GetOwner() != nullptr)
+	{
+		SM_LOG(Warning, TEXT("Tried to release %s to the pool while it is still owned by %s."), *AActor::GetDebugName(equippable), *AActor::GetDebugName(equippable->GetOwner()))
+		return;
+	}
+
+	FEquippablePool& pool = Pools.FindOrAdd(equippable->GetClass());
+	if (pool.PooledEquippables.Num() >= MaxPooledPerClass)
+	{
+		equippable->Destroy();
+		return;
+	}
+
+	equippable->ResetForPool();
+	pool.PooledEquippables.Add(equippable);
+}
@@ -0,0 +1,551 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SMLagCompensationSubsystem.h"
+
+#include "Components/CapsuleComponent.h"
+#include "DataAssets/Characters/SMHitboxSet.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerState.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "Settings/SMCombatSettings.h"
+#include "SpawnMaster/SpawnMaster.h"
+
+DECLARE_CYCLE_STAT(TEXT("LagCompensationRecord"), STAT_LagCompensationRecord, STATGROUP_SpawnMaster);
+DECLARE_CYCLE_STAT(TEXT("LagCompensationConfirmHit"), STAT_LagCompensationConfirmHit, STATGROUP_SpawnMaster);
+DECLARE_CYCLE_STAT(TEXT("LagCompensationTraceHitboxes"), STAT_LagCompensationTraceHitboxes, STATGROUP_SpawnMaster);
+
+namespace SpawnMasterConsoleVariables
+{
+	static bool LagCompensationEnabled = true;
+	static FAutoConsoleVariableRef CVarLagCompensationEnabled(
+		TEXT("spawnmaster.LagCompensation.Enabled"),
+		LagCompensationEnabled,
+		TEXT("Should the server check hits reported by clients against its hitbox history"),
+		ECVF_Default);
+
+	static float LagCompensationHitTolerance = 20.0f;
+	static FAutoConsoleVariableRef CVarLagCompensationHitTolerance(
+		TEXT("spawnmaster.LagCompensation.HitTolerance"),
+		LagCompensationHitTolerance,
+		TEXT("How far (in uu) a reported hit can miss a rewound hitbox and still count, covers client side smoothing and ping jitter"),
+		ECVF_Default);
+
+	static float LagCompensationMaxRewind = 0.5f;
+	static FAutoConsoleVariableRef CVarLagCompensationMaxRewind(
+		TEXT("spawnmaster.LagCompensation.MaxRewind"),
+		LagCompensationMaxRewind,
+		TEXT("How far back (in seconds) the server rewinds hitboxes for a shot at most, past this high ping players have to lead their targets"),
+		ECVF_Default);
+}
+
+namespace SMLagCompensation
+{
+	// A segment with each component splatted across all 4 lanes.
+	struct FSegment4
+	{
+		VectorRegister4Float P1X, P1Y, P1Z;
+		VectorRegister4Float D1X, D1Y, D1Z;
+
+		// Squared length of the segment, never 0.
+		VectorRegister4Float A;
+
+		FSegment4(const FVector3f& segStart, const FVector3f& segDir)
+			: P1X(VectorSetFloat1(segStart.X)), P1Y(VectorSetFloat1(segStart.Y)), P1Z(VectorSetFloat1(segStart.Z))
+			, D1X(VectorSetFloat1(segDir.X)), D1Y(VectorSetFloat1(segDir.Y)), D1Z(VectorSetFloat1(segDir.Z))
+			, A(VectorSetFloat1(FMath::Max(segDir.SizeSquared(), SMALL_NUMBER)))
+		{
+		}
+	};
+
+	/* Closest approach between the segment and the 4 capsules starting at hitboxIdx, with capsule positions lerped from
+	 * frameA to frameB by alpha. Returns the squared distances, outS is how far along the segment (0-1) each one is. */
+	static FORCEINLINE VectorRegister4Float ClosestApproach4(const FSegment4& seg, const float* frameA, const float* frameB, const VectorRegister4Float& alpha,
+		int32 numPaddedHitboxes, int32 hitboxIdx, VectorRegister4Float& outS)
+	{
+		const VectorRegister4Float zero = VectorZeroFloat();
+		const VectorRegister4Float one = VectorOneFloat();
+		const VectorRegister4Float smallNumber = VectorSetFloat1(SMALL_NUMBER);
+
+		const auto lerpComponent = [&](int32 component)
+		{
+			const VectorRegister4Float from = VectorLoad(frameA + component * numPaddedHitboxes + hitboxIdx);
+			const VectorRegister4Float to = VectorLoad(frameB + component * numPaddedHitboxes + hitboxIdx);
+			return VectorMultiplyAdd(VectorSubtract(to, from), alpha, from);
+		};
+
+		const auto clamp01 = [&](const VectorRegister4Float& value)
+		{
+			return VectorMin(VectorMax(value, zero), one);
+		};
+
+		const VectorRegister4Float q1X = lerpComponent(0);
+		const VectorRegister4Float q1Y = lerpComponent(1);
+		const VectorRegister4Float q1Z = lerpComponent(2);
+		const VectorRegister4Float d2X = VectorSubtract(lerpComponent(3), q1X);
+		const VectorRegister4Float d2Y = VectorSubtract(lerpComponent(4), q1Y);
+		const VectorRegister4Float d2Z = VectorSubtract(lerpComponent(5), q1Z);
+
+		const VectorRegister4Float rX = VectorSubtract(seg.P1X, q1X);
+		const VectorRegister4Float rY = VectorSubtract(seg.P1Y, q1Y);
+		const VectorRegister4Float rZ = VectorSubtract(seg.P1Z, q1Z);
+
+		// Closest points between two segments (Real-Time Collision Detection 5.1.9), without the branches: solve
+		// for s, then t from s, then s again from the clamped t. Spheres have e == 0 and end up with t == 0.
+		const VectorRegister4Float e = VectorMultiplyAdd(d2X, d2X, VectorMultiplyAdd(d2Y, d2Y, VectorMultiply(d2Z, d2Z)));
+		const VectorRegister4Float b = VectorMultiplyAdd(seg.D1X, d2X, VectorMultiplyAdd(seg.D1Y, d2Y, VectorMultiply(seg.D1Z, d2Z)));
+		const VectorRegister4Float c = VectorMultiplyAdd(seg.D1X, rX, VectorMultiplyAdd(seg.D1Y, rY, VectorMultiply(seg.D1Z, rZ)));
+		const VectorRegister4Float f = VectorMultiplyAdd(d2X, rX, VectorMultiplyAdd(d2Y, rY, VectorMultiply(d2Z, rZ)));
+
+		const VectorRegister4Float denom = VectorMax(VectorSubtract(VectorMultiply(seg.A, e), VectorMultiply(b, b)), smallNumber);
+		VectorRegister4Float s = clamp01(VectorDivide(VectorSubtract(VectorMultiply(b, f), VectorMultiply(c, e)), denom));
+		const VectorRegister4Float t = clamp01(VectorDivide(VectorMultiplyAdd(b, s, f), VectorMax(e, smallNumber)));
+		s = clamp01(VectorDivide(VectorSubtract(VectorMultiply(b, t), c), seg.A));
+
+		// (p1 + d1 * s) - (q1 + d2 * t)
+		const VectorRegister4Float deltaX = VectorSubtract(VectorMultiplyAdd(seg.D1X, s, rX), VectorMultiply(d2X, t));
+		const VectorRegister4Float deltaY = VectorSubtract(VectorMultiplyAdd(seg.D1Y, s, rY), VectorMultiply(d2Y, t));
+		const VectorRegister4Float deltaZ = VectorSubtract(VectorMultiplyAdd(seg.D1Z, s, rZ), VectorMultiply(d2Z, t));
+
+		outS = s;
+		return VectorMultiplyAdd(deltaX, deltaX, VectorMultiplyAdd(deltaY, deltaY, VectorMultiply(deltaZ, deltaZ)));
+	}
+
+	/* Bits of the lanes where the capsules (inflated by inflate) are within reach. Padding lanes sit at the origin,
+	 * they never count. */
+	static FORCEINLINE int32 HitLanes(const VectorRegister4Float& distSquared, const float* radii, const VectorRegister4Float& inflate, int32 numHitboxes, int32 hitboxIdx)
+	{
+		const VectorRegister4Float hitRadius = VectorAdd(VectorLoad(radii + hitboxIdx), inflate);
+		const int32 hitMask = VectorMaskBits(VectorCompareLE(distSquared, VectorMultiply(hitRadius, hitRadius)));
+
+		const int32 validLanes = FMath::Min(numHitboxes - hitboxIdx, 4);
+		return hitMask & ((1 << validLanes) - 1);
+	}
+
+	/* Finds the capsule (inflated by inflate) the segment enters first, 4 capsules at a time. Capsule positions are
+	 * lerped from frameA to frameB by alpha. Returns its index or INDEX_NONE, outS is how far along the segment (0-1)
+	 * it enters it. */
+	static int32 FindFirstCapsuleHit(const float* frameA, const float* frameB, float alpha, const float* radii, int32 numHitboxes, int32 numPaddedHitboxes,
+		const FVector3f& segStart, const FVector3f& segDir, float inflate, float& outS)
+	{
+		const FSegment4 seg(segStart, segDir);
+		const VectorRegister4Float alphaV = VectorSetFloat1(alpha);
+		const VectorRegister4Float inflateV = VectorSetFloat1(inflate);
+		const float segLength = FMath::Max(segDir.Size(), SMALL_NUMBER);
+
+		int32 firstHitbox = INDEX_NONE;
+		outS = MAX_flt;
+
+		for (int32 hitboxIdx = 0; hitboxIdx < numPaddedHitboxes; hitboxIdx += 4)
+		{
+			VectorRegister4Float s;
+			const VectorRegister4Float distSquared = ClosestApproach4(seg, frameA, frameB, alphaV, numPaddedHitboxes, hitboxIdx, s);
+			int32 hitMask = HitLanes(distSquared, radii, inflateV, numHitboxes, hitboxIdx);
+			if (hitMask == 0)
+			{
+				continue;
+			}
+
+			alignas(16) float sLanes[4];
+			alignas(16) float distSquaredLanes[4];
+			VectorStoreAligned(s, sLanes);
+			VectorStoreAligned(distSquared, distSquaredLanes);
+
+			while (hitMask != 0)
+			{
+				const int32 lane = FMath::CountTrailingZeros(hitMask);
+				hitMask &= hitMask - 1;
+
+				// Back off from the closest point to where the segment goes in. Exact for spheres, close enough for capsules.
+				const float radius = radii[hitboxIdx + lane] + inflate;
+				const float entryS = sLanes[lane] - FMath::Sqrt(FMath::Max(radius * radius - distSquaredLanes[lane], 0.0f)) / segLength;
+				if (entryS < outS)
+				{
+					outS = entryS;
+					firstHitbox = hitboxIdx + lane;
+				}
+			}
+		}
+
+		outS = FMath::Max(outS, 0.0f);
+		return firstHitbox;
+	}
+}
+
+USMLagCompensationSubsystem* USMLagCompensationSubsystem::Get(const UWorld* World)
+{
+	return World ? World->GetSubsystem<USMLagCompensationSubsystem>() : nullptr;
+}
+
+bool USMLagCompensationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* world = Cast<UWorld>(Outer);
+	return world && (world->WorldType == EWorldType::Game || world->WorldType == EWorldType::PIE);
+}
+
+void USMLagCompensationSubsystem::Deinitialize()
+{
+	Histories.Reset();
+
+	Super::Deinitialize();
+}
+
+TStatId USMLagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USMLagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+bool USMLagCompensationSubsystem::IsTickable() const
+{
+	// Clients only register characters with a hitbox set.
+	return Histories.Num() > 0;
+}
+
+void USMLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRecord)
+
+	const float worldTime = GetWorld()->GetTimeSeconds();
+	if (LastRecordTime >= 0.0f && worldTime - LastRecordTime < MinRecordInterval)
+	{
+		return;
+	}
+
+	LastRecordTime = worldTime;
+
+	for (auto it = Histories.CreateIterator(); it; ++it)
+	{
+		if (!it.Value().Character.IsValid())
+		{
+			it.RemoveCurrent();
+			continue;
+		}
+
+		RecordFrame(it.Value(), worldTime);
+	}
+}
+
+void USMLagCompensationSubsystem::RegisterCharacter(ACharacter* character, const USMHitboxSet* hitboxSet)
+{
+	if (!character || Histories.Contains(character))
+	{
+		return;
+	}
+
+	FSMHitboxHistory& history = Histories.Add(character);
+	history.Character = character;
+	BuildHitboxes(character, hitboxSet, history);
+
+	history.NumPaddedHitboxes = Align(history.Hitboxes.Num(), 4);
+	history.Radii.SetNumZeroed(history.NumPaddedHitboxes);
+	history.Positions.SetNumZeroed(HistoryFrames * 6 * history.NumPaddedHitboxes);
+	history.FrameTimes.SetNumZeroed(HistoryFrames);
+
+	// A server nobody is looking through wouldn't update bones otherwise, and we'd be recording the same pose forever.
+	// Clients only trace what they can see anyway.
+	USkeletalMeshComponent* mesh = character->GetMesh();
+	if (mesh && character->HasAuthority())
+	{
+		mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	}
+}
+
+void USMLagCompensationSubsystem::UnregisterCharacter(ACharacter* character)
+{
+	Histories.Remove(character);
+}
+
+void USMLagCompensationSubsystem::BuildHitboxes(ACharacter* character, const USMHitboxSet* hitboxSet, FSMHitboxHistory& history) const
+{
+	const USkeletalMeshComponent* mesh = character->GetMesh();
+	const UPhysicsAsset* physicsAsset = mesh ? mesh->GetPhysicsAsset() : nullptr;
+
+	const USMCombatSettings* combatSettings = GetDefault<USMCombatSettings>();
+
+	if (mesh && hitboxSet)
+	{
+		const float meshScale = mesh->GetComponentScale().GetMax();
+		const uint8 physicalMaterialIdx = combatSettings->GetPhysicalMaterialIndex(hitboxSet->PhysicalMaterial);
+
+		for (const FSMHitbox& setHitbox : hitboxSet->Hitboxes)
+		{
+			const int32 boneIndex = mesh->GetBoneIndex(setHitbox.BoneName);
+			if (boneIndex == INDEX_NONE)
+			{
+				SM_LOG(Warning, TEXT("%s: Bone %s of hitbox set %s isn't on the mesh, skipping it."), *GetNameSafe(character), *setHitbox.BoneName.ToString(), *GetNameSafe(hitboxSet))
+				continue;
+			}
+
+			FSMHitboxDef& hitbox = history.Hitboxes.AddDefaulted_GetRef();
+			hitbox.BoneIndex = boneIndex;
+			hitbox.LocalStart = setHitbox.Start;
+			hitbox.LocalEnd = setHitbox.End;
+			hitbox.HitZone = setHitbox.HitZone;
+			hitbox.PhysicalMaterialIndex = physicalMaterialIdx;
+			history.Radii.Add(setHitbox.Radius * meshScale);
+		}
+
+		history.bTraceable = history.Hitboxes.Num() > 0;
+		history.PhysicalMaterial = hitboxSet->PhysicalMaterial;
+	}
+	else if (physicsAsset)
+	{
+		// Bone transforms carry the scale for the capsule ends, radii need it applied here.
+		const float meshScale = mesh->GetComponentScale().GetMax();
+
+		// Only capsules and spheres, boxes and convex shapes would need their own kernel.
+		for (const USkeletalBodySetup* bodySetup : physicsAsset->SkeletalBodySetups)
+		{
+			const int32 boneIndex = bodySetup ? mesh->GetBoneIndex(bodySetup->BoneName) : INDEX_NONE;
+			if (boneIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			const uint8 physicalMaterialIdx = combatSettings->GetPhysicalMaterialIndex(bodySetup->PhysMaterial);
+
+			for (const FKSphylElem& sphyl : bodySetup->AggGeom.SphylElems)
+			{
+				const FTransform elemTransform = sphyl.GetTransform();
+				const FVector halfAxis = elemTransform.GetUnitAxis(EAxis::Z) * (sphyl.Length * 0.5f);
+
+				FSMHitboxDef& hitbox = history.Hitboxes.AddDefaulted_GetRef();
+				hitbox.BoneIndex = boneIndex;
+				hitbox.LocalStart = elemTransform.GetTranslation() - halfAxis;
+				hitbox.LocalEnd = elemTransform.GetTranslation() + halfAxis;
+				hitbox.PhysicalMaterialIndex = physicalMaterialIdx;
+				history.Radii.Add(sphyl.Radius * meshScale);
+			}
+
+			for (const FKSphereElem& sphere : bodySetup->AggGeom.SphereElems)
+			{
+				FSMHitboxDef& hitbox = history.Hitboxes.AddDefaulted_GetRef();
+				hitbox.BoneIndex = boneIndex;
+				hitbox.LocalStart = sphere.Center;
+				hitbox.LocalEnd = sphere.Center;
+				hitbox.PhysicalMaterialIndex = physicalMaterialIdx;
+				history.Radii.Add(sphere.Radius * meshScale);
+			}
+		}
+	}
+
+	if (history.Hitboxes.Num() > MaxHitboxesPerCharacter)
+	{
+		SM_LOG(Warning, TEXT("%s has %d hitboxes, only the first %d are used for lag compensation."), *GetNameSafe(character), history.Hitboxes.Num(), MaxHitboxesPerCharacter)
+		history.Hitboxes.SetNum(MaxHitboxesPerCharacter);
+		history.Radii.SetNum(MaxHitboxesPerCharacter);
+	}
+
+	// Nothing usable in the physics asset, fall back to the collision capsule.
+	if (history.Hitboxes.Num() == 0)
+	{
+		const UCapsuleComponent* capsule = character->GetCapsuleComponent();
+		const float halfHeight = capsule->GetUnscaledCapsuleHalfHeight_WithoutHemisphere();
+
+		FSMHitboxDef& hitbox = history.Hitboxes.AddDefaulted_GetRef();
+		hitbox.LocalStart = FVector(0.0f, 0.0f, -halfHeight);
+		hitbox.LocalEnd = FVector(0.0f, 0.0f, halfHeight);
+		history.Radii.Add(capsule->GetScaledCapsuleRadius());
+	}
+}
+
+void USMLagCompensationSubsystem::RecordFrame(FSMHitboxHistory& history, float worldTime) const
+{
+	const ACharacter* character = history.Character.Get();
+	const USkeletalMeshComponent* mesh = character->GetMesh();
+	const FTransform capsuleTransform = character->GetCapsuleComponent()->GetComponentTransform();
+
+	history.NewestFrame = (history.NewestFrame + 1) % HistoryFrames;
+	history.NumFrames = FMath::Min(history.NumFrames + 1, HistoryFrames);
+	history.FrameTimes[history.NewestFrame] = worldTime;
+
+	float* frame = history.GetFrame(history.NewestFrame);
+	const int32 stride = history.NumPaddedHitboxes;
+
+	FBox bounds(ForceInit);
+	float maxRadius = 0.0f;
+
+	for (int32 hitboxIdx = 0; hitboxIdx < history.Hitboxes.Num(); hitboxIdx++)
+	{
+		const FSMHitboxDef& hitbox = history.Hitboxes[hitboxIdx];
+		const FTransform boneTransform = hitbox.BoneIndex == INDEX_NONE ? capsuleTransform : mesh->GetBoneTransform(hitbox.BoneIndex);
+
+		const FVector start = boneTransform.TransformPosition(hitbox.LocalStart);
+		const FVector end = boneTransform.TransformPosition(hitbox.LocalEnd);
+
+		frame[0 * stride + hitboxIdx] = start.X;
+		frame[1 * stride + hitboxIdx] = start.Y;
+		frame[2 * stride + hitboxIdx] = start.Z;
+		frame[3 * stride + hitboxIdx] = end.X;
+		frame[4 * stride + hitboxIdx] = end.Y;
+		frame[5 * stride + hitboxIdx] = end.Z;
+
+		bounds += start;
+		bounds += end;
+		maxRadius = FMath::Max(maxRadius, history.Radii[hitboxIdx]);
+	}
+
+	history.BoundsCenter = bounds.GetCenter();
+	history.BoundsRadius = bounds.GetExtent().Size() + maxRadius;
+}
+
+float USMLagCompensationSubsystem::GetInterpolationDelay(const ACharacter* viewer)
+{
+	const UCharacterMovementComponent* movement = viewer ? viewer->GetCharacterMovement() : nullptr;
+	if (!movement || movement->NetworkSmoothingMode == ENetworkSmoothingMode::Disabled)
+	{
+		return 0.0f;
+	}
+
+	return movement->NetworkSimulatedSmoothLocationTime;
+}
+
+float USMLagCompensationSubsystem::GetShotTime(const AController* shooter, float interpolationDelay) const
+{
+	const float worldTime = GetWorld()->GetTimeSeconds();
+
+	// The client sees everyone else half a round trip late, and its shot takes the other half to get here. On top of
+	// that it draws them interpolationDelay behind what it last received, which can't be more than its own character's
+	// smoothing says.
+	const ACharacter* shooterCharacter = shooter ? Cast<ACharacter>(shooter->GetPawn()) : nullptr;
+	interpolationDelay = FMath::Min(interpolationDelay, GetInterpolationDelay(shooterCharacter));
+
+	const APlayerState* playerState = shooter ? shooter->GetPlayerState<APlayerState>() : nullptr;
+	const float roundTrip = playerState ? playerState->GetPingInMilliseconds() * 0.001f : 0.0f;
+	const float rewind = FMath::Clamp(roundTrip + interpolationDelay, 0.0f, SpawnMasterConsoleVariables::LagCompensationMaxRewind);
+	return worldTime - rewind;
+}
+
+bool USMLagCompensationSubsystem::ConfirmHit(const AActor* hitActor, const FVector& traceStart, const FVector& traceEnd, float shotTime, FSMConfirmedHitbox* outHitbox) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationConfirmHit)
+
+	const FSMHitboxHistory* history = hitActor ? Histories.Find(hitActor) : nullptr;
+	if (!history || history->NumFrames == 0)
+	{
+		return true;
+	}
+
+	// Walk back from the newest frame to the first one recorded at or before the shot.
+	int32 newerFrame = history->NewestFrame;
+	int32 olderFrame = newerFrame;
+	for (int32 age = 0; age < history->NumFrames; age++)
+	{
+		olderFrame = (history->NewestFrame - age + HistoryFrames) % HistoryFrames;
+		if (history->FrameTimes[olderFrame] <= shotTime)
+		{
+			break;
+		}
+
+		newerFrame = olderFrame;
+	}
+
+	// Shots older than our history just use the oldest frame.
+	const float olderTime = history->FrameTimes[olderFrame];
+	const float newerTime = history->FrameTimes[newerFrame];
+	const float alpha = newerTime > olderTime ? FMath::Clamp((shotTime - olderTime) / (newerTime - olderTime), 0.0f, 1.0f) : 0.0f;
+
+	float s = 0.0f;
+	const int32 hitboxIdx = SMLagCompensation::FindFirstCapsuleHit(history->GetFrame(olderFrame), history->GetFrame(newerFrame), alpha, history->Radii.GetData(),
+		history->Hitboxes.Num(), history->NumPaddedHitboxes, FVector3f(traceStart), FVector3f(traceEnd - traceStart), SpawnMasterConsoleVariables::LagCompensationHitTolerance, s);
+
+	if (hitboxIdx != INDEX_NONE && outHitbox)
+	{
+		const FSMHitboxDef& hitbox = history->Hitboxes[hitboxIdx];
+		const ACharacter* character = history->Character.Get();
+		outHitbox->Mesh = character && hitbox.BoneIndex != INDEX_NONE ? character->GetMesh() : nullptr;
+		outHitbox->BoneIndex = outHitbox->Mesh ? hitbox.BoneIndex : INDEX_NONE;
+		outHitbox->PhysicalMaterialIndex = hitbox.PhysicalMaterialIndex;
+		outHitbox->HitZone = hitbox.HitZone;
+	}
+
+	// Disabled still reports the hitbox, just never rejects
+	return hitboxIdx != INDEX_NONE || !SpawnMasterConsoleVariables::LagCompensationEnabled;
+}
+
+bool USMLagCompensationSubsystem::TraceHitboxes(const FVector& traceStart, const FVector& traceEnd, float sweepRadius, const FCollisionQueryParams& params, FHitResult& outHit) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationTraceHitboxes)
+
+	const FVector3f segStart(traceStart);
+	const FVector3f segDir(traceEnd - traceStart);
+
+	const FSMHitboxHistory* firstHistory = nullptr;
+	int32 firstHitbox = INDEX_NONE;
+	float firstS = MAX_flt;
+
+	for (const TPair<const AActor*, FSMHitboxHistory>& pair : Histories)
+	{
+		const FSMHitboxHistory& history = pair.Value;
+		if (!history.bTraceable || history.NumFrames == 0)
+		{
+			continue;
+		}
+
+		// Cheap sphere check first, most bullets don't come near most characters.
+		const float boundsRadius = history.BoundsRadius + sweepRadius;
+		if (FMath::PointDistToSegmentSquared(history.BoundsCenter, traceStart, traceEnd) > FMath::Square(boundsRadius))
+		{
+			continue;
+		}
+
+		const ACharacter* character = history.Character.Get();
+		if (!character || params.GetIgnoredActors().Contains(character->GetUniqueID()))
+		{
+			continue;
+		}
+
+		float s = 0.0f;
+		const float* newestFrame = history.GetFrame(history.NewestFrame);
+		const int32 hitboxIdx = SMLagCompensation::FindFirstCapsuleHit(newestFrame, newestFrame, 0.0f, history.Radii.GetData(),
+			history.Hitboxes.Num(), history.NumPaddedHitboxes, segStart, segDir, sweepRadius, s);
+		if (hitboxIdx != INDEX_NONE && s < firstS)
+		{
+			firstHistory = &history;
+			firstHitbox = hitboxIdx;
+			firstS = s;
+		}
+	}
+
+	if (!firstHistory)
+	{
+		return false;
+	}
+
+	ACharacter* character = firstHistory->Character.Get();
+	USkeletalMeshComponent* mesh = character->GetMesh();
+	const FSMHitboxDef& hitbox = firstHistory->Hitboxes[firstHitbox];
+
+	// Normal points away from the capsule's axis.
+	const float* frame = firstHistory->GetFrame(firstHistory->NewestFrame);
+	const int32 stride = firstHistory->NumPaddedHitboxes;
+	const FVector capsuleStart(frame[0 * stride + firstHitbox], frame[1 * stride + firstHitbox], frame[2 * stride + firstHitbox]);
+	const FVector capsuleEnd(frame[3 * stride + firstHitbox], frame[4 * stride + firstHitbox], frame[5 * stride + firstHitbox]);
+
+	const FVector impactPoint = traceStart + (traceEnd - traceStart) * firstS;
+	const FVector impactNormal = (impactPoint - FMath::ClosestPointOnSegment(impactPoint, capsuleStart, capsuleEnd)).GetSafeNormal();
+
+	outHit = FHitResult(character, mesh, impactPoint, impactNormal);
+	outHit.bBlockingHit = true;
+	outHit.TraceStart = traceStart;
+	outHit.TraceEnd = traceEnd;
+	outHit.Time = firstS;
+	outHit.Distance = FVector::Dist(traceStart, traceEnd) * firstS;
+	outHit.Item = firstHitbox;
+	outHit.BoneName = mesh ? mesh->GetBoneName(hitbox.BoneIndex) : NAME_None;
+	outHit.PhysMaterial = firstHistory->PhysicalMaterial;
+	return true;
+}
+
+FGameplayTag USMLagCompensationSubsystem::GetHitZone(const FHitResult& hit) const
+{
+	const FSMHitboxHistory* history = Histories.Find(hit.GetActor());
+	if (!history || !history->bTraceable || !history->Hitboxes.IsValidIndex(hit.Item))
+	{
+		return FGameplayTag();
+	}
+
+	return history->Hitboxes[hit.Item].HitZone;
+}
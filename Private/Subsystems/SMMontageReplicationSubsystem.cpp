@@ -0,0 +1,262 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SMMontageReplicationSubsystem.h"
+
+#include "GAS/SMAbilitySystemComponent.h"
+#include "SpawnMaster/SpawnMaster.h"
+
+DECLARE_CYCLE_STAT(TEXT("MontageReplication"), STAT_MontageReplication, STATGROUP_SpawnMaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Montage Forced Net Updates"), STAT_MontageForcedNetUpdates, STATGROUP_SpawnMaster);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Montage Bytes/s Per Pawn"), STAT_MontageBytesPerPawn, STATGROUP_SpawnMaster);
+
+namespace SpawnMasterConsoleVariables
+{
+	static int32 MontageRepMaxNetUpdatesPerFrame = 16;
+	static FAutoConsoleVariableRef CVarMontageRepMaxNetUpdatesPerFrame(
+		TEXT("spawnmaster.MontageRep.MaxNetUpdatesPerFrame"),
+		MontageRepMaxNetUpdatesPerFrame,
+		TEXT("How many actors montages can force a net update for per frame, the rest wait for the next frame"),
+		ECVF_Default);
+
+	static float MontageRepNearDistance = 1500.0f;
+	static FAutoConsoleVariableRef CVarMontageRepNearDistance(
+		TEXT("spawnmaster.MontageRep.NearDistance"),
+		MontageRepNearDistance,
+		TEXT("Within this distance (in uu) of a viewer, montage positions are synced every NearSyncInterval"),
+		ECVF_Default);
+
+	static float MontageRepFarDistance = 5000.0f;
+	static FAutoConsoleVariableRef CVarMontageRepFarDistance(
+		TEXT("spawnmaster.MontageRep.FarDistance"),
+		MontageRepFarDistance,
+		TEXT("Past this distance (in uu) from every viewer, montages only replicate starts and stops"),
+		ECVF_Default);
+
+	static float MontageRepNearSyncInterval = 0.1f;
+	static FAutoConsoleVariableRef CVarMontageRepNearSyncInterval(
+		TEXT("spawnmaster.MontageRep.NearSyncInterval"),
+		MontageRepNearSyncInterval,
+		TEXT("Seconds between montage position syncs for pawns within NearDistance of a viewer"),
+		ECVF_Default);
+
+	static float MontageRepFarSyncInterval = 1.0f;
+	static FAutoConsoleVariableRef CVarMontageRepFarSyncInterval(
+		TEXT("spawnmaster.MontageRep.FarSyncInterval"),
+		MontageRepFarSyncInterval,
+		TEXT("Seconds between montage position syncs for pawns just inside FarDistance of a viewer"),
+		ECVF_Default);
+}
+
+namespace SMMontageReplication
+{
+	// Montage bytes serialized since the bandwidth window started, over every connection.
+	static uint32 BytesSent = 0;
+
+	// How often the bandwidth stat is updated.
+	static constexpr float BandwidthWindow = 1.0f;
+}
+
+USMMontageReplicationSubsystem* USMMontageReplicationSubsystem::Get(const UWorld* World)
+{
+	return World ? World->GetSubsystem<USMMontageReplicationSubsystem>() : nullptr;
+}
+
+bool USMMontageReplicationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* world = Cast<UWorld>(Outer);
+	return world && (world->WorldType == EWorldType::Game || world->WorldType == EWorldType::PIE);
+}
+
+void USMMontageReplicationSubsystem::Deinitialize()
+{
+	PendingNetUpdates.Reset();
+	AbilitySystems.Reset();
+	Viewers.Reset();
+
+	Super::Deinitialize();
+}
+
+TStatId USMMontageReplicationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USMMontageReplicationSubsystem, STATGROUP_Tickables);
+}
+
+bool USMMontageReplicationSubsystem::IsTickable() const
+{
+	// Clients only ever ask for net updates, which they ignore anyway.
+	return PendingNetUpdates.Num() > 0 || AbilitySystems.Num() > 0;
+}
+
+void USMMontageReplicationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MontageReplication)
+
+	const float worldTime = GetWorld()->GetTimeSeconds();
+
+	if (AbilitySystems.Num() > 0)
+	{
+		GatherViewers();
+		SyncMontagePositions(worldTime);
+	}
+
+	// After syncing positions, those can want net updates too.
+	FlushNetUpdates();
+	UpdateBandwidthStat(worldTime);
+}
+
+void USMMontageReplicationSubsystem::RequestNetUpdate(AActor* actor)
+{
+	if (actor && actor->HasAuthority())
+	{
+		PendingNetUpdates.AddUnique(actor);
+	}
+}
+
+void USMMontageReplicationSubsystem::RegisterAbilitySystem(USMAbilitySystemComponent* abilitySystem)
+{
+	if (abilitySystem && !AbilitySystems.Contains(abilitySystem))
+	{
+		FSMMontageRepEntry& entry = AbilitySystems.Add(abilitySystem);
+		entry.AbilitySystem = abilitySystem;
+
+		// Just started a montage, its position went out with the start.
+		entry.LastPositionSyncTime = GetWorld()->GetTimeSeconds();
+	}
+}
+
+bool USMMontageReplicationSubsystem::IsWithinPositionSyncRange(const FVector& location) const
+{
+	const float farDistanceSquared = FMath::Square(SpawnMasterConsoleVariables::MontageRepFarDistance);
+
+	for (FConstPlayerControllerIterator it = GetWorld()->GetPlayerControllerIterator(); it; ++it)
+	{
+		const APlayerController* playerController = it->Get();
+		if (!playerController || !playerController->IsLocalController())
+		{
+			continue;
+		}
+
+		FVector viewLocation;
+		FRotator viewRotation;
+		playerController->GetPlayerViewPoint(viewLocation, viewRotation);
+		if (FVector::DistSquared(viewLocation, location) <= farDistanceSquared)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void USMMontageReplicationSubsystem::AddBytesSent(int32 numBytes)
+{
+	SMMontageReplication::BytesSent += numBytes;
+}
+
+void USMMontageReplicationSubsystem::GatherViewers()
+{
+	Viewers.Reset();
+
+	for (FConstPlayerControllerIterator it = GetWorld()->GetPlayerControllerIterator(); it; ++it)
+	{
+		if (const APlayerController* playerController = it->Get())
+		{
+			FSMMontageViewer& viewer = Viewers.AddDefaulted_GetRef();
+			FRotator viewRotation;
+			playerController->GetPlayerViewPoint(viewer.Location, viewRotation);
+			viewer.Pawn = playerController->GetPawn();
+		}
+	}
+}
+
+void USMMontageReplicationSubsystem::SyncMontagePositions(float worldTime)
+{
+	const float nearDistance = SpawnMasterConsoleVariables::MontageRepNearDistance;
+	const float farDistance = FMath::Max(SpawnMasterConsoleVariables::MontageRepFarDistance, nearDistance + KINDA_SMALL_NUMBER);
+
+	for (auto it = AbilitySystems.CreateIterator(); it; ++it)
+	{
+		FSMMontageRepEntry& entry = it.Value();
+		USMAbilitySystemComponent* abilitySystem = entry.AbilitySystem.Get();
+		const AActor* avatar = abilitySystem ? abilitySystem->GetAvatarActor_Direct() : nullptr;
+		if (!avatar)
+		{
+			it.RemoveCurrent();
+			continue;
+		}
+
+		// Stops always go out, whatever the distance, so far away pawns don't keep playing a montage forever.
+		abilitySystem->UpdateReplicatedMontageStops();
+		if (!abilitySystem->HasActiveReplicatedMontage())
+		{
+			it.RemoveCurrent();
+			continue;
+		}
+
+		const FVector avatarLocation = avatar->GetActorLocation();
+		float closestDistanceSquared = MAX_flt;
+		for (const FSMMontageViewer& viewer : Viewers)
+		{
+			if (viewer.Pawn != avatar)
+			{
+				closestDistanceSquared = FMath::Min(closestDistanceSquared, FVector::DistSquared(viewer.Location, avatarLocation));
+			}
+		}
+
+		// Nobody close enough to see the difference, or the pawn isn't even relevant to anyone.
+		if (closestDistanceSquared > FMath::Square(farDistance) || closestDistanceSquared > avatar->NetCullDistanceSquared)
+		{
+			continue;
+		}
+
+		const float distanceAlpha = FMath::Clamp((FMath::Sqrt(closestDistanceSquared) - nearDistance) / (farDistance - nearDistance), 0.0f, 1.0f);
+		const float syncInterval = FMath::Lerp(SpawnMasterConsoleVariables::MontageRepNearSyncInterval, SpawnMasterConsoleVariables::MontageRepFarSyncInterval, distanceAlpha);
+		if (worldTime - entry.LastPositionSyncTime < syncInterval)
+		{
+			continue;
+		}
+
+		entry.LastPositionSyncTime = worldTime;
+		abilitySystem->UpdateReplicatedMontagePositions();
+	}
+}
+
+void USMMontageReplicationSubsystem::FlushNetUpdates()
+{
+	const int32 numUpdates = FMath::Min(PendingNetUpdates.Num(), FMath::Max(SpawnMasterConsoleVariables::MontageRepMaxNetUpdatesPerFrame, 1));
+	for (int32 updateIdx = 0; updateIdx < numUpdates; updateIdx++)
+	{
+		if (AActor* actor = PendingNetUpdates[updateIdx].Get())
+		{
+			actor->ForceNetUpdate();
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_MontageForcedNetUpdates, numUpdates);
+
+	// Whatever didn't fit in the budget goes first next frame.
+	PendingNetUpdates.RemoveAt(0, numUpdates, /*bAllowShrinking=*/ false);
+}
+
+void USMMontageReplicationSubsystem::UpdateBandwidthStat(float worldTime)
+{
+	if (BandwidthWindowStartTime < 0.0f)
+	{
+		BandwidthWindowStartTime = worldTime;
+		SMMontageReplication::BytesSent = 0;
+		return;
+	}
+
+	const float elapsed = worldTime - BandwidthWindowStartTime;
+	if (elapsed < SMMontageReplication::BandwidthWindow)
+	{
+		return;
+	}
+
+	const int32 numPawns = FMath::Max(AbilitySystems.Num(), 1);
+	SET_FLOAT_STAT(STAT_MontageBytesPerPawn, SMMontageReplication::BytesSent / elapsed / numPawns);
+
+	BandwidthWindowStartTime = worldTime;
+	SMMontageReplication::BytesSent = 0;
+}
@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SMPickupSubsystem.h"
+
+#include "Components/SMEquippableInventoryComponent.h"
+#include "Items/SMItemBase.h"
+#include "SpawnMaster/SpawnMaster.h"
+
+DECLARE_CYCLE_STAT(TEXT("PickupPass"), STAT_PickupPass, STATGROUP_SpawnMaster);
+
+USMPickupSubsystem* USMPickupSubsystem::Get(const UWorld* World)
+{
+	return World ? World->GetSubsystem<USMPickupSubsystem>() : nullptr;
+}
+
+bool USMPickupSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* world = Cast<UWorld>(Outer);
+	return world && (world->WorldType == EWorldType::Game || world->WorldType == EWorldType::PIE);
+}
+
+void USMPickupSubsystem::Deinitialize()
+{
+	Items.Reset();
+	Inventories.Reset();
+	ItemGrid.Reset();
+
+	Super::Deinitialize();
+}
+
+TStatId USMPickupSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USMPickupSubsystem, STATGROUP_Tickables);
+}
+
+bool USMPickupSubsystem::IsTickable() const
+{
+	// Clients never register anything, but there's no point ticking either way if one side is empty.
+	return Items.Num() > 0 && Inventories.Num() > 0;
+}
+
+void USMPickupSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PickupPass)
+
+	BuildItemGrid(GetWorld()->GetTimeSeconds());
+	if (ItemGrid.Num() == 0)
+	{
+		return;
+	}
+
+	// Backwards so an inventory unregistering during a pickup doesn't make us skip one.
+	for (int32 inventoryIdx = Inventories.Num() - 1; inventoryIdx >= 0; inventoryIdx--)
+	{
+		if (!Inventories.IsValidIndex(inventoryIdx))
+		{
+			continue;
+		}
+
+		USMEquippableInventoryComponent* inventory = Inventories[inventoryIdx];
+		if (!IsValid(inventory))
+		{
+			Inventories.RemoveAtSwap(inventoryIdx);
+			continue;
+		}
+
+		// Most pawns (zombies etc) will be skipped here.
+		if (inventory->HasFreeSlot())
+		{
+			PickUpItemsNearInventory(inventory);
+		}
+	}
+}
+
+void USMPickupSubsystem::RegisterItem(ASMItemBase* item)
+{
+	if (item && !Items.Contains(item))
+	{
+		Items.Add(item);
+		MaxItemPickUpRadius = FMath::Max(MaxItemPickUpRadius, item->GetPickUpRadius());
+	}
+}
+
+void USMPickupSubsystem::UnregisterItem(ASMItemBase* item)
+{
+	Items.RemoveSwap(item);
+}
+
+void USMPickupSubsystem::RegisterInventory(USMEquippableInventoryComponent* inventory)
+{
+	if (inventory)
+	{
+		Inventories.AddUnique(inventory);
+	}
+}
+
+void USMPickupSubsystem::UnregisterInventory(USMEquippableInventoryComponent* inventory)
+{
+	Inventories.RemoveSwap(inventory);
+}
+
+FIntPoint USMPickupSubsystem::GetCellForLocation(const FVector& location) const
+{
+	return FIntPoint(FMath::FloorToInt(location.X / CellSize), FMath::FloorToInt(location.Y / CellSize));
+}
+
+void USMPickupSubsystem::BuildItemGrid(float worldTime)
+{
+	ItemGrid.Reset();
+
+	for (int32 itemIdx = Items.Num() - 1; itemIdx >= 0; itemIdx--)
+	{
+		ASMItemBase* item = Items[itemIdx];
+		if (!IsValid(item))
+		{
+			Items.RemoveAtSwap(itemIdx);
+			continue;
+		}
+
+		if (item->IsReadyForPickUp(worldTime))
+		{
+			ItemGrid.Add(GetCellForLocation(item->GetActorLocation()), item);
+		}
+	}
+}
+
+void USMPickupSubsystem::PickUpItemsNearInventory(USMEquippableInventoryComponent* inventory)
+{
+	const AActor* inventoryOwner = inventory->GetOwner();
+	if (!inventoryOwner)
+	{
+		return;
+	}
+
+	float ownerRadius = 0.f;
+	float ownerHalfHeight = 0.f;
+	inventoryOwner->GetSimpleCollisionCylinder(ownerRadius, ownerHalfHeight);
+
+	const FVector ownerLocation = inventoryOwner->GetActorLocation();
+	const FIntPoint minCell = GetCellForLocation(ownerLocation - FVector(ownerRadius + MaxItemPickUpRadius));
+	const FIntPoint maxCell = GetCellForLocation(ownerLocation + FVector(ownerRadius + MaxItemPickUpRadius));
+
+	for (int32 cellX = minCell.X; cellX <= maxCell.X; cellX++)
+	{
+		for (int32 cellY = minCell.Y; cellY <= maxCell.Y; cellY++)
+		{
+			for (TMultiMap<FIntPoint, ASMItemBase*>::TConstKeyIterator it = ItemGrid.CreateConstKeyIterator(FIntPoint(cellX, cellY)); it; ++it)
+			{
+				ASMItemBase* item = it.Value();
+
+				// Someone earlier in this pass may have already picked it up.
+				if (!IsValid(item) || item->GetOwner() != nullptr)
+				{
+					continue;
+				}
+
+				// Same test the old overlap sphere did against the character capsule, just done as sphere vs cylinder.
+				const FVector delta = item->GetActorLocation() - ownerLocation;
+				const float itemRadius = item->GetPickUpRadius();
+				const bool bInRadius = delta.SizeSquared2D() <= FMath::Square(ownerRadius + itemRadius);
+				const bool bInHeight = FMath::Abs(delta.Z) <= ownerHalfHeight + itemRadius;
+				if (bInRadius && bInHeight && item->CanBePickedUpBy(inventory))
+				{
+					item->OnPickUp(inventory);
+
+					// Items that aren't taken into the inventory (OnPickUp doesn't give them an owner) stay in the grid,
+					// so wait a bit before offering them again instead of calling OnPickUp every frame.
+					if (IsValid(item) && item->GetOwner() == nullptr)
+					{
+						item->SetDropTime(PickUpRetryInterval);
+					}
+
+					if (!inventory->HasFreeSlot())
+					{
+						return;
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,187 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SMTeamSubsystem.h"
+
+#include "Settings/SMCombatSettings.h"
+#include "SpawnMaster/SpawnMaster.h"
+
+USMTeamSubsystem* USMTeamSubsystem::Get(const UWorld* World)
+{
+	return World ? World->GetSubsystem<USMTeamSubsystem>() : nullptr;
+}
+
+bool USMTeamSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* world = Cast<UWorld>(Outer);
+	return world && (world->WorldType == EWorldType::Game || world->WorldType == EWorldType::PIE);
+}
+
+void USMTeamSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TeamTags.Reset();
+	TeamTags.Add(FGameplayTag());
+	AllyMasks.Init(0, MaxTeams);
+	HostileMasks.Init(0, MaxTeams);
+	TeamMembers.SetNum(MaxTeams);
+
+	// Give every configured team its index up front, then work out the alliances between them
+	const TArray<FSMTeamDefinition>& teams = GetDefault<USMCombatSettings>()->GetTeams();
+	for (const FSMTeamDefinition& definition : teams)
+	{
+		GetTeamIndex(definition.Team);
+	}
+
+	for (const FSMTeamDefinition& definition : teams)
+	{
+		const uint8 teamIdx = GetTeamIndex(definition.Team);
+		for (const FGameplayTag& ally : definition.Allies)
+		{
+			const uint8 allyIdx = GetTeamIndex(ally);
+			if (teamIdx != 0 && allyIdx != 0)
+			{
+				AllyMasks[teamIdx] |= 1u << allyIdx;
+				AllyMasks[allyIdx] |= 1u << teamIdx;
+			}
+		}
+	}
+
+	RebuildHostileMasks();
+}
+
+void USMTeamSubsystem::Deinitialize()
+{
+	TeamMembers.Reset();
+	ActorTeamIndices.Reset();
+
+	Super::Deinitialize();
+}
+
+uint8 USMTeamSubsystem::GetTeamIndex(const FGameplayTag& team)
+{
+	if (!team.IsValid())
+	{
+		return 0;
+	}
+
+	const int32 existingIdx = TeamTags.IndexOfByKey(team);
+	if (existingIdx != INDEX_NONE)
+	{
+		return static_cast<uint8>(existingIdx);
+	}
+
+	if (TeamTags.Num() >= MaxTeams)
+	{
+		SM_LOG(Error, TEXT("USMTeamSubsystem: Can't have more than %d teams, %s is treated as no team."), MaxTeams - 1, *team.ToString())
+		return 0;
+	}
+
+	const uint8 newIdx = static_cast<uint8>(TeamTags.Add(team));
+	RebuildHostileMasks();
+	return newIdx;
+}
+
+FGameplayTag USMTeamSubsystem::GetTeamTag(uint8 teamIndex) const
+{
+	return TeamTags.IsValidIndex(teamIndex) ? TeamTags[teamIndex] : FGameplayTag();
+}
+
+void USMTeamSubsystem::RebuildHostileMasks()
+{
+	// No team is hostile to everyone, itself included. Everything else is hostile to anything that isn't itself or an ally.
+	HostileMasks[0] = MAX_uint32;
+	for (int32 teamIdx = 1; teamIdx < MaxTeams; teamIdx++)
+	{
+		HostileMasks[teamIdx] = ~(AllyMasks[teamIdx] | (1u << teamIdx));
+	}
+}
+
+void USMTeamSubsystem::SetActorTeam(AActor* actor, const FGameplayTag& team)
+{
+	if (!actor)
+	{
+		return;
+	}
+
+	const uint8 newIdx = GetTeamIndex(team);
+
+	if (uint8* currentIdx = ActorTeamIndices.Find(actor))
+	{
+		if (*currentIdx == newIdx)
+		{
+			return;
+		}
+
+		TeamMembers[*currentIdx].Actors.RemoveSwap(actor);
+		*currentIdx = newIdx;
+	}
+	else
+	{
+		ActorTeamIndices.Add(actor, newIdx);
+	}
+
+	TeamMembers[newIdx].Actors.Add(actor);
+}
+
+void USMTeamSubsystem::UnregisterActor(AActor* actor)
+{
+	uint8 teamIdx = 0;
+	if (ActorTeamIndices.RemoveAndCopyValue(actor, teamIdx))
+	{
+		TeamMembers[teamIdx].Actors.RemoveSwap(actor);
+	}
+}
+
+int32 USMTeamSubsystem::GetActorTeamIndex(const AActor* actor) const
+{
+	const uint8* teamIdx = ActorTeamIndices.Find(actor);
+	return teamIdx ? static_cast<int32>(*teamIdx) : INDEX_NONE;
+}
+
+FGameplayTag USMTeamSubsystem::GetActorTeam(const AActor* actor) const
+{
+	const int32 teamIdx = GetActorTeamIndex(actor);
+	return teamIdx != INDEX_NONE ? TeamTags[teamIdx] : FGameplayTag();
+}
+
+bool USMTeamSubsystem::AreHostile(const AActor* actorA, const AActor* actorB) const
+{
+	const uint8* teamIdxA = ActorTeamIndices.Find(actorA);
+	const uint8* teamIdxB = ActorTeamIndices.Find(actorB);
+	return teamIdxA && teamIdxB && AreTeamsHostile(*teamIdxA, *teamIdxB);
+}
+
+void USMTeamSubsystem::GetHostilePawnsInRadius(const AActor* querier, const FVector& origin, float radius, TArray<APawn*>& outPawns) const
+{
+	const int32 querierIdx = GetActorTeamIndex(querier);
+	if (querierIdx == INDEX_NONE)
+	{
+		return;
+	}
+
+	const float radiusSquared = FMath::Square(radius);
+
+	// Only walk the members of teams we are hostile to
+	uint32 hostileMask = HostileMasks[querierIdx];
+	while (hostileMask != 0)
+	{
+		const int32 teamIdx = FMath::CountTrailingZeros(hostileMask);
+		hostileMask &= hostileMask - 1;
+
+		if (!TeamTags.IsValidIndex(teamIdx))
+		{
+			break;
+		}
+
+		for (AActor* actor : TeamMembers[teamIdx].Actors)
+		{
+			APawn* pawn = Cast<APawn>(actor);
+			if (pawn && pawn != querier && FVector::DistSquared(pawn->GetActorLocation(), origin) <= radiusSquared)
+			{
+				outPawns.Add(pawn);
+			}
+		}
+	}
+}
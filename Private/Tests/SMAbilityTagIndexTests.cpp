@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GAS/SMAbilitySystemComponent.h"
+
+#include "Abilities/GameplayAbility.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "NativeGameplayTags.h"
+#include "Tests/SMTestWorld.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SMAbilityTagIndexTests
+{
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(Ability, "SpawnMaster.Test.Ability");
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(Ability_Fire, "SpawnMaster.Test.Ability.Fire");
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(Ability_Reload, "SpawnMaster.Test.Ability.Reload");
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(Ability_Rechamber, "SpawnMaster.Test.Ability.Rechamber");
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(Ability_Other, "SpawnMaster.Test.Ability.Other");
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(Blocked, "SpawnMaster.Test.Blocked");
+
+	// More than a character ends up with once every equippable has given its abilities.
+	static constexpr int32 AbilityCount = 64;
+
+	// Ability tags are only set in Blueprint defaults, tests reach them through reflection.
+	void SetTagContainerProperty(UGameplayAbility* ability, FName propertyName, const FGameplayTagContainer& tags)
+	{
+		const FStructProperty* property = CastField<FStructProperty>(UGameplayAbility::StaticClass()->FindPropertyByName(propertyName));
+		check(property && property->Struct == FGameplayTagContainer::StaticStruct());
+		*property->ContainerPtrToValuePtr<FGameplayTagContainer>(ability) = tags;
+	}
+
+	/* Gives AbilityCount abilities spread over fire, reload and other tags, with a single one tagged rechamber like a
+	 * manual rechamber gun has. All of them are blocked while the ability system has the blocked tag. */
+	USMAbilitySystemComponent* SpawnWithAbilities(UWorld* world)
+	{
+		AActor* actor = world->SpawnActor<AActor>();
+		USMAbilitySystemComponent* abilitySystem = NewObject<USMAbilitySystemComponent>(actor);
+		abilitySystem->RegisterComponent();
+		abilitySystem->InitAbilityActorInfo(actor, actor);
+
+		const FGameplayTag fillerTags[] = { Ability_Fire, Ability_Reload, Ability_Other };
+		for (int32 abilityIdx = 0; abilityIdx < AbilityCount; abilityIdx++)
+		{
+			UGameplayAbility* ability = NewObject<UGameplayAbility>(GetTransientPackage());
+			const FGameplayTag abilityTag = abilityIdx == AbilityCount / 2 ? FGameplayTag(Ability_Rechamber) : fillerTags[abilityIdx % UE_ARRAY_COUNT(fillerTags)];
+			SetTagContainerProperty(ability, TEXT("AbilityTags"), FGameplayTagContainer(abilityTag));
+			SetTagContainerProperty(ability, TEXT("ActivationBlockedTags"), FGameplayTagContainer(Blocked));
+			abilitySystem->GiveAbility(FGameplayAbilitySpec(ability));
+		}
+
+		return abilitySystem;
+	}
+
+	// What TryActivateAbilitiesByTag activates from, as handles.
+	TArray<FGameplayAbilitySpecHandle> FindSpecsByMatchingTags(const USMAbilitySystemComponent* abilitySystem, const FGameplayTag& tag)
+	{
+		TArray<FGameplayAbilitySpec*> specs;
+		abilitySystem->GetActivatableGameplayAbilitySpecsByAllMatchingTags(FGameplayTagContainer(tag), specs, /*bOnlyAbilitiesThatSatisfyTagRequirements=*/ false);
+
+		TArray<FGameplayAbilitySpecHandle> handles;
+		for (const FGameplayAbilitySpec* spec : specs)
+		{
+			handles.Add(spec->Handle);
+		}
+		return handles;
+	}
+
+	bool HaveSameHandles(TArray<FGameplayAbilitySpecHandle> a, TArray<FGameplayAbilitySpecHandle> b)
+	{
+		auto byHandle = [](const FGameplayAbilitySpecHandle& lhs, const FGameplayAbilitySpecHandle& rhs) { return GetTypeHash(lhs) < GetTypeHash(rhs); };
+		a.Sort(byHandle);
+		b.Sort(byHandle);
+		return a == b;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMAbilityTagIndexMatchesTagQueryTest, "SpawnMaster.AbilitySystem.TagIndexMatchesTagQuery", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMAbilityTagIndexMatchesTagQueryTest::RunTest(const FString& Parameters)
+{
+	using namespace SMAbilityTagIndexTests;
+
+	const FSMScopedTestWorld testWorld;
+	USMAbilitySystemComponent* abilitySystem = SpawnWithAbilities(testWorld.World);
+
+	// The parent tag matches every ability, the same as it does for TryActivateAbilitiesByTag.
+	for (const FGameplayTag& tag : { FGameplayTag(Ability), FGameplayTag(Ability_Fire), FGameplayTag(Ability_Rechamber), FGameplayTag(Blocked) })
+	{
+		TArray<FGameplayAbilitySpecHandle> indexedHandles;
+		abilitySystem->FindSpecsByTag(tag, indexedHandles);
+		TestTrue(FString::Printf(TEXT("Index finds the same specs as the tag query for %s"), *tag.ToString()), HaveSameHandles(indexedHandles, FindSpecsByMatchingTags(abilitySystem, tag)));
+	}
+
+	TArray<FGameplayAbilitySpecHandle> rechamberHandles;
+	abilitySystem->FindSpecsByTag(Ability_Rechamber, rechamberHandles);
+	TestEqual(TEXT("One rechamber ability"), rechamberHandles.Num(), 1);
+
+	// Removed abilities leave the index.
+	if (rechamberHandles.Num() == 1)
+	{
+		abilitySystem->ClearAbility(rechamberHandles[0]);
+		rechamberHandles.Reset();
+		abilitySystem->FindSpecsByTag(Ability_Rechamber, rechamberHandles);
+		TestEqual(TEXT("Cleared rechamber ability is gone from the index"), rechamberHandles.Num(), 0);
+
+		TArray<FGameplayAbilitySpecHandle> allHandles;
+		abilitySystem->FindSpecsByTag(Ability, allHandles);
+		TestEqual(TEXT("Cleared ability is gone from its parent tag too"), allHandles.Num(), AbilityCount - 1);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMAbilityTagIndexBenchmarkTest, "SpawnMaster.AbilitySystem.TagIndexBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMAbilityTagIndexBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace SMAbilityTagIndexTests;
+
+	const FSMScopedTestWorld testWorld;
+	USMAbilitySystemComponent* abilitySystem = SpawnWithAbilities(testWorld.World);
+
+	/* Blocked, so both ways find the rechamber ability and stop at its tag requirements. Activating it would run the
+	 * same code either way, what differs is finding it. */
+	abilitySystem->AddLooseGameplayTag(Blocked);
+
+	static constexpr int32 CallCount = 100000;
+
+	// Built every call, like ASMManualRechamberGunBase::CheckForReChamber does.
+	int32 tagQueryActivations = 0;
+	const double tagQueryStart = FPlatformTime::Seconds();
+	for (int32 callIdx = 0; callIdx < CallCount; callIdx++)
+	{
+		tagQueryActivations += abilitySystem->TryActivateAbilitiesByTag(FGameplayTagContainer(Ability_Rechamber)) ? 1 : 0;
+	}
+	const double tagQuerySeconds = FPlatformTime::Seconds() - tagQueryStart;
+
+	int32 indexActivations = 0;
+	const double indexStart = FPlatformTime::Seconds();
+	for (int32 callIdx = 0; callIdx < CallCount; callIdx++)
+	{
+		indexActivations += abilitySystem->TryActivateAbilityByTagFast(Ability_Rechamber) ? 1 : 0;
+	}
+	const double indexSeconds = FPlatformTime::Seconds() - indexStart;
+
+	TestEqual(TEXT("Blocked ability never activates through the tag query"), tagQueryActivations, 0);
+	TestEqual(TEXT("Blocked ability never activates through the index"), indexActivations, 0);
+
+	// The lookups on their own, without the tag requirement checks.
+	int32 matchingSpecCount = 0;
+	TArray<FGameplayAbilitySpec*> matchingSpecs;
+	const double matchingStart = FPlatformTime::Seconds();
+	for (int32 callIdx = 0; callIdx < CallCount; callIdx++)
+	{
+		matchingSpecs.Reset();
+		abilitySystem->GetActivatableGameplayAbilitySpecsByAllMatchingTags(FGameplayTagContainer(Ability_Rechamber), matchingSpecs, /*bOnlyAbilitiesThatSatisfyTagRequirements=*/ false);
+		matchingSpecCount += matchingSpecs.Num();
+	}
+	const double matchingSeconds = FPlatformTime::Seconds() - matchingStart;
+
+	int32 indexedSpecCount = 0;
+	TArray<FGameplayAbilitySpecHandle> indexedHandles;
+	const double findStart = FPlatformTime::Seconds();
+	for (int32 callIdx = 0; callIdx < CallCount; callIdx++)
+	{
+		indexedHandles.Reset();
+		abilitySystem->FindSpecsByTag(Ability_Rechamber, indexedHandles);
+		indexedSpecCount += indexedHandles.Num();
+	}
+	const double findSeconds = FPlatformTime::Seconds() - findStart;
+
+	TestEqual(TEXT("Both lookups find the rechamber ability every call"), indexedSpecCount, matchingSpecCount);
+
+	AddInfo(FString::Printf(TEXT("%i abilities, %i calls: TryActivateAbilitiesByTag %.1fns, TryActivateAbilityByTagFast %.1fns (%.1fx); GetActivatableGameplayAbilitySpecsByAllMatchingTags %.1fns, FindSpecsByTag %.1fns (%.1fx)"),
+		AbilityCount, CallCount, tagQuerySeconds * 1.0e9 / CallCount, indexSeconds * 1.0e9 / CallCount, indexSeconds > 0.0 ? tagQuerySeconds / indexSeconds : 0.0,
+		matchingSeconds * 1.0e9 / CallCount, findSeconds * 1.0e9 / CallCount, findSeconds > 0.0 ? matchingSeconds / findSeconds : 0.0));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
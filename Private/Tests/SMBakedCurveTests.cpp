@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Items/SMBakedCurve.h"
+
+#include "Curves/RichCurve.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SMBakedCurveTests
+{
+	// Shaped like a heat curve: cubic keys (auto tangents) over 0-10 that rise, level off and drop at the end.
+	FRichCurve MakeHeatLikeCurve()
+	{
+		FRichCurve curve;
+		for (const FVector2f& key : { FVector2f(0.0f, 1.0f), FVector2f(2.5f, 4.0f), FVector2f(5.0f, 5.0f), FVector2f(7.5f, 5.5f), FVector2f(10.0f, 2.0f) })
+		{
+			curve.SetKeyInterpMode(curve.AddKey(key.X, key.Y), RCIM_Cubic);
+		}
+		return curve;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMBakedCurveMatchesRichCurveTest, "SpawnMaster.BakedCurve.MatchesRichCurve", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMBakedCurveMatchesRichCurveTest::RunTest(const FString& Parameters)
+{
+	using namespace SMBakedCurveTests;
+
+	const FRichCurve curve = MakeHeatLikeCurve();
+	FSMBakedCurve baked;
+	baked.Bake(curve);
+
+	// Linear interpolation between 128 samples of a smooth curve, against a value range of about 4.5.
+	static constexpr float Tolerance = 0.01f;
+
+	// Across the key range and past both ends, where both clamp to the end keys.
+	float maxError = 0.0f;
+	for (float time = -2.0f; time <= 12.0f; time += 0.01f)
+	{
+		maxError = FMath::Max(maxError, FMath::Abs(baked.Eval(time) - curve.Eval(time)));
+	}
+	TestTrue(FString::Printf(TEXT("Baked curve is within %f of the rich curve (max error %f)"), Tolerance, maxError), maxError <= Tolerance);
+
+	// Samples land on the end keys exactly.
+	TestEqual(TEXT("First key"), baked.Eval(0.0f), curve.Eval(0.0f), KINDA_SMALL_NUMBER);
+	TestEqual(TEXT("Last key"), baked.Eval(10.0f), curve.Eval(10.0f), KINDA_SMALL_NUMBER);
+	TestEqual(TEXT("Curve is flat below its first key"), baked.GetFlatBelow(), 0.0f);
+
+	// A single key curve is the same value everywhere.
+	FRichCurve flatCurve;
+	flatCurve.AddKey(3.0f, 7.0f);
+	FSMBakedCurve bakedFlat;
+	bakedFlat.Bake(flatCurve);
+	TestEqual(TEXT("Flat curve below its key"), bakedFlat.Eval(-100.0f), 7.0f);
+	TestEqual(TEXT("Flat curve above its key"), bakedFlat.Eval(100.0f), 7.0f);
+	TestEqual(TEXT("Flat curve is flat everywhere"), bakedFlat.GetFlatBelow(), MAX_flt);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMBakedCurveBenchmarkTest, "SpawnMaster.BakedCurve.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMBakedCurveBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace SMBakedCurveTests;
+
+	const FRichCurve curve = MakeHeatLikeCurve();
+	FSMBakedCurve baked;
+	baked.Bake(curve);
+
+	// The same random heats for both, so neither gets a more cache friendly access pattern.
+	static constexpr int32 EvalCount = 1000000;
+	TArray<float> times;
+	times.SetNumUninitialized(EvalCount);
+	FRandomStream timeStream(7);
+	for (float& time : times)
+	{
+		time = timeStream.FRandRange(-1.0f, 11.0f);
+	}
+
+	// Sums are reported so the evaluations can't be optimized away.
+	double richSum = 0.0;
+	const double richStart = FPlatformTime::Seconds();
+	for (const float time : times)
+	{
+		richSum += curve.Eval(time);
+	}
+	const double richSeconds = FPlatformTime::Seconds() - richStart;
+
+	double bakedSum = 0.0;
+	const double bakedStart = FPlatformTime::Seconds();
+	for (const float time : times)
+	{
+		bakedSum += baked.Eval(time);
+	}
+	const double bakedSeconds = FPlatformTime::Seconds() - bakedStart;
+
+	AddInfo(FString::Printf(TEXT("%i evaluations: FRichCurve::Eval %.2fms (%.1fns each, sum %.1f), FSMBakedCurve::Eval %.2fms (%.1fns each, sum %.1f), %.1fx"),
+		EvalCount, richSeconds * 1000.0, richSeconds * 1.0e9 / EvalCount, richSum, bakedSeconds * 1000.0, bakedSeconds * 1.0e9 / EvalCount, bakedSum,
+		bakedSeconds > 0.0 ? richSeconds / bakedSeconds : 0.0));
+
+	// Same values give the same sums, give or take the baking error.
+	TestEqual(TEXT("Baked and rich curve sums"), bakedSum / EvalCount, richSum / EvalCount, 0.01);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
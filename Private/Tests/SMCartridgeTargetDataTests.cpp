@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GAS/SMCartridgeTargetData.h"
+
+#include "Misc/AutomationTest.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SMCartridgeTargetDataTests
+{
+	/* Hits and pellets in these tests aren't on real actors, so whether something can take damage is marked on the hit
+	 * itself: Item on hit results and BoneIndex on pellets are 1 for things with an ability system. */
+	FHitResult MakeHit(float distance, bool bBlocking, bool bCanTakeDamage)
+	{
+		FHitResult hit(ForceInit);
+		hit.Distance = distance;
+		hit.bBlockingHit = bBlocking;
+		hit.Item = bCanTakeDamage ? 1 : 0;
+		return hit;
+	}
+
+	bool HitCanTakeDamage(const FHitResult& hit)
+	{
+		return hit.Item == 1;
+	}
+
+	FSMPelletHit MakePellet(uint8 pelletIdx, uint32 distance, bool bCanTakeDamage)
+	{
+		FSMPelletHit pellet;
+		pellet.PelletIndex = pelletIdx;
+		pellet.Distance = distance;
+		pellet.BoneIndex = bCanTakeDamage ? 1 : INDEX_NONE;
+		pellet.bHit = true;
+		return pellet;
+	}
+
+	bool PelletCanTakeDamage(const FSMPelletHit& pellet)
+	{
+		return pellet.BoneIndex == 1;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMCartridgePelletStopTest, "SpawnMaster.Cartridge.PelletStop", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMCartridgePelletStopTest::RunTest(const FString& Parameters)
+{
+	using namespace SMCartridgeTargetDataTests;
+
+	// An overlap on something without an ability system (a trigger, foliage) in front of a character.
+	{
+		const TArray<FHitResult> hits = { MakeHit(100.0f, false, false), MakeHit(200.0f, false, true), MakeHit(300.0f, true, false) };
+		TestEqual(TEXT("Pellet goes through the overlap and stops on the damageable hit"), FSMCartridgeTargetData::FindPelletStop(hits, HitCanTakeDamage), 1);
+	}
+
+	// A wall in front of a character.
+	{
+		const TArray<FHitResult> hits = { MakeHit(50.0f, true, false), MakeHit(200.0f, false, true) };
+		TestEqual(TEXT("Pellet stops on the blocking hit in front"), FSMCartridgeTargetData::FindPelletStop(hits, HitCanTakeDamage), 0);
+	}
+
+	// Hitbox hits are added after the trace results, so the nearest one has to win wherever it is.
+	{
+		const TArray<FHitResult> hits = { MakeHit(80.0f, false, false), MakeHit(300.0f, true, false), MakeHit(150.0f, true, true) };
+		TestEqual(TEXT("Nearest stop wins regardless of order"), FSMCartridgeTargetData::FindPelletStop(hits, HitCanTakeDamage), 2);
+	}
+
+	// Nothing but overlaps on things that can't take damage.
+	{
+		const TArray<FHitResult> hits = { MakeHit(100.0f, false, false), MakeHit(200.0f, false, false) };
+		TestEqual(TEXT("Pellet that only went through overlaps doesn't stop"), FSMCartridgeTargetData::FindPelletStop(hits, HitCanTakeDamage), static_cast<int32>(INDEX_NONE));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMCartridgeRemoveDuplicatePelletsTest, "SpawnMaster.Cartridge.RemoveDuplicatePellets", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMCartridgeRemoveDuplicatePelletsTest::RunTest(const FString& Parameters)
+{
+	using namespace SMCartridgeTargetDataTests;
+
+	FSMCartridgeTargetData cartridge;
+
+	// Pellet 0: an overlap on something that can't take damage in front of a character.
+	cartridge.Pellets.Add(MakePellet(0, 100, false));
+	cartridge.Pellets.Add(MakePellet(0, 200, true));
+	// Pellet 1: sent twice on damageable things, only the first counts.
+	cartridge.Pellets.Add(MakePellet(1, 300, true));
+	cartridge.Pellets.Add(MakePellet(1, 400, true));
+	// Pellet 2: two hits on things that can't take damage, the first is kept for effects.
+	cartridge.Pellets.Add(MakePellet(2, 500, false));
+	cartridge.Pellets.Add(MakePellet(2, 600, false));
+	// Pellet 0 again: a later damageable hit doesn't replace the one that already counted.
+	cartridge.Pellets.Add(MakePellet(0, 700, true));
+	// Pellet 9: more pellets than the gun fires.
+	cartridge.Pellets.Add(MakePellet(9, 800, true));
+
+	cartridge.RemoveDuplicatePellets(4, PelletCanTakeDamage);
+
+	TestEqual(TEXT("One entry per pellet"), cartridge.Pellets.Num(), 3);
+	if (cartridge.Pellets.Num() == 3)
+	{
+		TestEqual(TEXT("Pellet 0 keeps the damageable hit behind the overlap"), static_cast<int32>(cartridge.Pellets[0].Distance), 200);
+		TestEqual(TEXT("Pellet 1 keeps its first damageable hit"), static_cast<int32>(cartridge.Pellets[1].Distance), 300);
+		TestEqual(TEXT("Pellet 2 keeps its first hit"), static_cast<int32>(cartridge.Pellets[2].Distance), 500);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMCartridgeInterpolationDelayTest, "SpawnMaster.Cartridge.InterpolationDelay", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMCartridgeInterpolationDelayTest::RunTest(const FString& Parameters)
+{
+	FSMCartridgeTargetData cartridge;
+	cartridge.SetInterpolationDelay(0.1f);
+	TestEqual(TEXT("Movement smoothing's default delay survives quantizing"), cartridge.GetInterpolationDelay(), 0.1f, 0.0005f);
+
+	// The server clamps it again, the byte only keeps a bogus value from wrapping around.
+	FSMCartridgeTargetData laggyCartridge;
+	laggyCartridge.SetInterpolationDelay(2.0f);
+	TestEqual(TEXT("Long delays are sent as the longest one that fits"), laggyCartridge.GetInterpolationDelay(), 0.255f, 0.0005f);
+	laggyCartridge.SetInterpolationDelay(-1.0f);
+	TestEqual(TEXT("Negative delays are sent as none"), laggyCartridge.GetInterpolationDelay(), 0.0f);
+
+	// Goes over the network with the rest of the cartridge. No pellets, so nothing needs a package map.
+	TArray<uint8> bytes;
+	FMemoryWriter writer(bytes);
+	bool bSuccess = false;
+	cartridge.NetSerialize(writer, nullptr, bSuccess);
+
+	FSMCartridgeTargetData received;
+	FMemoryReader reader(bytes);
+	received.NetSerialize(reader, nullptr, bSuccess);
+	TestTrue(TEXT("Cartridge serialized"), bSuccess && !reader.IsError());
+	TestEqual(TEXT("Interpolation delay is received"), static_cast<int32>(received.InterpolationDelayMs), static_cast<int32>(cartridge.InterpolationDelayMs));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
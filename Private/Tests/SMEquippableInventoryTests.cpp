@@ -0,0 +1,563 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/SMEquippableInventoryComponent.h"
+
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "NativeGameplayTags.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SMEquippableInventoryTests
+{
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_TestSlot_Primary, "EquippableSlot.Test.Primary");
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_TestSlot_Secondary, "EquippableSlot.Test.Secondary");
+	UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_TestSlot_Throwable, "EquippableSlot.Test.Throwable");
+
+	/* The inventory index and entry list only ever use equippables as keys, so the tests hand out unique addresses
+	 * instead of spawning actors (ASMEquippableBase is abstract). These are never dereferenced. */
+	struct FFakeEquippables
+	{
+		explicit FFakeEquippables(int32 count)
+		{
+			Storage.SetNumZeroed(count);
+		}
+
+		ASMEquippableBase* Get(int32 idx) const
+		{
+			return reinterpret_cast<ASMEquippableBase*>(const_cast<uint8*>(&Storage[idx]));
+		}
+
+		TArray<uint8> Storage;
+	};
+
+	// Slots with a mix of full, partial and empty slot inventories, plus a duplicate slot tag.
+	TArray<FInventorySlot> MakeTestInventory(const FFakeEquippables& equippables)
+	{
+		TArray<FInventorySlot> inventory;
+		inventory.Emplace(TAG_TestSlot_Primary, 2);
+		inventory.Emplace(TAG_TestSlot_Secondary, 3);
+		inventory.Emplace(TAG_TestSlot_Throwable, 4);
+		inventory.Emplace(TAG_TestSlot_Primary, 2);
+
+		inventory[0].SlotInventory = { equippables.Get(0), equippables.Get(1) };
+		inventory[2].SlotInventory = { equippables.Get(2), equippables.Get(3), equippables.Get(4) };
+		inventory[3].SlotInventory = { equippables.Get(5) };
+		return inventory;
+	}
+
+	/* Copy of the slot search Next/PreviousEquippable did before FInventoryIndex, from startSlotIdx and walking each slot
+	 * inventory forwards or backwards. Previous steps to the slot before with a plain %, which goes -1, -2... from the
+	 * first slot. Those are never valid, so previous never wrapped around to the last slot. */
+	ASMEquippableBase* BaselineFindToCycleTo(const TArray<FInventorySlot>& inventory, int32 startSlotIdx, int32 direction, TFunctionRef<bool(ASMEquippableBase*)> predicate)
+	{
+		const int32 slotCount = inventory.Num();
+		int32 slotIdx = startSlotIdx;
+		for (int32 slotsSearched = 0; slotsSearched < slotCount; slotsSearched++)
+		{
+			if (inventory.IsValidIndex(slotIdx))
+			{
+				const TArray<ASMEquippableBase*>& slotInventory = inventory[slotIdx].SlotInventory;
+				for (int32 offset = 0; offset < slotInventory.Num(); offset++)
+				{
+					ASMEquippableBase* equippable = slotInventory[direction > 0 ? offset : slotInventory.Num() - 1 - offset];
+					if (predicate(equippable))
+					{
+						return equippable;
+					}
+				}
+			}
+
+			slotIdx = (slotIdx + direction) % slotCount;
+		}
+
+		return nullptr;
+	}
+
+	// The baseline search with the one change FInventoryIndex makes on purpose: previous wraps from the first slot to
+	// the last, like next always wrapped from the last slot to the first.
+	ASMEquippableBase* LinearFindToCycleTo(const TArray<FInventorySlot>& inventory, int32 startSlotIdx, int32 direction, TFunctionRef<bool(ASMEquippableBase*)> predicate)
+	{
+		const int32 slotCount = inventory.Num();
+		int32 slotIdx = ((startSlotIdx % slotCount) + slotCount) % slotCount;
+		for (int32 slotsSearched = 0; slotsSearched < slotCount; slotsSearched++)
+		{
+			const TArray<ASMEquippableBase*>& slotInventory = inventory[slotIdx].SlotInventory;
+			for (int32 offset = 0; offset < slotInventory.Num(); offset++)
+			{
+				ASMEquippableBase* equippable = slotInventory[direction > 0 ? offset : slotInventory.Num() - 1 - offset];
+				if (predicate(equippable))
+				{
+					return equippable;
+				}
+			}
+
+			slotIdx = (slotIdx + direction + slotCount) % slotCount;
+		}
+
+		return nullptr;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMInventoryIndexMatchesLinearScanTest, "SpawnMaster.Inventory.IndexMatchesLinearScan", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMInventoryIndexMatchesLinearScanTest::RunTest(const FString& Parameters)
+{
+	using namespace SMEquippableInventoryTests;
+
+	const FFakeEquippables equippables(6);
+	const TArray<FInventorySlot> inventory = MakeTestInventory(equippables);
+
+	FInventoryIndex index;
+	index.Rebuild(inventory);
+
+	// Slot lookup finds the first slot with the tag, same as the old linear search.
+	for (const FGameplayTag& slotTag : { FGameplayTag(TAG_TestSlot_Primary), FGameplayTag(TAG_TestSlot_Secondary), FGameplayTag(TAG_TestSlot_Throwable) })
+	{
+		const int32* slotIdx = index.SlotIndexByTag.Find(slotTag);
+		TestTrue(FString::Printf(TEXT("%s has a slot index"), *slotTag.ToString()), slotIdx != nullptr);
+		if (slotIdx)
+		{
+			TestEqual(FString::Printf(TEXT("%s slot index"), *slotTag.ToString()), *slotIdx, inventory.IndexOfByKey(slotTag));
+		}
+	}
+
+	// Every equippable is found where a linear search would find it.
+	for (int32 slotIdx = 0; slotIdx < inventory.Num(); slotIdx++)
+	{
+		for (int32 position = 0; position < inventory[slotIdx].SlotInventory.Num(); position++)
+		{
+			const FInventoryEquippableLocation* location = index.LocationByEquippable.Find(inventory[slotIdx].SlotInventory[position]);
+			if (!TestNotNull(TEXT("Equippable is in the index"), location))
+			{
+				continue;
+			}
+
+			TestEqual(TEXT("Slot index"), location->SlotIndex, slotIdx);
+			TestEqual(TEXT("Position in slot"), location->Position, position);
+			TestEqual(TEXT("Cycle order entry"), index.CycleOrder[location->CycleIndex], inventory[slotIdx].SlotInventory[position]);
+		}
+	}
+	TestEqual(TEXT("Cycle order holds every equippable"), index.CycleOrder.Num(), equippables.Storage.Num());
+
+	// Cycling picks the same equippable as searching the slots one by one. Try every combination of equippables the
+	// predicate rejects so the search has to skip over empty slots and wrap around.
+	int32 previousWrapCount = 0;
+	for (uint32 rejectedMask = 0; rejectedMask < (1u << equippables.Storage.Num()); rejectedMask++)
+	{
+		auto predicate = [&equippables, rejectedMask](ASMEquippableBase* equippable)
+		{
+			for (int32 idx = 0; idx < equippables.Storage.Num(); idx++)
+			{
+				if (equippables.Get(idx) == equippable)
+				{
+					return (rejectedMask & (1u << idx)) == 0;
+				}
+			}
+
+			return false;
+		};
+
+		// Nothing equipped yet, next starts from the first slot.
+		TestEqual(TEXT("Next with nothing equipped"), index.FindInCycleOrder(0, 1, predicate), LinearFindToCycleTo(inventory, 0, 1, predicate));
+		TestEqual(TEXT("Baseline next with nothing equipped"), LinearFindToCycleTo(inventory, 0, 1, predicate), BaselineFindToCycleTo(inventory, 0, 1, predicate));
+
+		for (int32 slotIdx = 0; slotIdx < inventory.Num(); slotIdx++)
+		{
+			// Next/PreviousEquippable only search other slots once there is nothing left in the current slot, so
+			// cycling starts from the last (next) or first (previous) equippable of a slot, or from an empty slot.
+			const TArray<ASMEquippableBase*>& slotInventory = inventory[slotIdx].SlotInventory;
+			const int32 nextStart = slotInventory.Num() > 0 ? index.LocationByEquippable[slotInventory.Last()].CycleIndex + 1 : index.SlotCycleStart[slotIdx];
+			const int32 previousStart = (slotInventory.Num() > 0 ? index.LocationByEquippable[slotInventory[0]].CycleIndex : index.SlotCycleStart[slotIdx]) - 1;
+
+			ASMEquippableBase* const next = LinearFindToCycleTo(inventory, slotIdx + 1, 1, predicate);
+			ASMEquippableBase* const previous = LinearFindToCycleTo(inventory, slotIdx - 1, -1, predicate);
+			TestEqual(FString::Printf(TEXT("Next from slot %i, rejected mask %u"), slotIdx, rejectedMask), index.FindInCycleOrder(nextStart, 1, predicate), next);
+			TestEqual(FString::Printf(TEXT("Previous from slot %i, rejected mask %u"), slotIdx, rejectedMask), index.FindInCycleOrder(previousStart, -1, predicate), previous);
+
+			// Against the baseline, started the way Next/PreviousEquippable started it. Next is unchanged. Previous only
+			// differs where the baseline gave up at the first slot and the wrapped search found something in a later one.
+			const int32 slotCount = inventory.Num();
+			TestEqual(FString::Printf(TEXT("Baseline next from slot %i, rejected mask %u"), slotIdx, rejectedMask),
+				BaselineFindToCycleTo(inventory, (slotIdx + 1) % slotCount, 1, predicate), next);
+
+			ASMEquippableBase* const baselinePrevious = BaselineFindToCycleTo(inventory, FMath::Abs(slotIdx - 1 + slotCount) % slotCount, -1, predicate);
+			if (baselinePrevious != previous)
+			{
+				const int32 previousSlotIdx = inventory.IndexOfByPredicate([previous](const FInventorySlot& slot) { return slot.SlotInventory.Contains(previous); });
+				TestTrue(FString::Printf(TEXT("Previous from slot %i, rejected mask %u only differs from the baseline by wrapping"), slotIdx, rejectedMask),
+					baselinePrevious == nullptr && previousSlotIdx >= slotIdx);
+				previousWrapCount++;
+			}
+		}
+	}
+	TestTrue(TEXT("Some previous searches needed to wrap, which the baseline couldn't do"), previousWrapCount > 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMInventoryReplicatedSlotOrderTest, "SpawnMaster.Inventory.ReplicatedSlotOrder", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMInventoryReplicatedSlotOrderTest::RunTest(const FString& Parameters)
+{
+	using namespace SMEquippableInventoryTests;
+
+	const FFakeEquippables equippables(6);
+
+	// Server side: add everything to one slot, then drop a couple from the middle.
+	FInventoryEntryList serverEntries;
+	TArray<ASMEquippableBase*> serverSlotInventory;
+	for (int32 idx = 0; idx < equippables.Storage.Num(); idx++)
+	{
+		serverEntries.AddEntry(equippables.Get(idx), TAG_TestSlot_Primary);
+		serverSlotInventory.Add(equippables.Get(idx));
+	}
+
+	for (const int32 droppedIdx : { 1, 3 })
+	{
+		serverEntries.RemoveEntry(equippables.Get(droppedIdx));
+		serverSlotInventory.Remove(equippables.Get(droppedIdx));
+	}
+
+	// Client side: apply the remaining entries in reverse, which is as far from the servers order as they can arrive.
+	FInventoryEntryList clientEntries;
+	TArray<ASMEquippableBase*> clientSlotInventory;
+	for (int32 entryIdx = serverEntries.Entries.Num() - 1; entryIdx >= 0; entryIdx--)
+	{
+		const FInventoryEntry& entry = serverEntries.Entries[entryIdx];
+		clientSlotInventory.Insert(entry.Equippable, clientEntries.GetSlotPosition(clientSlotInventory, entry.OrderKey));
+		clientEntries.OrderKeyByEquippable.Add(entry.Equippable, entry.OrderKey);
+	}
+
+	TestEqual(TEXT("Client slot inventory order matches the server"), clientSlotInventory, serverSlotInventory);
+
+	// Entries added after the drops go on the end on both sides.
+	serverEntries.AddEntry(equippables.Get(1), TAG_TestSlot_Primary);
+	serverSlotInventory.Add(equippables.Get(1));
+
+	const FInventoryEntry& newEntry = serverEntries.Entries.Last();
+	clientSlotInventory.Insert(newEntry.Equippable, clientEntries.GetSlotPosition(clientSlotInventory, newEntry.OrderKey));
+	clientEntries.OrderKeyByEquippable.Add(newEntry.Equippable, newEntry.OrderKey);
+
+	TestEqual(TEXT("Client slot inventory order matches the server after re-adding"), clientSlotInventory, serverSlotInventory);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMInventoryEquipSequenceTest, "SpawnMaster.Inventory.EquipSequence", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMInventoryEquipSequenceTest::RunTest(const FString& Parameters)
+{
+	// Newer/older across the point where the counter wraps around.
+	TestTrue(TEXT("1 is newer than 0"), USMEquippableInventoryComponent::IsNewerEquipSequence(1, 0));
+	TestFalse(TEXT("0 is not newer than 1"), USMEquippableInventoryComponent::IsNewerEquipSequence(0, 1));
+	TestFalse(TEXT("A sequence is not newer than itself"), USMEquippableInventoryComponent::IsNewerEquipSequence(7, 7));
+	TestTrue(TEXT("0 is newer than 65535"), USMEquippableInventoryComponent::IsNewerEquipSequence(0, MAX_uint16));
+	TestTrue(TEXT("5 is newer than 65530"), USMEquippableInventoryComponent::IsNewerEquipSequence(5, MAX_uint16 - 5));
+	TestFalse(TEXT("65530 is not newer than 5"), USMEquippableInventoryComponent::IsNewerEquipSequence(MAX_uint16 - 5, 5));
+	TestTrue(TEXT("Half the range ahead is still newer"), USMEquippableInventoryComponent::IsNewerEquipSequence(32767, 0));
+	TestFalse(TEXT("More than half the range ahead counts as older"), USMEquippableInventoryComponent::IsNewerEquipSequence(32768, 0));
+
+	// Corrections, run for sequences in the middle of the range and across the wrap.
+	for (const uint16 firstSequence : { static_cast<uint16>(1), static_cast<uint16>(MAX_uint16 - 1) })
+	{
+		const uint16 requestA = firstSequence;
+		const uint16 requestB = static_cast<uint16>(requestA + 1);
+		const uint16 requestC = static_cast<uint16>(requestB + 1);
+		const FString context = FString::Printf(TEXT("(starting at %u)"), firstSequence);
+
+		// The server rejects the only request we've sent, take the correction.
+		TestTrue(TEXT("Correction for the latest request applies ") + context,
+			USMEquippableInventoryComponent::ShouldApplyEquipCorrection(requestA, requestA, static_cast<uint16>(requestA - 1)));
+
+		// We've sent B since A was rejected, the server will answer B so the correction for A is stale.
+		TestFalse(TEXT("Correction is ignored once a newer request was sent ") + context,
+			USMEquippableInventoryComponent::ShouldApplyEquipCorrection(requestA, requestB, static_cast<uint16>(requestA - 1)));
+
+		// B is rejected and C accepted, but the ack for C arrives before the correction for B.
+		uint16 lastAcked = requestA;
+		if (USMEquippableInventoryComponent::IsNewerEquipSequence(requestC, lastAcked))
+		{
+			lastAcked = requestC;
+		}
+		TestTrue(TEXT("Ack for C is taken ") + context, lastAcked == requestC);
+		TestFalse(TEXT("Correction for B arriving after the ack for C is ignored ") + context,
+			USMEquippableInventoryComponent::ShouldApplyEquipCorrection(requestB, requestC, lastAcked));
+
+		// A late ack for B must not move the ack back either.
+		if (USMEquippableInventoryComponent::IsNewerEquipSequence(requestB, lastAcked))
+		{
+			lastAcked = requestB;
+		}
+		TestTrue(TEXT("Late ack for B is ignored ") + context, lastAcked == requestC);
+
+		// The same correction delivered twice applies both times, it's only setting the same equippable again.
+		TestTrue(TEXT("Repeated correction for the latest request applies ") + context,
+			USMEquippableInventoryComponent::ShouldApplyEquipCorrection(requestC, requestC, requestC));
+	}
+
+	return true;
+}
+
+namespace SMEquippableInventoryTests
+{
+	enum class EEquipMessage : uint8
+	{
+		NotifyUnEquipping,
+		RequestEquip,
+		AckEquip,
+		CorrectEquippable,
+	};
+
+	struct FEquipMessage
+	{
+		EEquipMessage Type;
+		uint16 Sequence;
+		int32 Equippable;
+		double ArriveTime = 0.0;
+	};
+
+	/* One way of a connection with latency and packet loss. Reliable messages are resent a round trip after being lost
+	 * and are delivered in the order they were sent, unreliable ones are dropped and can overtake reliable ones. */
+	struct FLossyChannel
+	{
+		static constexpr double MinLatency = 0.03;
+		static constexpr double MaxLatency = 0.15;
+		static constexpr float PacketLoss = 0.2f;
+
+		explicit FLossyChannel(bool bInReliable) : bReliable(bInReliable) {}
+
+		void Send(FEquipMessage message, double now, FRandomStream& stream)
+		{
+			message.ArriveTime = now + stream.FRandRange(MinLatency, MaxLatency);
+			if (bReliable)
+			{
+				while (stream.FRand() < PacketLoss)
+				{
+					message.ArriveTime += 2.0 * MaxLatency;
+				}
+				message.ArriveTime = FMath::Max(message.ArriveTime, LastReliableArriveTime);
+				LastReliableArriveTime = message.ArriveTime;
+			}
+			else if (stream.FRand() < PacketLoss)
+			{
+				return;
+			}
+
+			InFlight.Add(message);
+		}
+
+		// Takes out everything that has arrived by now, in arrival order.
+		void Receive(double now, TArray<FEquipMessage>& outArrived)
+		{
+			outArrived.Reset();
+			for (int32 messageIdx = 0; messageIdx < InFlight.Num(); messageIdx++)
+			{
+				if (InFlight[messageIdx].ArriveTime <= now)
+				{
+					outArrived.Add(InFlight[messageIdx]);
+					InFlight.RemoveAt(messageIdx--);
+				}
+			}
+			outArrived.StableSort([](const FEquipMessage& a, const FEquipMessage& b) { return a.ArriveTime < b.ArriveTime; });
+		}
+
+		bool bReliable;
+		double LastReliableArriveTime = 0.0;
+		TArray<FEquipMessage> InFlight;
+	};
+
+	// Equippables are numbers here, 0 is empty handed. The client also has one the server has already taken away.
+	static constexpr int32 ServerEquippableCount = 4;
+	static constexpr int32 ClientOnlyEquippable = ServerEquippableCount;
+	static constexpr double UnEquipSeconds = 0.25;
+
+	/* The owning client's side of the equip RPCs: BeginUnEquippingCurrentEquippable, OnUnEquipFinish, ClientAckEquip and
+	 * ClientCorrectEquippable, without the animations and abilities. */
+	struct FEquipClient
+	{
+		void SetDesired(int32 equippable, double now, FLossyChannel& toServer, FRandomStream& stream)
+		{
+			if (equippable == Current)
+			{
+				return;
+			}
+
+			Desired = equippable;
+			if (Current == 0)
+			{
+				Equip(now, toServer, stream);
+			}
+			else if (!bUnEquipping)
+			{
+				bUnEquipping = true;
+				UnEquipFinishTime = now + UnEquipSeconds;
+				LocalSequence++;
+				toServer.Send({ EEquipMessage::NotifyUnEquipping, LocalSequence, 0 }, now, stream);
+			}
+		}
+
+		void Tick(double now, FLossyChannel& toServer, FRandomStream& stream)
+		{
+			if (bUnEquipping && now >= UnEquipFinishTime)
+			{
+				bUnEquipping = false;
+				Equip(now, toServer, stream);
+			}
+		}
+
+		void Equip(double now, FLossyChannel& toServer, FRandomStream& stream)
+		{
+			LocalSequence++;
+			toServer.Send({ EEquipMessage::RequestEquip, LocalSequence, Desired }, now, stream);
+			Current = Desired;
+		}
+
+		void Receive(const FEquipMessage& message)
+		{
+			if (message.Type == EEquipMessage::AckEquip)
+			{
+				if (USMEquippableInventoryComponent::IsNewerEquipSequence(message.Sequence, LastAckedSequence))
+				{
+					LastAckedSequence = message.Sequence;
+				}
+			}
+			else if (USMEquippableInventoryComponent::ShouldApplyEquipCorrection(message.Sequence, LocalSequence, LastAckedSequence))
+			{
+				LastAckedSequence = message.Sequence;
+				bUnEquipping = false;
+				Current = message.Equippable;
+			}
+		}
+
+		int32 Current = 1;
+		int32 Desired = 1;
+		bool bUnEquipping = false;
+		double UnEquipFinishTime = 0.0;
+		uint16 LocalSequence = 0;
+		uint16 LastAckedSequence = 0;
+	};
+
+	// The server's side: ServerNotifyUnEquipping, ServerRequestEquip and server driven changes through SetCurrentEquippable.
+	struct FEquipServer
+	{
+		void Receive(const FEquipMessage& message, double now, FLossyChannel& reliableToClient, FLossyChannel& unreliableToClient, FRandomStream& stream)
+		{
+			if (!USMEquippableInventoryComponent::IsNewerEquipSequence(message.Sequence, LastAcceptedSequence))
+			{
+				return;
+			}
+			LastAcceptedSequence = message.Sequence;
+
+			if (message.Type == EEquipMessage::NotifyUnEquipping)
+			{
+				bUnEquipping = true;
+				return;
+			}
+
+			bUnEquipping = false;
+			if (message.Equippable >= ServerEquippableCount)
+			{
+				reliableToClient.Send({ EEquipMessage::CorrectEquippable, message.Sequence, Current }, now, stream);
+				return;
+			}
+
+			Current = message.Equippable;
+			unreliableToClient.Send({ EEquipMessage::AckEquip, message.Sequence, Current }, now, stream);
+		}
+
+		void ForceEquip(int32 equippable, double now, FLossyChannel& reliableToClient, FRandomStream& stream)
+		{
+			reliableToClient.Send({ EEquipMessage::CorrectEquippable, LastAcceptedSequence, equippable }, now, stream);
+			Current = equippable;
+			bUnEquipping = false;
+		}
+
+		int32 Current = 1;
+		bool bUnEquipping = false;
+		uint16 LastAcceptedSequence = 0;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMInventoryEquipConvergesTest, "SpawnMaster.Inventory.EquipConvergesUnderLatencyAndLoss", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMInventoryEquipConvergesTest::RunTest(const FString& Parameters)
+{
+	using namespace SMEquippableInventoryTests;
+
+	static constexpr double TickSeconds = 1.0 / 60.0;
+	static constexpr double PlaySeconds = 60.0;
+	static constexpr double SettleSeconds = 5.0;
+
+	for (int32 seed = 0; seed < 20; seed++)
+	{
+		// Half the runs start just before the sequence counter wraps.
+		const uint16 firstSequence = static_cast<uint16>(seed % 2 == 0 ? 0 : MAX_uint16 - 100);
+		const FString context = FString::Printf(TEXT("(seed %i)"), seed);
+
+		FRandomStream stream(seed);
+		FLossyChannel toServer(/*bInReliable=*/ true);
+		FLossyChannel reliableToClient(/*bInReliable=*/ true);
+		FLossyChannel unreliableToClient(/*bInReliable=*/ false);
+
+		FEquipClient client;
+		client.LocalSequence = firstSequence;
+		client.LastAckedSequence = firstSequence;
+		FEquipServer server;
+		server.LastAcceptedSequence = firstSequence;
+
+		TArray<FEquipMessage> arrived;
+		int32 swapCount = 0;
+		int32 forcedCount = 0;
+		for (double now = 0.0; now < PlaySeconds + SettleSeconds; now += TickSeconds)
+		{
+			// Scroll spam, putting everything away, asking for something the server no longer has, and the server
+			// changing the equippable itself, all only while playing so everything can settle at the end.
+			if (now < PlaySeconds)
+			{
+				if (stream.FRand() < 0.1f)
+				{
+					client.SetDesired(stream.RandRange(0, ClientOnlyEquippable), now, toServer, stream);
+					swapCount++;
+				}
+				if (stream.FRand() < 0.005f)
+				{
+					server.ForceEquip(stream.RandRange(1, ServerEquippableCount - 1), now, reliableToClient, stream);
+					forcedCount++;
+				}
+			}
+
+			client.Tick(now, toServer, stream);
+
+			toServer.Receive(now, arrived);
+			for (const FEquipMessage& message : arrived)
+			{
+				server.Receive(message, now, reliableToClient, unreliableToClient, stream);
+			}
+
+			reliableToClient.Receive(now, arrived);
+			for (const FEquipMessage& message : arrived)
+			{
+				client.Receive(message);
+			}
+
+			unreliableToClient.Receive(now, arrived);
+			for (const FEquipMessage& message : arrived)
+			{
+				client.Receive(message);
+			}
+		}
+
+		TestTrue(TEXT("Every message was delivered ") + context, toServer.InFlight.IsEmpty() && reliableToClient.InFlight.IsEmpty() && unreliableToClient.InFlight.IsEmpty());
+		TestEqual(TEXT("Client and server agree on the equippable ") + context, client.Current, server.Current);
+		TestFalse(TEXT("Client isn't left unequipping ") + context, client.bUnEquipping);
+		TestFalse(TEXT("Server isn't left unequipping ") + context, server.bUnEquipping);
+		TestTrue(TEXT("Server never holds an equippable it doesn't have ") + context, server.Current < ServerEquippableCount);
+		TestTrue(FString::Printf(TEXT("Both sides changed equippables (%i swaps, %i forced) "), swapCount, forcedCount) + context, swapCount > 0 && forcedCount > 0);
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
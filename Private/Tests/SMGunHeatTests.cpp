@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Items/SMGunBase.h"
+
+#include "Curves/RichCurve.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SMGunHeatTests
+{
+	struct FCurveKey
+	{
+		float Time;
+		float Value;
+	};
+
+	FRichCurve MakeLinearCurve(std::initializer_list<FCurveKey> keys)
+	{
+		FRichCurve curve;
+		for (const FCurveKey& key : keys)
+		{
+			curve.SetKeyInterpMode(curve.AddKey(key.Time, key.Value), RCIM_Linear);
+		}
+		return curve;
+	}
+
+	// A gun whose heat cooldown slows down as it heats up, so most of the cooldown can't be solved in one go.
+	struct FTestGunCurves
+	{
+		FTestGunCurves()
+		{
+			HeatToSpread = MakeLinearCurve({ { 0.0f, 1.0f }, { 10.0f, 8.0f } });
+			HeatToCooldownPerSecond = MakeLinearCurve({ { 0.0f, 10.0f }, { 5.0f, 4.0f }, { 10.0f, 2.0f } });
+			HeatToHeatPerShot = MakeLinearCurve({ { 0.0f, 1.0f }, { 10.0f, 1.5f } });
+			RecoilHeatToCooldownPerSecond = MakeLinearCurve({ { 0.0f, 3.0f }, { 5.0f, 1.0f } });
+			RecoilHeatToHeatPerShot = MakeLinearCurve({ { 0.0f, 0.5f }, { 5.0f, 0.25f } });
+
+			Baked.HeatToSpread.Bake(HeatToSpread);
+			Baked.HeatToCooldownPerSecond.Bake(HeatToCooldownPerSecond);
+			Baked.HeatToHeatPerShot.Bake(HeatToHeatPerShot);
+			Baked.RecoilHeatToCooldownPerSecond.Bake(RecoilHeatToCooldownPerSecond);
+			Baked.RecoilHeatToHeatPerShot.Bake(RecoilHeatToHeatPerShot);
+		}
+
+		FRichCurve HeatToSpread;
+		FRichCurve HeatToCooldownPerSecond;
+		FRichCurve HeatToHeatPerShot;
+		FRichCurve RecoilHeatToCooldownPerSecond;
+		FRichCurve RecoilHeatToHeatPerShot;
+
+		FSMGunBakedCurves Baked;
+
+		float MinHeat = 0.0f;
+		float MaxHeat = 10.0f;
+		float MaxRecoilHeat = 1000.0f;
+	};
+
+	// Spread and recoil heat a shot was fired with.
+	struct FShot
+	{
+		float SpreadAngle = 0.0f;
+		float RecoilHeat = 0.0f;
+	};
+
+	// A burst, a few spaced out shots, a double tap after a long pause and a single shot after a longer one.
+	TArray<float> MakeShotTimes()
+	{
+		TArray<float> shotTimes;
+		for (int32 shotIdx = 0; shotIdx < 10; shotIdx++)
+		{
+			shotTimes.Add(0.5f + 0.1f * shotIdx);
+		}
+		for (int32 shotIdx = 0; shotIdx < 5; shotIdx++)
+		{
+			shotTimes.Add(3.5f + 0.25f * shotIdx);
+		}
+		shotTimes.Append({ 8.0f, 8.05f, 12.0f });
+		return shotTimes;
+	}
+
+	/* Runs the shots through both heat models, frame by frame with frame times from getDeltaSeconds. The per-frame
+	 * model is what ASMGunBase::Tick used to do: cool down every frame from the rich curves. The lazy one only cools
+	 * down (with the baked curves) when a shot reads the spread. */
+	void FireShots(const FTestGunCurves& curves, TFunctionRef<float()> getDeltaSeconds, TArray<FShot>& outPerFrame, TArray<FShot>& outLazy)
+	{
+		const TArray<float> shotTimes = MakeShotTimes();
+
+		float perFrameHeat = 0.0f;
+		float perFrameRecoilHeat = 0.0f;
+		float lazyHeat = 0.0f;
+		float lazyRecoilHeat = 0.0f;
+		float lazyUpdateTime = 0.0f;
+
+		float timeSeconds = 0.0f;
+		int32 nextShotIdx = 0;
+		while (nextShotIdx < shotTimes.Num())
+		{
+			const float deltaSeconds = getDeltaSeconds();
+			timeSeconds += deltaSeconds;
+
+			perFrameHeat = FMath::Clamp(perFrameHeat - curves.HeatToCooldownPerSecond.Eval(perFrameHeat) * deltaSeconds, curves.MinHeat, curves.MaxHeat);
+			perFrameRecoilHeat = perFrameRecoilHeat - curves.RecoilHeatToCooldownPerSecond.Eval(perFrameRecoilHeat) * deltaSeconds;
+
+			if (timeSeconds < shotTimes[nextShotIdx])
+			{
+				continue;
+			}
+			nextShotIdx++;
+
+			ASMGunBase::CoolDownHeat(curves.Baked, curves.MinHeat, curves.MaxHeat, timeSeconds - lazyUpdateTime, /*out*/ lazyHeat, /*out*/ lazyRecoilHeat);
+			lazyUpdateTime = timeSeconds;
+
+			outPerFrame.Add({ curves.HeatToSpread.Eval(perFrameHeat), perFrameRecoilHeat });
+			outLazy.Add({ curves.Baked.HeatToSpread.Eval(lazyHeat), lazyRecoilHeat });
+
+			// Same as AddSpread
+			perFrameHeat = FMath::Clamp(perFrameHeat + curves.HeatToHeatPerShot.Eval(perFrameHeat), curves.MinHeat, curves.MaxHeat);
+			perFrameRecoilHeat = FMath::Clamp(perFrameRecoilHeat + curves.RecoilHeatToHeatPerShot.Eval(perFrameRecoilHeat), 0.0f, curves.MaxRecoilHeat);
+			lazyHeat = FMath::Clamp(lazyHeat + curves.Baked.HeatToHeatPerShot.Eval(lazyHeat), curves.MinHeat, curves.MaxHeat);
+			lazyRecoilHeat = FMath::Clamp(lazyRecoilHeat + curves.Baked.RecoilHeatToHeatPerShot.Eval(lazyRecoilHeat), 0.0f, curves.MaxRecoilHeat);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMGunHeatLazyMatchesPerFrameTest, "SpawnMaster.Gun.LazyHeatMatchesPerFrame", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMGunHeatLazyMatchesPerFrameTest::RunTest(const FString& Parameters)
+{
+	using namespace SMGunHeatTests;
+
+	const FTestGunCurves curves;
+
+	struct FFrameRateCase
+	{
+		const TCHAR* Name;
+		TFunction<float()> GetDeltaSeconds;
+
+		// At 60fps the lazy steps are the frames, so only the curve baking differs. Other frame rates also differ by
+		// the Euler step size.
+		float SpreadTolerance;
+		float RecoilHeatTolerance;
+	};
+
+	FRandomStream frameTimeStream(1);
+	const FFrameRateCase frameRateCases[] =
+	{
+		{ TEXT("60fps"), []() { return 1.0f / 60.0f; }, 0.01f, 0.01f },
+		{ TEXT("144fps"), []() { return 1.0f / 144.0f; }, 0.15f, 0.05f },
+		{ TEXT("30-90fps"), [&frameTimeStream]() { return frameTimeStream.FRandRange(1.0f / 90.0f, 1.0f / 30.0f); }, 0.15f, 0.05f },
+	};
+
+	for (const FFrameRateCase& frameRateCase : frameRateCases)
+	{
+		TArray<FShot> perFrameShots;
+		TArray<FShot> lazyShots;
+		FireShots(curves, frameRateCase.GetDeltaSeconds, perFrameShots, lazyShots);
+
+		for (int32 shotIdx = 0; shotIdx < perFrameShots.Num(); shotIdx++)
+		{
+			TestEqual(FString::Printf(TEXT("%s shot %i spread angle"), frameRateCase.Name, shotIdx), lazyShots[shotIdx].SpreadAngle, perFrameShots[shotIdx].SpreadAngle, frameRateCase.SpreadTolerance);
+			TestEqual(FString::Printf(TEXT("%s shot %i recoil heat"), frameRateCase.Name, shotIdx), lazyShots[shotIdx].RecoilHeat, perFrameShots[shotIdx].RecoilHeat, frameRateCase.RecoilHeatTolerance);
+		}
+	}
+
+	// A gun left alone for an hour cools down in one go once its rates stop changing, and ends up where it should.
+	float heat = curves.MaxHeat;
+	float recoilHeat = 5.0f;
+	ASMGunBase::CoolDownHeat(curves.Baked, curves.MinHeat, curves.MaxHeat, 3600.0f, /*out*/ heat, /*out*/ recoilHeat);
+	TestEqual(TEXT("Heat is back at its minimum after an hour"), heat, curves.MinHeat);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GAS/SMPelletDirections.h"
+
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SMPelletDirectionsTests
+{
+	// The per pellet cone the abilities used before FSMPelletDirections, drawing from a stream in the same order.
+	FVector VRandConeNormalDistribution(const FVector& dir, float coneHalfAngleRad, float exponent, FRandomStream& stream)
+	{
+		const float coneHalfAngleDegrees = FMath::RadiansToDegrees(coneHalfAngleRad);
+
+		const float fromCenter = FMath::Pow(stream.FRand(), exponent);
+		const float angleFromCenter = fromCenter * coneHalfAngleDegrees;
+		const float angleAround = stream.FRand() * 360.0f;
+
+		const FQuat dirQuat(dir.Rotation());
+		const FQuat fromCenterQuat(FRotator(0.0f, angleFromCenter, 0.0f));
+		const FQuat aroundQuat(FRotator(0.0f, 0.0f, angleAround));
+		FQuat finalDirectionQuat = dirQuat * aroundQuat * fromCenterQuat;
+		finalDirectionQuat.Normalize();
+
+		return finalDirectionQuat.RotateVector(FVector::ForwardVector);
+	}
+
+	double AngleBetween(const FVector& a, const FVector& b)
+	{
+		return FMath::Acos(FMath::Clamp(FVector::DotProduct(a.GetSafeNormal(), b.GetSafeNormal()), -1.0, 1.0));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMPelletDirectionsDistributionTest, "SpawnMaster.PelletDirections.Distribution", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMPelletDirectionsDistributionTest::RunTest(const FString& Parameters)
+{
+	using namespace SMPelletDirectionsTests;
+
+	const FVector aimDir = FVector(0.6f, -0.3f, 0.4f).GetSafeNormal();
+	const FMatrix aimBasis = FRotationMatrix(aimDir.Rotation());
+	const FVector right = aimBasis.GetScaledAxis(EAxis::Y);
+	const FVector up = aimBasis.GetScaledAxis(EAxis::Z);
+	const float coneHalfAngle = FMath::DegreesToRadians(15.0f);
+
+	// Odd so the last block of 4 is padded.
+	static constexpr int32 NumPellets = 10001;
+
+	for (const float exponent : { 1.0f, 2.0f, 0.5f })
+	{
+		const FString context = FString::Printf(TEXT("(exponent %.1f)"), exponent);
+
+		FRandomStream stream(1234);
+		FSMPelletDirections directions;
+		directions.Generate(aimDir, coneHalfAngle, exponent, stream, NumPellets);
+		TestEqual(TEXT("Direction count ") + context, directions.Num(), NumPellets);
+
+		FRandomStream referenceStream(1234);
+		double maxAngleError = 0.0;
+		double fromCenterSum = 0.0;
+		double aroundCosSum = 0.0;
+		double aroundSinSum = 0.0;
+		bool bAllUnitLength = true;
+		bool bAllInCone = true;
+		for (int32 pelletIdx = 0; pelletIdx < NumPellets; pelletIdx++)
+		{
+			const FVector direction = directions[pelletIdx];
+			const FVector referenceDirection = VRandConeNormalDistribution(aimDir, coneHalfAngle, exponent, referenceStream);
+
+			bAllUnitLength &= FMath::IsNearlyEqual(direction.Size(), 1.0, 1.0e-4);
+
+			// Same random numbers, so each pellet is as far from the aim as the old cone put it. The way around the aim
+			// is measured from a different axis, so only the angle from the aim is compared pellet by pellet.
+			const double angleFromAim = AngleBetween(direction, aimDir);
+			maxAngleError = FMath::Max(maxAngleError, FMath::Abs(angleFromAim - AngleBetween(referenceDirection, aimDir)));
+			bAllInCone &= angleFromAim <= coneHalfAngle + 1.0e-3;
+
+			fromCenterSum += angleFromAim / coneHalfAngle;
+			const double angleAround = FMath::Atan2(FVector::DotProduct(direction, up), FVector::DotProduct(direction, right));
+			aroundCosSum += FMath::Cos(angleAround);
+			aroundSinSum += FMath::Sin(angleAround);
+		}
+
+		TestTrue(TEXT("Every direction is unit length ") + context, bAllUnitLength);
+		TestTrue(TEXT("Every direction is inside the cone ") + context, bAllInCone);
+		TestTrue(FString::Printf(TEXT("Angle from the aim matches the old cone pellet by pellet, max error %f rad "), maxAngleError) + context, maxAngleError <= 1.0e-3);
+
+		// fromCenter is uniform^exponent, so its mean is 1 / (exponent + 1). The way around is uniform, so it averages out.
+		TestEqual(TEXT("Mean distance from the center ") + context, fromCenterSum / NumPellets, 1.0 / (exponent + 1.0), 0.01);
+		TestEqual(TEXT("Mean cos around ") + context, aroundCosSum / NumPellets, 0.0, 0.03);
+		TestEqual(TEXT("Mean sin around ") + context, aroundSinSum / NumPellets, 0.0, 0.03);
+	}
+
+	// The same stream state gives the same pattern, which is what client and server rely on.
+	{
+		FRandomStream streamA(42);
+		FRandomStream streamB(42);
+		FRandomStream streamC(43);
+		FSMPelletDirections directionsA;
+		FSMPelletDirections directionsB;
+		FSMPelletDirections directionsC;
+		directionsA.Generate(aimDir, coneHalfAngle, 1.0f, streamA, 12);
+		directionsB.Generate(aimDir, coneHalfAngle, 1.0f, streamB, 12);
+		directionsC.Generate(aimDir, coneHalfAngle, 1.0f, streamC, 12);
+
+		bool bSameForSameSeed = true;
+		bool bDifferentForDifferentSeed = false;
+		for (int32 pelletIdx = 0; pelletIdx < 12; pelletIdx++)
+		{
+			bSameForSameSeed &= directionsA[pelletIdx] == directionsB[pelletIdx];
+			bDifferentForDifferentSeed |= directionsA[pelletIdx] != directionsC[pelletIdx];
+		}
+		TestTrue(TEXT("Same seed gives the same directions"), bSameForSameSeed);
+		TestTrue(TEXT("Different seed gives different directions"), bDifferentForDifferentSeed);
+		TestEqual(TEXT("Both streams are left in the same state"), streamA.GetCurrentSeed(), streamB.GetCurrentSeed());
+	}
+
+	// No spread is every pellet straight down the aim.
+	{
+		FRandomStream stream(7);
+		FSMPelletDirections directions;
+		directions.Generate(aimDir, 0.0f, 1.0f, stream, 5);
+		for (int32 pelletIdx = 0; pelletIdx < directions.Num(); pelletIdx++)
+		{
+			TestTrue(FString::Printf(TEXT("Pellet %i without spread is the aim"), pelletIdx), directions[pelletIdx].Equals(aimDir, 1.0e-5));
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMPelletDirectionsBenchmarkTest, "SpawnMaster.PelletDirections.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMPelletDirectionsBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace SMPelletDirectionsTests;
+
+	static constexpr int32 CartridgeCount = 100000;
+	static constexpr int32 PelletsPerCartridge = 12;
+	const FVector aimDir = FVector(0.6f, -0.3f, 0.4f).GetSafeNormal();
+	const float coneHalfAngle = FMath::DegreesToRadians(5.0f);
+
+	// Sums are reported so the work can't be optimized away.
+	FVector scalarSum = FVector::ZeroVector;
+	const double scalarStart = FPlatformTime::Seconds();
+	for (int32 cartridgeIdx = 0; cartridgeIdx < CartridgeCount; cartridgeIdx++)
+	{
+		FRandomStream stream(cartridgeIdx);
+		for (int32 pelletIdx = 0; pelletIdx < PelletsPerCartridge; pelletIdx++)
+		{
+			scalarSum += VRandConeNormalDistribution(aimDir, coneHalfAngle, 1.0f, stream);
+		}
+	}
+	const double scalarSeconds = FPlatformTime::Seconds() - scalarStart;
+
+	FVector batchSum = FVector::ZeroVector;
+	FSMPelletDirections directions;
+	const double batchStart = FPlatformTime::Seconds();
+	for (int32 cartridgeIdx = 0; cartridgeIdx < CartridgeCount; cartridgeIdx++)
+	{
+		FRandomStream stream(cartridgeIdx);
+		directions.Generate(aimDir, coneHalfAngle, 1.0f, stream, PelletsPerCartridge);
+		for (int32 pelletIdx = 0; pelletIdx < PelletsPerCartridge; pelletIdx++)
+		{
+			batchSum += directions[pelletIdx];
+		}
+	}
+	const double batchSeconds = FPlatformTime::Seconds() - batchStart;
+
+	AddInfo(FString::Printf(TEXT("%i cartridges of %i pellets: VRandConeNormalDistribution %.1fns per cartridge (sum %s), FSMPelletDirections %.1fns per cartridge (sum %s), %.1fx"),
+		CartridgeCount, PelletsPerCartridge, scalarSeconds * 1.0e9 / CartridgeCount, *scalarSum.ToString(), batchSeconds * 1.0e9 / CartridgeCount, *batchSum.ToString(),
+		batchSeconds > 0.0 ? scalarSeconds / batchSeconds : 0.0));
+
+	// Both average out to the aim direction.
+	TestTrue(TEXT("Both generators average out to the same direction"), scalarSum.GetSafeNormal().Equals(batchSum.GetSafeNormal(), 1.0e-3));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Async/ParallelFor.h"
+#include "GAS/SMCartridgeTargetData.h"
+#include "GAS/SMPelletDirections.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "SpawnMasterSM/SpawnMaster.h"
+#include "Tests/SMTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SMPelletTraceTests
+{
+	// A 12 pellet shotgun firing at 600 rounds per minute for 10 seconds.
+	static constexpr int32 PelletsPerCartridge = 12;
+	static constexpr int32 CartridgeCount = 100;
+	static constexpr float SpreadAngle = 10.0f;
+	static constexpr float MaxRange = 10000.0f;
+
+	/* Traces every pellet of every cartridge the way TraceBulletsInCartridge does, either one after the other or with a
+	 * parallel for over the pellets. Returns the total number of hits, so both ways can be checked against each other. */
+	int32 TraceCartridges(UWorld* world, bool bInParallel, double& outSeconds)
+	{
+		const FCollisionQueryParams traceParams(SCENE_QUERY_STAT(WeaponTrace), /*bTraceComplex=*/ true);
+		const FVector start = FVector::ZeroVector;
+		const FVector aimDir = FVector::ForwardVector;
+
+		TArray<TArray<FHitResult>> pelletHits;
+		pelletHits.SetNum(PelletsPerCartridge);
+		FSMPelletDirections directions;
+
+		int32 hitCount = 0;
+		const double startTime = FPlatformTime::Seconds();
+		for (int32 cartridgeIdx = 0; cartridgeIdx < CartridgeCount; cartridgeIdx++)
+		{
+			FRandomStream spreadStream(cartridgeIdx);
+			directions.Generate(aimDir, FMath::DegreesToRadians(SpreadAngle * 0.5f), 1.0f, spreadStream, PelletsPerCartridge);
+
+			ParallelFor(PelletsPerCartridge, [&](int32 pelletIdx)
+			{
+				pelletHits[pelletIdx].Reset();
+				world->LineTraceMultiByChannel(pelletHits[pelletIdx], start, start + directions[pelletIdx] * MaxRange, TRACECHANNEL_BULLET, traceParams);
+			}, bInParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+			for (const TArray<FHitResult>& hits : pelletHits)
+			{
+				hitCount += hits.Num();
+			}
+		}
+		outSeconds = FPlatformTime::Seconds() - startTime;
+
+		return hitCount;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMPelletTraceBenchmarkTest, "SpawnMaster.Weapon.PelletTraceBenchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMPelletTraceBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace SMPelletTraceTests;
+
+	const FSMScopedTestWorld testWorld;
+	if (!testWorld.SpawnShootingRange())
+	{
+		AddError(TEXT("Couldn't spawn the engine cube mesh"));
+		return false;
+	}
+
+	// Warm up, so neither run pays for first time setup.
+	double warmUpSeconds = 0.0;
+	TraceCartridges(testWorld.World, /*bInParallel=*/ true, warmUpSeconds);
+
+	double serialSeconds = 0.0;
+	const int32 serialHits = TraceCartridges(testWorld.World, /*bInParallel=*/ false, serialSeconds);
+
+	double parallelSeconds = 0.0;
+	const int32 parallelHits = TraceCartridges(testWorld.World, /*bInParallel=*/ true, parallelSeconds);
+
+	TestTrue(TEXT("Pellets hit something"), serialHits > 0);
+	TestEqual(TEXT("Parallel traces hit the same as serial ones"), parallelHits, serialHits);
+
+	AddInfo(FString::Printf(TEXT("%i cartridges of %i pellets (%i hits): serial %.3fms per cartridge, parallel %.3fms per cartridge, %.1fx"),
+		CartridgeCount, PelletsPerCartridge, serialHits, serialSeconds * 1000.0 / CartridgeCount, parallelSeconds * 1000.0 / CartridgeCount,
+		parallelSeconds > 0.0 ? serialSeconds / parallelSeconds : 0.0));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSMSteadyFireReusesBuffersTest, "SpawnMaster.Weapon.SteadyFireReusesBuffers", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FSMSteadyFireReusesBuffersTest::RunTest(const FString& Parameters)
+{
+	using namespace SMPelletTraceTests;
+
+	const FSMScopedTestWorld testWorld;
+	if (!testWorld.SpawnShootingRange())
+	{
+		AddError(TEXT("Couldn't spawn the engine cube mesh"));
+		return false;
+	}
+
+	const FCollisionQueryParams traceParams(SCENE_QUERY_STAT(WeaponTrace), /*bTraceComplex=*/ true);
+	const FVector start = FVector::ZeroVector;
+	const FVector aimDir = FVector::ForwardVector;
+
+	// What the ability keeps between shots: the pellet directions and a hit buffer per pellet.
+	FSMPelletDirections directions;
+	TArray<TArray<FHitResult>> pelletHits;
+	pelletHits.SetNum(PelletsPerCartridge);
+
+	// Automatic fire cycles through the same spread seeds, so after one pass every buffer is as big as it gets.
+	static constexpr int32 SeedCount = 20;
+	static constexpr int32 SteadyShotCount = 1000;
+	bool bCartridgeStayedInline = true;
+
+	auto fireShot = [&](int32 shotIdx)
+	{
+		FRandomStream spreadStream(shotIdx % SeedCount);
+		directions.Generate(aimDir, FMath::DegreesToRadians(SpreadAngle * 0.5f), 1.0f, spreadStream, PelletsPerCartridge);
+
+		FSMCartridgeTargetData cartridge;
+		cartridge.Origin = start;
+		for (int32 pelletIdx = 0; pelletIdx < PelletsPerCartridge; pelletIdx++)
+		{
+			TArray<FHitResult>& hits = pelletHits[pelletIdx];
+			hits.Reset();
+			testWorld.World->LineTraceMultiByChannel(hits, start, start + directions[pelletIdx] * MaxRange, TRACECHANNEL_BULLET, traceParams);
+
+			const int32 stopIdx = FSMCartridgeTargetData::FindPelletStop(hits, [](const FHitResult&) { return false; });
+			if (hits.IsValidIndex(stopIdx))
+			{
+				cartridge.AddHit(hits[stopIdx], pelletIdx);
+			}
+		}
+		cartridge.RemoveDuplicatePellets(PelletsPerCartridge, [](const FSMPelletHit&) { return false; });
+
+		// A full cartridge fits the pellet array's inline storage, so building target data never touches the heap.
+		const uint8* cartridgeStart = reinterpret_cast<const uint8*>(&cartridge);
+		const uint8* pelletData = reinterpret_cast<const uint8*>(cartridge.Pellets.GetData());
+		bCartridgeStayedInline &= pelletData >= cartridgeStart && pelletData < cartridgeStart + sizeof(cartridge);
+	};
+
+	for (int32 shotIdx = 0; shotIdx < SeedCount; shotIdx++)
+	{
+		fireShot(shotIdx);
+	}
+
+	TArray<const FHitResult*> warmBufferData;
+	TArray<int32> warmBufferMax;
+	for (const TArray<FHitResult>& hits : pelletHits)
+	{
+		warmBufferData.Add(hits.GetData());
+		warmBufferMax.Add(hits.Max());
+	}
+
+	const double steadyStart = FPlatformTime::Seconds();
+	for (int32 shotIdx = 0; shotIdx < SteadyShotCount; shotIdx++)
+	{
+		fireShot(shotIdx);
+	}
+	const double steadySeconds = FPlatformTime::Seconds() - steadyStart;
+
+	/* Counting every allocation would take replacing the global allocator, which tests can't do safely while the
+	 * engine runs. Instead every buffer the firing path keeps between shots has to still be the same allocation. */
+	for (int32 pelletIdx = 0; pelletIdx < PelletsPerCartridge; pelletIdx++)
+	{
+		TestTrue(FString::Printf(TEXT("Pellet %i hit buffer was reused"), pelletIdx), pelletHits[pelletIdx].GetData() == warmBufferData[pelletIdx] && pelletHits[pelletIdx].Max() == warmBufferMax[pelletIdx]);
+	}
+	TestTrue(TEXT("Cartridge pellets stayed in inline storage"), bCartridgeStayedInline);
+
+	AddInfo(FString::Printf(TEXT("%i steady shots of %i pellets: %.3fms per shot"), SteadyShotCount, PelletsPerCartridge, steadySeconds * 1000.0 / SteadyShotCount));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
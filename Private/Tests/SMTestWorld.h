@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// A game world for tests that need actors or a physics scene. Torn down when it goes out of scope.
+struct FSMScopedTestWorld
+{
+	FSMScopedTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, /*bInformEngineOfWorld=*/ false);
+
+		FWorldContext& worldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		worldContext.SetCurrentWorld(World);
+
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	~FSMScopedTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(/*bInformEngineOfWorld=*/ false);
+	}
+
+	// Spawns an engine cube (100uu across before scale) that blocks every channel. Null if the engine content is missing.
+	AStaticMeshActor* SpawnBlockingCube(const FVector& location, const FVector& scale) const
+	{
+		UStaticMesh* cubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+		if (!cubeMesh)
+		{
+			return nullptr;
+		}
+
+		AStaticMeshActor* cube = World->SpawnActor<AStaticMeshActor>(location, FRotator::ZeroRotator);
+		UStaticMeshComponent* meshComponent = cube->GetStaticMeshComponent();
+		meshComponent->SetMobility(EComponentMobility::Movable);
+		meshComponent->SetStaticMesh(cubeMesh);
+		meshComponent->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+		cube->SetActorScale3D(scale);
+		return cube;
+	}
+
+	/* Targets for weapon traces fired down +X from the origin: a crowd of small cubes 20-26m out in front of a wall at
+	 * 40m, so pellets hit one or two things each. Ticks once so they can be traced against. */
+	bool SpawnShootingRange() const
+	{
+		for (int32 row = 0; row < 4; row++)
+		{
+			for (int32 column = 0; column < 4; column++)
+			{
+				if (!SpawnBlockingCube(FVector(2000.0f + row * 200.0f, (column - 1.5f) * 150.0f, (row - 1.5f) * 150.0f), FVector(0.5f)))
+				{
+					return false;
+				}
+			}
+		}
+
+		if (!SpawnBlockingCube(FVector(4000.0f, 0.0f, 0.0f), FVector(1.0f, 40.0f, 40.0f)))
+		{
+			return false;
+		}
+
+		Tick();
+		return true;
+	}
+
+	// Runs a frame, so the physics scene picks up everything spawned since the last one.
+	void Tick(float deltaSeconds = 1.0f / 60.0f) const
+	{
+		World->Tick(LEVELTICK_All, deltaSeconds);
+	}
+
+	UWorld* World = nullptr;
+};
+
+#endif // WITH_DEV_AUTOMATION_TESTS
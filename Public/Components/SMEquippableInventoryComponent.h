@@ -6,10 +6,13 @@
 #include "GameplayTagContainer.h"
 #include "Components/ActorComponent.h"
 #include "Items/SMEquippableBase.h"
+#include "Net/Serialization/FastArraySerializer.h"
 #include "SMEquippableInventoryComponent.generated.h"
 
 struct FGameplayTag;
+struct FInventoryEntryList;
 class ASMEquippableBase;
+class USMEquippableInventoryComponent;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnCurrentEquippableChanged, ASMEquippableBase*, OldEquippable);
 
@@ -105,6 +108,139 @@ public:
 	}
 };
 
+// Where an equippable lives inside of the EquippableInventory array.
+struct FInventoryEquippableLocation
+{
+	// Index of the FInventorySlot in EquippableInventory.
+	int32 SlotIndex = INDEX_NONE;
+
+	// Index of the equippable in that slots SlotInventory.
+	int32 Position = INDEX_NONE;
+
+	// Index of the equippable in FInventoryIndex::CycleOrder.
+	int32 CycleIndex = INDEX_NONE;
+};
+
+/* Lookup tables that mirror the EquippableInventory array. FInventorySlot is still the format that is authored, this only exists so equip, drop, pickup and next/previous equippable don't have to search through every
+ * slot each time. Must be rebuilt whenever a slot inventory changes. */
+struct FInventoryIndex
+{
+	// Slot tag -> index of the slot in EquippableInventory.
+	TMap<FGameplayTag, int32> SlotIndexByTag;
+
+	// Equippable -> where it is in EquippableInventory.
+	TMap<const ASMEquippableBase*, FInventoryEquippableLocation> LocationByEquippable;
+
+	// Every equippable in the inventory, ordered by slot and then by position in the slot. This is the order
+	// next/previous equippable cycles through.
+	TArray<ASMEquippableBase*> CycleOrder;
+
+	// Index into CycleOrder where each slot starts (one entry per slot in EquippableInventory).
+	TArray<int32> SlotCycleStart;
+
+	void Rebuild(const TArray<FInventorySlot>& Inventory);
+
+	// Searches CycleOrder from StartCycleIdx (wrapping around, so one past either end is fine) for the first equippable
+	// that passes Predicate. Direction is 1 for next, -1 for previous.
+	template<typename PredicateType>
+	ASMEquippableBase* FindInCycleOrder(int32 StartCycleIdx, int32 Direction, PredicateType Predicate) const
+	{
+		const int32 cycleCount = CycleOrder.Num();
+		if (cycleCount == 0)
+		{
+			return nullptr;
+		}
+
+		int32 cycleIdx = ((StartCycleIdx % cycleCount) + cycleCount) % cycleCount;
+		for (int32 searched = 0; searched < cycleCount; searched++)
+		{
+			if (Predicate(CycleOrder[cycleIdx]))
+			{
+				return CycleOrder[cycleIdx];
+			}
+
+			cycleIdx = (cycleIdx + Direction + cycleCount) % cycleCount;
+		}
+
+		return nullptr;
+	}
+};
+
+/* A single equippable held in the inventory. This is what actually gets replicated to the owning client, the client
+ * then rebuilds its own EquippableInventory from these entries. Only added/removed entries are sent. */
+USTRUCT()
+struct FInventoryEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	FInventoryEntry() {}
+	FInventoryEntry(ASMEquippableBase* InEquippable, FGameplayTag InSlotTag) : Equippable(InEquippable), SlotTag(InSlotTag)
+	{}
+
+	UPROPERTY()
+	ASMEquippableBase* Equippable = nullptr;
+
+	// Sent along with the equippable so the client can place it before the equippable's own properties arrive.
+	UPROPERTY()
+	FGameplayTag SlotTag;
+
+	// Server assigned, goes up in the order equippables were added to the inventory. Fast array order is not kept the same
+	// on clients (they remove with RemoveAtSwap), so the client orders each slot inventory by this instead.
+	UPROPERTY()
+	uint32 OrderKey = 0;
+
+	// Client only. The equippable this entry was last applied to EquippableInventory with. Equippable can arrive as nullptr
+	// when its NetGUID hasn't resolved yet, so we need to know what we actually added.
+	UPROPERTY(NotReplicated)
+	ASMEquippableBase* AppliedEquippable = nullptr;
+
+	void PreReplicatedRemove(const FInventoryEntryList& InArraySerializer);
+	void PostReplicatedAdd(const FInventoryEntryList& InArraySerializer);
+	void PostReplicatedChange(const FInventoryEntryList& InArraySerializer);
+};
+
+// Replicated list of every equippable in the inventory.
+USTRUCT()
+struct FInventoryEntryList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FInventoryEntry> Entries;
+
+	UPROPERTY(NotReplicated)
+	USMEquippableInventoryComponent* OwnerComponent = nullptr;
+
+	// Server only. OrderKey given to the next added entry.
+	uint32 NextOrderKey = 0;
+
+	// Client only. OrderKey of every equippable currently applied to EquippableInventory.
+	TMap<const ASMEquippableBase*, uint32> OrderKeyByEquippable;
+
+	// Server only. Adds an entry and marks it dirty.
+	void AddEntry(ASMEquippableBase* equippable, FGameplayTag slotTag);
+
+	// Server only. Removes the entry for the equippable, returns false if there wasn't one.
+	bool RemoveEntry(const ASMEquippableBase* equippable);
+
+	// Client only. Where an entry with orderKey should be inserted in slotInventory so slot order matches the server.
+	int32 GetSlotPosition(const TArray<ASMEquippableBase*>& slotInventory, uint32 orderKey) const;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryEntry, FInventoryEntryList>(Entries, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryEntryList> : public TStructOpsTypeTraitsBase2<FInventoryEntryList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
 /**
  * Design Goals for this component:
  * 
@@ -123,6 +259,8 @@ class USMEquippableInventoryComponent : public UActorComponent
 {
 	GENERATED_BODY()
 
+	friend struct FInventoryEntry;
+
 public:
 	
 	// Sets default values for this component's properties
@@ -130,6 +268,8 @@ public:
 
 	// ~UActorComponent interface begin
 	virtual void OnRegister() override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	// ~UActorComponent interface end
 	
@@ -162,7 +302,7 @@ public:
 
 	// Gets currently held equippable.
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = Inventory)
-	ASMEquippableBase* GetCurrentEquippable() { return CurrentEquippable; };
+	ASMEquippableBase* GetCurrentEquippable() const { return CurrentEquippable; };
 
 	// Returns if the owning pawn currently has a CurrentEquipapble.
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = Inventory)
@@ -176,6 +316,10 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = Inventory)
 	bool GiveExistingEquippable(ASMEquippableBase* equippableToGive);
 
+	// Gives a new equippable of the given class to the receiver, reusing one from the equippable pool if possible. Returns nullptr if the receiver couldn't take it.
+	UFUNCTION(BlueprintCallable, Category = Inventory, meta=(DeterminesOutputType="EquippableClass"))
+	static ASMEquippableBase* GiveNewEquippable(TSubclassOf<ASMEquippableBase> EquippableClass, AActor* EquippableReceiver);
+
 	// @TODO: Make it so this can be called from the server. At the moment only the client can call this and it work properly.
 	// Drops the specified equippable out of the equippable inventory
 	UFUNCTION(BlueprintCallable, Category = Inventory)
@@ -194,6 +338,12 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = Inventory, meta=(HidePin="bOwnerBeingDestroyed"))
 	void DropAllEquippables(bool bOwnerBeingDestroyed = false);
+
+	// Returns if any slot inventory has room left. Used by the pickup subsystem to skip inventories that can't pick anything up.
+	bool HasFreeSlot() const;
+
+	// Returns if the equippable's slot exists in this inventory and has room for it.
+	bool HasRoomForEquippable(const ASMEquippableBase* equippable) const;
 	
 protected:
 	// If enabled, equippables that do not have an assigned slot cannot be picked up.
@@ -236,7 +386,7 @@ protected:
 
 private:
 
-	void AttemptEquip(ASMEquippableBase* desiredEquippable, bool bFromReplication);
+	void AttemptEquip(ASMEquippableBase* desiredEquippable);
 	
 	void BeginUnEquippingCurrentEquippable();
 
@@ -290,6 +440,18 @@ protected:
 	FInventorySlot* FindInventorySlotByTag(FGameplayTag slotTag);
 
 	void GetAllEquippablesInInventory(TArray<ASMEquippableBase*>& OutEquippables);
+
+	// Searches CycleOrder from StartCycleIdx (wrapping around) for an equippable that we are able to switch to. Direction is 1 for next, -1 for previous.
+	ASMEquippableBase* FindEquippableToCycleTo(int32 StartCycleIdx, int32 Direction) const;
+
+	// Rebuilds InventoryIndex from EquippableInventory. Call this whenever a slot inventory changes.
+	void RebuildInventoryIndex();
+
+	// Client only. Applies a replicated inventory entry to EquippableInventory.
+	void OnReplicatedEquippableAdded(ASMEquippableBase* equippable, FGameplayTag slotTag, uint32 orderKey);
+
+	// Client only. Removes a replicated inventory entry from EquippableInventory.
+	void OnReplicatedEquippableRemoved(ASMEquippableBase* equippable, FGameplayTag slotTag);
 	
 	/* Equippable Variables
 	***********************************************************************************/
@@ -301,10 +463,17 @@ private:
 		// TArray<ASMEquippableBase*> SlotInventory
 	// we can then have operator overloads based on SlotType
 	
-	// Equippables that this Inventory Component holds.
-	UPROPERTY(VisibleInstanceOnly, Replicated)
+	// Equippables that this Inventory Component holds. Not replicated directly, the owning client rebuilds this from InventoryEntries.
+	UPROPERTY(VisibleInstanceOnly)
 	TArray<FInventorySlot> EquippableInventory;
 
+	// Replicated form of EquippableInventory, one entry per equippable.
+	UPROPERTY(Replicated)
+	FInventoryEntryList InventoryEntries;
+
+	// Lookup tables for EquippableInventory.
+	FInventoryIndex InventoryIndex;
+
 	/* CurrentEquippable is only replicated down automatically to simulated proxies. We manually replicate CurrentEquippable
 	 * between owning client and the server. This is to allow simulated proxies to get only important updates from this
 	 * variable, and keep control of exactly what happens to it on the owning client. OnRep is used to trigger animations
@@ -323,17 +492,23 @@ protected:
 	UFUNCTION(NetMulticast, Unreliable)
 	void NetMulticastVisuallyUnEquip(ASMEquippableBase* equippableToUnEquip);
 	
+	// The only reliable RPC sent by the client per equippable change. Sent once the predicted unequip finishes with
+	// whatever equippable the client settled on.
 	UFUNCTION(Server, Reliable)
-	void ServerAttemptEquip(ASMEquippableBase* desiredEquippable);
-
-	UFUNCTION(Client, Reliable)
-	void ClientAttemptEquip(ASMEquippableBase* desiredEquippable);
-	
-	UFUNCTION(Client, Reliable)
-	void ClientSetCurrentEquippable(ASMEquippableBase* equippableToSet);
+	void ServerRequestEquip(ASMEquippableBase* equippableToSet, uint16 sequence);
 
+	/* Lets the server start the unequip (remove abilities, show simulated proxies) before the request arrives. Reliable
+	 * and sequenced like ServerRequestEquip, so it can't arrive after the request that follows it or after a correction
+	 * that cancelled it. */
 	UFUNCTION(Server, Reliable)
-	void ServerSetCurrentEquippable(ASMEquippableBase* equippableToSet);
+	void ServerNotifyUnEquipping(uint16 sequence);
+
+	UFUNCTION(Client, Unreliable)
+	void ClientAckEquip(uint16 sequence);
+
+	// Sent when the server rejects a request, or changes the equippable itself. The client snaps to equippableToSet.
+	UFUNCTION(Client, Reliable)
+	void ClientCorrectEquippable(ASMEquippableBase* equippableToSet, uint16 sequence);
 
 	UFUNCTION(Server, Reliable)
 	void ServerDropEquippable(ASMEquippableBase* equippableToDrop, bool bInstant, bool bDontFindNextEquippable);
@@ -343,7 +518,7 @@ protected:
 
 	UFUNCTION()
 	void OnRep_CurrentEquippable(ASMEquippableBase* OldEquippable);
-	
+
 	UFUNCTION()
 	void OnRep_EquippableChangeStatus(EEquippableChangeStatus OldEquippableChangeStatus);
 
@@ -353,6 +528,16 @@ protected:
 public:
 	
 	bool GetCachedHasAuthority() const { return bCachedHasAuthority; }
+
+	// Returns if sequence a is newer than sequence b, handles the counter wrapping around.
+	static FORCEINLINE bool IsNewerEquipSequence(uint16 a, uint16 b) { return static_cast<int16>(a - b) > 0; }
+
+	// Returns if the owning client should apply a server correction for equip request correctionSequence. It shouldn't if
+	// it has sent a newer request since, or the server has already answered a newer one (the correction arrived late).
+	static FORCEINLINE bool ShouldApplyEquipCorrection(uint16 correctionSequence, uint16 localSequence, uint16 lastAckedSequence)
+	{
+		return !IsNewerEquipSequence(localSequence, correctionSequence) && !IsNewerEquipSequence(lastAckedSequence, correctionSequence);
+	}
 	
 private:
 
@@ -362,6 +547,15 @@ private:
 	// Should be length of unequip animation.
 	FTimerHandle UnEquipTimerHandle;
 
+	// Owning client. Sequence number of the last equip request sent to the server.
+	uint16 LocalEquipSequence = 0;
+
+	// Owning client. Sequence number of the last equip request the server answered.
+	uint16 LastAckedEquipSequence = 0;
+
+	// Server. Sequence number of the last equip request we accepted from the owning client.
+	uint16 LastAcceptedEquipSequence = 0;
+
 	// This changes rapidly, and through the function of SetDesiredEquippable, it can trigger equippable changing behaviour. Do not touch this directly.
 	UPROPERTY()
 	TWeakObjectPtr<ASMEquippableBase> DesiredEquippable;
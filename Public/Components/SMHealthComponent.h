@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "GameplayTagContainer.h"
 #include "GAS/AttributeSets/SMCharacterAttributeSet.h"
 #include "SMHealthComponent.generated.h"
 
@@ -23,18 +24,17 @@ class USMAbilitySystemComponent;
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FSMHealth_AttributeChanged, USMHealthComponent*, HealthComponent, float, OldValue, float, NewValue, AActor*, Instigator);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FSMHealth_DeathEvent, AActor*, OwningActor);
 
-// one way to possibly do it is by using GameplayTags, so for example you could have "Teams.Survivor" and "Teams.Zombie".
-// Then in code you could have global const variables such as TEAM_SURVIVOR. 
+// Deprecated, teams are gameplay tags now (see SMGameplayTags::Team_Survivor etc). Only kept so health components saved
+// with a TeamID can be converted on load.
 UENUM()
 enum class ETeamID : uint8
 {
-	// @TODO: look into being able to add and remove teams instead of having a plain old enum
 	NoTeam = 0,
 	Survivor,
 	Zombie
 };
 
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnTeamChanged, ETeamID, OldTeam, ETeamID, NewTeam);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnTeamChanged, FGameplayTag, OldTeam, FGameplayTag, NewTeam);
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class USMHealthComponent : public UActorComponent
@@ -45,6 +45,15 @@ public:
 	// Sets default values for this component's properties
 	USMHealthComponent();
 
+	// ~UActorComponent interface start
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// ~UActorComponent interface end
+
+	// ~UObject interface start
+	virtual void PostLoad() override;
+	// ~UObject interface end
+
 	// Delegate fired when the health value has changed.
 	UPROPERTY(BlueprintAssignable)
 	FSMHealth_AttributeChanged OnHealthChanged;
@@ -105,17 +114,17 @@ public:
 	
 	// Set the team of the pawn that this Health Component lives on.
 	UFUNCTION(BlueprintCallable, Category = HealthComponent)
-	void SetTeam(ETeamID newTeam);
+	void SetTeam(FGameplayTag newTeam);
 
-	// Get the Team ID of this Health Component.
+	// Get the team of this Health Component.
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = HealthComponent)
-	ETeamID GetTeam();
+	FGameplayTag GetTeam() const { return Team; }
 	
-	// Find the team of a certain Actor if it has a Health Component. Can return NoTeam.
+	// Find the team of a certain Actor if it has a Health Component. Can return an empty tag (no team).
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = HealthComponent)
-	static ETeamID GetTeamFromActor(const AActor* Actor);
+	static FGameplayTag GetTeamFromActor(const AActor* Actor);
 
-	// Returns if two Actors are on the same team.
+	// Returns if two Actors aren't hostile to each other (see USMTeamSubsystem).
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = HealthComponent)
 	static bool IsFriendly(const AActor* ActorA, const AActor* ActorB);
 
@@ -125,13 +134,20 @@ public:
 	FOnTeamChanged OnTeamChange;
 
 private:
-	// The current team. Should not edit directly, please use the SetTeam function instead.
-	UPROPERTY(EditDefaultsOnly, Category = HealthComponent, ReplicatedUsing=OnRep_TeamID, meta=(AllowPrivateAccess=true))
+	// The current team, no tag means no team. Should not edit directly, please use the SetTeam function instead.
+	UPROPERTY(EditDefaultsOnly, Category = HealthComponent, ReplicatedUsing=OnRep_Team, meta=(AllowPrivateAccess=true, Categories="Team"))
+	FGameplayTag Team;
+
+	// Deprecated, converted to Team in PostLoad.
+	UPROPERTY(meta=(DeprecatedProperty, DeprecationMessage="Use Team instead."))
 	ETeamID TeamID = ETeamID::NoTeam;
 
 protected:
 	UFUNCTION()
-	virtual void OnRep_TeamID(ETeamID OldTeam);
+	virtual void OnRep_Team(FGameplayTag OldTeam);
+
+	// Lets the team subsystem know what team our owner is on.
+	void RegisterWithTeamSubsystem();
 
 #pragma endregion Team
 
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "GameplayTagContainer.h"
+#include "SMHitboxSet.generated.h"
+
+class UPhysicalMaterial;
+
+// A capsule attached to a bone. A sphere when both ends are the same.
+USTRUCT()
+struct FSMHitbox
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox")
+	FName BoneName;
+
+	// Ends of the capsule, relative to the bone.
+	UPROPERTY(EditAnywhere, Category = "Hitbox")
+	FVector Start = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox")
+	FVector End = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, Category = "Hitbox", meta=(ClampMin="0.0"))
+	float Radius = 10.0f;
+
+	// What part of the body this is, for anything that reacts to where a character got hit.
+	UPROPERTY(EditAnywhere, Category = "Hitbox", meta=(Categories="HitZone"))
+	FGameplayTag HitZone;
+};
+
+/**
+ * The capsules bullets hit on a character archetype, instead of the skeletal mesh. A handful of bone attached capsules
+ * are traced by USMLagCompensationSubsystem with its own kernel, rather than tracing per poly or physics asset
+ * geometry on the bullet channel. Meshes of characters with a hitbox set ignore the bullet channel.
+ */
+UCLASS()
+class SPAWNMASTER_API USMHitboxSet : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	// Keep it small, every capsule is tested by every bullet that comes close to the character.
+	UPROPERTY(EditDefaultsOnly, Category = "Hitboxes", meta=(TitleProperty="BoneName"))
+	TArray<FSMHitbox> Hitboxes;
+
+	// Physical material reported by hits on any of the hitboxes.
+	UPROPERTY(EditDefaultsOnly, Category = "Hitboxes")
+	UPhysicalMaterial* PhysicalMaterial = nullptr;
+};
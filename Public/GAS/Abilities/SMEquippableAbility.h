@@ -6,6 +6,13 @@
 #include "GAS/Abilities/SMEquippableAbilityBase.h"
 #include "SMEquippableAbility.generated.h"
 
+struct FSMCartridgeTargetData;
+struct FSMPelletDirections;
+class UGameplayEffect;
+class UCurveFloat;
+class UPhysicalMaterial;
+struct FSMDamageMultiplierTable;
+
 /**
  * 
  */
@@ -37,6 +44,12 @@ protected:
 		// The direction of the trace if aim were perfect
 		FVector AimDir;
 
+		// Spread angle (in degrees, diametrical) the pellets are scattered in
+		float SpreadAngle = 0.0f;
+
+		// Seed of the random stream the pellet directions come from
+		int32 SpreadSeed = 0;
+
 		// The equippable instance / source of equippable data
 		ASMGunBase* EquippableData = nullptr;
 
@@ -51,55 +64,114 @@ protected:
 		}
 	};
 
+	// A single pellet of a cartridge being traced.
+	struct FPelletTrace
+	{
+		// End of the trace, with spread applied
+		FVector EndTrace = FVector::ZeroVector;
+
+		FHitResult Impact;
+
+		// Everything this pellet hit
+		TArray<FHitResult> Hits;
+
+		// Raw query results and the sweep's hits. Only kept so their memory gets reused from shot to shot.
+		TArray<FHitResult> QueryResults;
+		TArray<FHitResult> SweepHits;
+
+		// Empties the pellet, keeping its memory around.
+		void Reset()
+		{
+			Impact = FHitResult();
+			Hits.Reset();
+			QueryResults.Reset();
+			SweepHits.Reset();
+		}
+	};
+
 	UFUNCTION(BlueprintCallable)
 	void StartRangedTargeting();
 	
-	void PerformLocalTargeting(TArray<FHitResult>& Hits);
-	void TraceBulletsInCartridge(const FRangedEquippableFiringInput& InputData, TArray<FHitResult>& OutHits);
-	FHitResult DoSingleBulletTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, bool bIsSimulated, OUT TArray<FHitResult>& OutHits);
-	FHitResult WeaponTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, bool bIsSimulated, OUT TArray<FHitResult>& OutHitResults) const;
+	// Traces a cartridge from the local player's aim. Returns whether anything was added to OutCartridge.
+	bool PerformLocalTargeting(FSMCartridgeTargetData& OutCartridge);
+	void TraceBulletsInCartridge(const FRangedEquippableFiringInput& InputData, FSMCartridgeTargetData& OutCartridge);
+
+	// The direction of every pellet of a cartridge. Deterministic for the same inputs, so client and server agree.
+	static void GeneratePelletDirections(const FVector& AimDir, float SpreadAngle, int32 SpreadSeed, int32 NumPellets, FSMPelletDirections& OutDirections);
+
+	// Traces a single bullet, line first and then a sweep if the line didn't hit a pawn. Doesn't touch anything but the
+	// physics scene (unless debug drawing), so it is safe to call from worker threads.
+	FHitResult DoSingleBulletTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, const FCollisionQueryParams& TraceParams, ECollisionChannel TraceChannel, OUT FPelletTrace& PelletTrace) const;
+	FHitResult WeaponTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, const FCollisionQueryParams& TraceParams, ECollisionChannel TraceChannel, TArray<FHitResult>& QueryResults, OUT TArray<FHitResult>& OutHitResults) const;
+
+	// Rebuilds WeaponTraceParams, the query params shared by every bullet trace until the ability ends.
+	void RefreshWeaponTraceParams(bool bIsSimulated);
 	
 	// Determine the trace channel to use for the weapon trace(s)
 	virtual ECollisionChannel DetermineTraceChannel(FCollisionQueryParams& TraceParams, bool bIsSimulated) const;
 	
 	void OnTargetDataReadyCallback(const FGameplayAbilityTargetDataHandle& InData, FGameplayTag ApplicationTag);
+
+	/* Server only. Rebuilds where the client's pellets went and drops hits the lag compensation history says couldn't have
+	 * happened. The bone and physical material of the hits that stay come from the hitbox they went through. */
+	void RemoveUnconfirmedHits(FGameplayAbilityTargetDataHandle& TargetData) const;
 	
 	FTransform GetTargetingTransform(APawn* SourcePawn) const;
 	FVector GetEquippableTargetingSourceLocation() const;
 	static int32 FindFirstPawnHitResult(const TArray<FHitResult>& HitResults);
 	
-	FVector VRandConeNormalDistribution(const FVector& Dir, const float ConeHalfAngleRad, const float Exponent)
-	{
-		if (ConeHalfAngleRad > 0.f)
-		{
-			const float ConeHalfAngleDegrees = FMath::RadiansToDegrees(ConeHalfAngleRad);
-
-			// consider the cone a concatenation of two rotations. one "away" from the center line, and another "around" the circle
-			// apply the exponent to the away-from-center rotation. a larger exponent will cluster points more tightly around the center
-			const float FromCenter = FMath::Pow(FMath::FRand(), Exponent);
-			const float AngleFromCenter = FromCenter * ConeHalfAngleDegrees;
-			const float AngleAround = FMath::FRand() * 360.0f;
-
-			FRotator Rot = Dir.Rotation();
-			FQuat DirQuat(Rot);
-			FQuat FromCenterQuat(FRotator(0.0f, AngleFromCenter, 0.0f));
-			FQuat AroundQuat(FRotator(0.0f, 0.0, AngleAround));
-			FQuat FinalDirectionQuat = DirQuat * AroundQuat * FromCenterQuat;
-			FinalDirectionQuat.Normalize();
-
-			return FinalDirectionQuat.RotateVector(FVector::ForwardVector);
-		}
-		else
-		{
-			return Dir.GetSafeNormal();
-		}
-	};
+	// Unpacks every hit in the target data, one per pellet for cartridge target data.
+	UFUNCTION(BlueprintPure, Category = "Ability|TargetData")
+	static TArray<FHitResult> GetHitResultsFromTargetData(const FGameplayAbilityTargetDataHandle& TargetData);
 
 	// Called when target data is ready
 	UFUNCTION(BlueprintImplementableEvent)
 	void OnRangedWeaponTargetDataReady(const FGameplayAbilityTargetDataHandle& TargetData);
+
+	/* Server only. Applies DamageEffectClass once to every ability system hit by the target data, instead of once per
+	 * pellet. The pellets that hit the same target are summed into the effect's SetByCallerDamageMultiplier, each
+	 * scaled by its hit zone, physical material and distance (see GetDamageMultiplierTable). Only the first cartridge
+	 * counts, and each pellet only for the first thing it hit. Returns how many targets the effect was applied to. */
+	UFUNCTION(BlueprintCallable, Category = "Ability|Damage")
+	int32 ApplyDamageToTargets(const FGameplayAbilityTargetDataHandle& TargetData);
+
+	// Effect ApplyDamageToTargets applies, should use USMDamageExecution.
+	UPROPERTY(EditDefaultsOnly, Category = "Damage")
+	TSubclassOf<UGameplayEffect> DamageEffectClass;
+
+	// Damage multiplier of a pellet hitting these bones (e.g. 2 for the head). Bones not in here use their parent's.
+	UPROPERTY(EditDefaultsOnly, Category = "Damage")
+	TMap<FName, float> HitZoneDamageMultipliers;
+
+	/* Damage multiplier of a pellet hitting a hitbox of these zones. Characters with a hitbox set are scored by this
+	 * instead of the bone multipliers. Zones not in here use their parent tag's. */
+	UPROPERTY(EditDefaultsOnly, Category = "Damage", meta=(Categories="HitZone"))
+	TMap<FGameplayTag, float> HitboxZoneDamageMultipliers;
+
+	// Damage multiplier of a pellet hitting these physical materials. Only materials in USMCombatSettings::ReplicatedPhysicalMaterials count.
+	UPROPERTY(EditDefaultsOnly, Category = "Damage")
+	TMap<UPhysicalMaterial*, float> PhysicalMaterialDamageMultipliers;
+
+	// Damage multiplier by distance travelled (in cm). No falloff when not set.
+	UPROPERTY(EditDefaultsOnly, Category = "Damage")
+	UCurveFloat* DamageFalloffCurve = nullptr;
+
+public:
+
+	// The damage multipliers above compiled for lookups, shared by every instance of this ability class.
+	TSharedRef<const FSMDamageMultiplierTable> GetDamageMultiplierTable() const;
 	
 private:
 	
 	FDelegateHandle OnTargetDataReadyCallbackDelegateHandle;
+
+	// Built on activation, so the attached actors to ignore aren't gathered every shot.
+	FCollisionQueryParams WeaponTraceParams;
+	ECollisionChannel WeaponTraceChannel = ECC_Visibility;
+
+	// Reused by every cartridge this ability traces.
+	TArray<FPelletTrace> PelletTraceScratch;
+
+	// Cartridges OnTargetDataReadyCallback handled this activation, part of the spread seed.
+	uint32 NumCartridgesHandled = 0;
 };
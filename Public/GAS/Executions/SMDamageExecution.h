@@ -17,7 +17,28 @@ class SPAWNMASTER_API USMDamageExecution : public UGameplayEffectExecutionCalcul
 public:
 	USMDamageExecution();
 
+	/* Set by caller magnitude BaseDamage is scaled by, 1 when not set. Damage applied once for several pellets sets it to
+	 * the sum of each pellet's multiplier (see USMEquippableAbility::ApplyDamageToTargets). */
+	static const FName SetByCallerDamageMultiplier;
+
+	/* Set by caller magnitude on copies of ASMEquippableBase::GetDamageSpecTemplate. The template is rebuilt whenever
+	 * the source's BaseDamage changes, so its snapshot is the current value and the fast path can read it directly. */
+	static const FName SetByCallerFromDamageTemplate;
+
+	// Copy of a damage spec template for one target, with its own context holding the hit and the target's multiplier.
+	static FGameplayEffectSpec MakeDamageSpec(const FGameplayEffectSpec& SpecTemplate, const FHitResult& HitResult, float DamageMultiplier);
+
 protected:
 
 	virtual void Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const override;
+
+	/* Whether the effect can skip evaluating the captured aggregators, which is when it doesn't add scoped modifiers to
+	 * this execution. Worked out once per effect. Still needs both ability systems to be free of tag conditional modifiers,
+	 * and the spec to come from the damage spec template (see SetByCallerFromDamageTemplate). */
+	bool CanEffectUseFastPath(const UGameplayEffect* Effect) const;
+
+private:
+
+	// Results of CanEffectUseFastPath. Executions run on the class default object, so this is shared by every effect.
+	mutable TMap<TObjectKey<UGameplayEffect>, bool> FastPathEffects;
 };
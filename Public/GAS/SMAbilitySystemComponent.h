@@ -4,9 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "AbilitySystemComponent.h"
+#include "Net/Serialization/FastArraySerializer.h"
 #include "SMAbilitySystemComponent.generated.h"
 
+class USMAbilitySystemComponent;
+class USMEnhancedInputComponent;
 class USMGameplayAbility;
+struct FSMRepAnimMontageSlots;
+
 /** Data about montages that were played locally (all montages in case of server. predictive montages in case of client). Never replicated directly. */
 USTRUCT()
 struct SPAWNMASTER_API FGameplayAbilityLocalAnimMontageForMesh
@@ -35,52 +40,92 @@ public:
 	}
 };
 
-/* Struct to keep information about an ability and it's InputID grouped together, along with
- * the pressed and release handles for unbinding later on.
- */
-struct FAbilityInput
+/* What the montage on one mesh is doing, as sent to simulated clients. Positions and blend times are sent in
+ * centiseconds and play rates in hundredths, the server quantizes before storing so a slot is only dirtied when what
+ * gets sent actually changes. */
+USTRUCT()
+struct SPAWNMASTER_API FSMRepAnimMontage
 {
-	FAbilityInput(): InputID(0), PressedHandle(0), ReleasedHandle(0)
-	{
-	};
-	
-	FGameplayAbilitySpecHandle Handle;
-	
-	int32 InputID;
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UAnimMontage* AnimMontage = nullptr;
+
+	float PlayRate = 1.0f;
+	float Position = 0.0f;
+	float BlendTime = 0.0f;
+
+	// Section indices + 1, so 0 can mean INDEX_NONE.
+	uint8 NextSectionID = 0;
+	uint8 SectionIdToPlay = 0;
+
+	// Bumped every time a montage is played, so playing the same montage again is still a change.
+	uint8 PlayInstanceId = 0;
+
+	bool bIsStopped = true;
+
+	// Rounds the floats to what NetSerialize can send.
+	void Quantize();
 
-	int32 PressedHandle;
-	int32 ReleasedHandle;
-	int32 CancelledHandle;
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
 
-	bool operator==(const FAbilityInput& other) const
+	bool operator==(const FSMRepAnimMontage& other) const;
+	bool operator!=(const FSMRepAnimMontage& other) const { return !(*this == other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FSMRepAnimMontage> : public TStructOpsTypeTraitsBase2<FSMRepAnimMontage>
+{
+	enum
 	{
-		return (other.Handle == Handle);
-	}
+		WithNetSerializer = true,
+	};
 };
 
-/**
-* Data about montages that is replicated to simulated clients.
-*/
+// The montage of one of the avatar's meshes, see FSMRepAnimMontageSlots.
 USTRUCT()
-struct SPAWNMASTER_API FGameplayAbilityRepAnimMontageForMesh
+struct SPAWNMASTER_API FSMRepAnimMontageSlot : public FFastArraySerializerItem
 {
-	GENERATED_BODY();
+	GENERATED_BODY()
 
-public:
+	// EMeshType of the mesh, instead of a reference to the mesh itself.
 	UPROPERTY()
-	USkeletalMeshComponent* Mesh;
+	uint8 MeshType = 0;
 
 	UPROPERTY()
-	FGameplayAbilityRepAnimMontage RepMontageInfo;
+	FSMRepAnimMontage Montage;
+
+	void PostReplicatedAdd(const FSMRepAnimMontageSlots& InArraySerializer);
+	void PostReplicatedChange(const FSMRepAnimMontageSlots& InArraySerializer);
+};
 
-	FGameplayAbilityRepAnimMontageForMesh() : Mesh(nullptr), RepMontageInfo()
+/* Montage data replicated to simulated clients, one fixed slot per EMeshType. Only slots that changed are sent, and
+ * clients only handle the slots they received. */
+USTRUCT()
+struct SPAWNMASTER_API FSMRepAnimMontageSlots : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	// Server side slot N is always at index N, clients go by MeshType.
+	UPROPERTY()
+	TArray<FSMRepAnimMontageSlot> Slots;
+
+	UPROPERTY(NotReplicated)
+	USMAbilitySystemComponent* OwnerComponent = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
 	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FSMRepAnimMontageSlot, FSMRepAnimMontageSlots>(Slots, DeltaParms, *this);
 	}
+};
 
-	FGameplayAbilityRepAnimMontageForMesh(USkeletalMeshComponent* InMesh)
-		: Mesh(InMesh), RepMontageInfo()
+template<>
+struct TStructOpsTypeTraits<FSMRepAnimMontageSlots> : public TStructOpsTypeTraitsBase2<FSMRepAnimMontageSlots>
+{
+	enum
 	{
-	}
+		WithNetDeltaSerializer = true,
+	};
 };
 
 /**
@@ -92,6 +137,18 @@ class USMAbilitySystemComponent : public UAbilitySystemComponent
 	GENERATED_BODY()
 
 public:
+	USMAbilitySystemComponent();
+
+	virtual void InitializeComponent() override;
+	virtual void InitAbilityActorInfo(AActor* InOwnerActor, AActor* InAvatarActor) override;
+
+	/* True while an active effect on us has modifiers that only apply for certain source or target tags. When false,
+	 * our attributes' current values are what any capture would evaluate to, so executions can read them directly. */
+	bool HasTagConditionalModifiers() const { return TagConditionalEffects.Num() > 0; }
+
+	// Whether any modifier of the effect has source or target tag requirements. Cached per effect.
+	static bool EffectHasTagConditionalModifiers(const UGameplayEffect* Effect);
+	
 	float PlayMontageForMesh(USkeletalMeshComponent* Mesh, USMGameplayAbility* AnimatingAbility,
 	                         FGameplayAbilityActivationInfo ActivationInfo, UAnimMontage* Montage, float InPlayRate = 1.0f,
 	                         FName StartSectionName = NAME_None, float StartTimeSeconds = 0.0f, bool bReplicateMontage = true);
@@ -107,6 +164,30 @@ public:
 
 	// Returns the montage that is playing for the mesh
 	UAnimMontage* GetCurrentMontageForMesh(USkeletalMeshComponent* InMesh);
+
+	// Applies a replicated montage slot. Only called for slots that changed.
+	void OnRep_AnimMontageSlot(const FSMRepAnimMontageSlot& RepSlot);
+
+	// Server only. Whether any replicated slot has a montage that hasn't stopped.
+	bool HasActiveReplicatedMontage() const;
+
+	// Server only. Resends the positions of playing montages, called by USMMontageReplicationSubsystem when it's time.
+	void UpdateReplicatedMontagePositions();
+
+	// Server only. Sends a stop for any replicated montage that stopped or finished on its own since it was last sent.
+	void UpdateReplicatedMontageStops();
+
+	// Input routed by USMEnhancedInputComponent. Same as AbilityLocalInputPressed/Released, for one spec instead of every spec with an InputID.
+	void AbilityHandleInputPressed(FGameplayAbilitySpecHandle Handle);
+	void AbilityHandleInputReleased(FGameplayAbilitySpecHandle Handle);
+
+	// Specs whose ability has the tag, or a child of it, in its ability tags. Same matching as TryActivateAbilitiesByTag.
+	void FindSpecsByTag(const FGameplayTag& Tag, TArray<FGameplayAbilitySpecHandle>& OutHandles) const;
+
+	/* TryActivateAbilitiesByTag for a single tag, going through AbilityTagIndex instead of matching the tags of every
+	 * activatable spec. Returns true if anything activated. */
+	UFUNCTION(BlueprintCallable, Category = "Abilities")
+	bool TryActivateAbilityByTagFast(const FGameplayTag& Tag, bool bAllowRemoteActivation = true);
 	
 protected:
 	virtual void OnGiveAbility(FGameplayAbilitySpec& AbilitySpec) override;
@@ -114,12 +195,18 @@ protected:
 
 	FGameplayAbilityLocalAnimMontageForMesh& GetLocalAnimMontageInfoForMesh(USkeletalMeshComponent* Mesh);
 
-	// Finds the existing FGameplayAbilityRepAnimMontageForMesh for the mesh or creates one if it doesn't exist
-	FGameplayAbilityRepAnimMontageForMesh& GetGameplayAbilityRepAnimMontageForMesh(USkeletalMeshComponent* InMesh);
+	// EMeshType of the avatar's mesh, INDEX_NONE if it isn't one of them.
+	int32 GetMeshSlot(const USkeletalMeshComponent* InMesh) const;
 
-	// Copy LocalAnimMontageInfo into RepAnimMontageInfo
+	USkeletalMeshComponent* GetMeshForSlot(int32 Slot) const;
+
+	// Server only. The replicated slot for the mesh, nullptr if the mesh doesn't have one.
+	FSMRepAnimMontageSlot* GetRepAnimMontageSlotForMesh(USkeletalMeshComponent* InMesh);
+
+	/* Copy the mesh's local montage info into its replicated slot. The slot is only marked dirty when something that gets
+	 * sent changed, unless bForceDirty. */
 	void AnimMontage_UpdateReplicatedDataForMesh(USkeletalMeshComponent* InMesh);
-	void AnimMontage_UpdateReplicatedDataForMesh(FGameplayAbilityRepAnimMontageForMesh& OutRepAnimMontageInfo);
+	void AnimMontage_UpdateReplicatedDataForMesh(USkeletalMeshComponent* InMesh, FSMRepAnimMontageSlot& RepSlot, bool bForceDirty = false);
 
 	/** Called when a prediction key that played a montage is rejected */
 	void OnPredictiveMontageRejectedForMesh(USkeletalMeshComponent* InMesh, UAnimMontage* PredictiveMontage);
@@ -139,30 +226,32 @@ protected:
 	TArray<FGameplayAbilityLocalAnimMontageForMesh> LocalAnimMontageInfoForMeshes;
 
 	// Data structure for replicating montage info to simulated clients
-	// Will be max one element per skeletal mesh on the AvatarActor
-	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedAnimMontageForMesh)
-	TArray<FGameplayAbilityRepAnimMontageForMesh> RepAnimMontageInfoForMeshes;
+	UPROPERTY(Replicated)
+	FSMRepAnimMontageSlots RepAnimMontageSlots;
+
+	// Net updates the avatar through USMMontageReplicationSubsystem, so it happens at most once per frame.
+	void RequestMontageNetUpdate() const;
 
-	UFUNCTION()
-	virtual void OnRep_ReplicatedAnimMontageForMesh();
+	// Slots that arrived before the avatar could play them, one bit per slot. Retried once the avatar is set.
+	uint8 PendingMontageSlots = 0;
 	
 protected:
-	UEnhancedInputComponent* GetInputComponent() const;
-
-	int32 GetNextInputID()
-	{
-		static int32 InputID;
-		InputID += 1;
-		return InputID;
-	};
+	USMEnhancedInputComponent* GetInputComponent() const;
 	
 private:
 	UPROPERTY()
-	UEnhancedInputComponent* OwnerPlayerInputComponent;
-	
-	int32 InvalidInputID = INDEX_NONE;
+	USMEnhancedInputComponent* OwnerPlayerInputComponent;
+
+	void OnActiveEffectAdded(UAbilitySystemComponent* Target, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle);
+	void OnActiveEffectRemoved(const FActiveGameplayEffect& Effect);
+
+	// Active effects with tag conditional modifiers, see HasTagConditionalModifiers.
+	TSet<FActiveGameplayEffectHandle> TagConditionalEffects;
+
+	void AddToAbilityTagIndex(const FGameplayAbilitySpec& AbilitySpec);
+	void RemoveFromAbilityTagIndex(const FGameplayAbilitySpec& AbilitySpec);
 
-	// Array to keep track of what InputID is bound to what ability.
-	TArray<FAbilityInput> AbilityInputArray;
+	// Every ability tag of every given spec, parents included, to the specs that have it. Updated on give and remove.
+	TMultiMap<FGameplayTag, FGameplayAbilitySpecHandle> AbilityTagIndex;
 	
 };
@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
+#include "Engine/NetSerialization.h"
+#include "GameplayTagContainer.h"
+#include "GameplayPrediction.h"
+#include "SMCartridgeTargetData.generated.h"
+
+struct FSMPelletDirections;
+
+// Where a single pellet of a cartridge ended up.
+USTRUCT()
+struct FSMPelletHit
+{
+	GENERATED_BODY()
+
+	// What the pellet hit. Null for misses and for hits on things without a component.
+	UPROPERTY()
+	TWeakObjectPtr<UPrimitiveComponent> HitComponent;
+
+	// Bone of HitComponent (if it is a skinned mesh) that was hit.
+	UPROPERTY()
+	int16 BoneIndex = INDEX_NONE;
+
+	// Index into USMCombatSettings::ReplicatedPhysicalMaterials, 0 means none.
+	UPROPERTY()
+	uint8 PhysicalMaterialIndex = 0;
+
+	// Which pellet of the cartridge this is, picks the pellet's direction out of the spread pattern.
+	UPROPERTY()
+	uint8 PelletIndex = 0;
+
+	// How far along the pellet's direction it hit (or the trace ended), in cm.
+	UPROPERTY()
+	uint32 Distance = 0;
+
+	// Where the pellet hit, or the end of the trace if it didn't. Not sent, the server rebuilds it from the pellet's
+	// direction and Distance (see RebuildImpactPoints).
+	UPROPERTY()
+	FVector ImpactPoint = FVector::ZeroVector;
+
+	// Hit zone of the hitbox the pellet hit, on characters with a hitbox set. Not sent, the server takes it from the
+	// hitbox it confirms the hit against.
+	UPROPERTY()
+	FGameplayTag HitZone;
+
+	// False when the pellet didn't hit anything, and is only sent so the client's tracer direction is known.
+	UPROPERTY()
+	bool bHit = false;
+};
+
+/**
+ * All pellet hits of a single cartridge, replacing one FGameplayAbilityTargetData_SingleTargetHit (and a full
+ * FHitResult) per hit. Sent from the client when it fires, so it is kept small: the trace origin, aim and spread are
+ * only sent once, and each pellet is a component reference, a bone index, a physical material index and a distance.
+ *
+ * Pellet directions aren't sent at all. They come from a random stream seeded by the ability's prediction key and how
+ * many cartridges the activation fired before, so the server regenerates the exact same rays the client traced. Aim
+ * and spread are quantized on the client before it traces, so both sides start from the same values.
+ */
+USTRUCT()
+struct FSMCartridgeTargetData : public FGameplayAbilityTargetData
+{
+	GENERATED_BODY()
+
+	// Identifies which cartridge of a burst this is.
+	UPROPERTY()
+	uint32 CartridgeID = 0;
+
+	// Aim direction, compressed like a rotator.
+	UPROPERTY()
+	uint16 AimPitch = 0;
+
+	UPROPERTY()
+	uint16 AimYaw = 0;
+
+	// Spread angle in hundredths of a degree.
+	UPROPERTY()
+	uint16 SpreadAngleCentidegrees = 0;
+
+	// How far behind the replicated state the client drew everyone else when it fired, in milliseconds.
+	UPROPERTY()
+	uint8 InterpolationDelayMs = 0;
+
+	// Start of every pellet trace.
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	// Inline so a whole cartridge is the one allocation the target data handle makes. Not a UPROPERTY because of that,
+	// nothing in here needs reflection, it has its own NetSerialize and only holds weak pointers.
+	TArray<FSMPelletHit, TInlineAllocator<12>> Pellets;
+
+	// Quantizes and stores the aim direction and spread angle (in degrees, diametrical). Read them back with the getters
+	// below before tracing, so the client traces with what the server will see.
+	void SetAim(const FVector& aimDirection, float spreadAngle);
+
+	FVector GetAimDirection() const;
+	float GetSpreadAngle() const;
+
+	// In seconds, see USMLagCompensationSubsystem::GetInterpolationDelay. Anything over 255ms is sent as 255ms.
+	void SetInterpolationDelay(float interpolationDelay);
+	float GetInterpolationDelay() const;
+
+	/* Seed for the spread pattern of the activation's cartridgeIdx'th cartridge. Nothing in the cartridge goes into it,
+	 * so the pattern can't be picked per shot after aiming.
+	 *
+	 * The prediction key is still the client's, so a cheating client can skip keys until the next activation gets a
+	 * tight pattern. That is accepted on purpose. The seed has to be known before the client traces, so a server value
+	 * mixed in would have to reach the client ahead of the shot, and it only stops shopping if it changes every
+	 * activation. That is a round trip before every first shot. What the server does make sure of in
+	 * RemoveUnconfirmedHits:
+	 * - every pellet is on a ray the server regenerates, inside a cone no tighter than the gun's minimum spread
+	 * - a hit only counts if it lines up with the target's hitbox history
+	 * So the best a shopped seed gets is the gun's minimum spread with its pellets bunched towards the middle, the same
+	 * as a no spread cheat in any shooter that lets clients predict hits. */
+	static int32 GetSpreadSeed(FPredictionKey::KeyType predictionKey, uint32 cartridgeIdx) { return static_cast<int32>(HashCombine(static_cast<uint32>(predictionKey), cartridgeIdx)); }
+
+	// Packs a hit result of the given pellet into a new entry.
+	void AddHit(const FHitResult& hit, int32 pelletIdx, const FGameplayTag& hitZone = FGameplayTag());
+
+	/* Which of a pellet's hits it deals its damage to: the nearest one that either blocks the pellet or is on something
+	 * that canTakeDamage. Overlaps on anything else are passed through. INDEX_NONE if there is no such hit. */
+	static int32 FindPelletStop(TConstArrayView<FHitResult> hits, TFunctionRef<bool(const FHitResult&)> canTakeDamage);
+
+	/* Server side clean up of what a client sent. Keeps one entry of every pellet index below numPellets, the first one
+	 * that canTakeDamage or else the first one, so no pellet counts more than once and there are never more entries than
+	 * the gun fires pellets. */
+	void RemoveDuplicatePellets(int32 numPellets, TFunctionRef<bool(const FSMPelletHit&)> canTakeDamage);
+
+	/* Rebuilds every pellet's impact point from the pellet directions. Pellets with an index outside of the directions
+	 * (more pellets than the gun fires) are turned into misses. */
+	void RebuildImpactPoints(const FSMPelletDirections& pelletDirections);
+
+	// Unpacks a pellet back into a hit result. Anything that isn't sent (normals, face index etc) is left default.
+	FHitResult GetPelletHitResult(int32 pelletIdx) const;
+
+	// ~FGameplayAbilityTargetData interface begin
+	virtual TArray<TWeakObjectPtr<AActor>> GetActors() const override;
+	virtual UScriptStruct* GetScriptStruct() const override { return FSMCartridgeTargetData::StaticStruct(); }
+	virtual FString ToString() const override;
+	// ~FGameplayAbilityTargetData interface end
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FSMCartridgeTargetData> : public TStructOpsTypeTraitsBase2<FSMCartridgeTargetData>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
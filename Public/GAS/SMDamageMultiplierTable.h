@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Items/SMBakedCurve.h"
+#include "UObject/ObjectKey.h"
+
+class UCurveFloat;
+class UPhysicalMaterial;
+class USkinnedAsset;
+class USkinnedMeshComponent;
+
+/**
+ * Per hit damage multipliers of a weapon: hit zone (hitbox zone tag or bone), physical material and distance falloff.
+ * Compiled once from the designer facing maps and curve, so scoring a hit is a few array lookups and a baked curve
+ * sample instead of name or tag matching.
+ *
+ * Hits on a hitbox with a hit zone use the zone's multiplier, anything else its bone's. Bone multipliers are expanded
+ * per skinned asset the first time it is hit, zone multipliers per zone. Both fall back to their parent (bone or tag)
+ * when they don't have one of their own, so a multiplier on the head covers everything under it. Game thread only.
+ */
+struct FSMDamageMultiplierTable
+{
+	void Compile(const TMap<FName, float>& boneMultipliers, const TMap<FGameplayTag, float>& zoneMultipliers, const TMap<UPhysicalMaterial*, float>& physicalMaterialMultipliers, const UCurveFloat* falloffCurve);
+
+	/* Multiplier of a packed pellet hit. The bone is only used without a hit zone. The physical material index is the one
+	 * from USMCombatSettings, distance is in cm. */
+	float GetMultiplier(const USkinnedMeshComponent* mesh, int32 boneIndex, const FGameplayTag& hitZone, uint8 physicalMaterialIndex, float distance) const;
+
+	// Multiplier of a full hit result, hitZone being the hit zone of the hitbox it hit if any.
+	float GetMultiplier(const FHitResult& hit, const FGameplayTag& hitZone = FGameplayTag()) const;
+
+private:
+
+	float GetBoneMultiplier(const USkinnedMeshComponent* mesh, int32 boneIndex) const;
+	float GetZoneMultiplier(const FGameplayTag& hitZone) const;
+
+	TMap<FName, float> BoneMultipliersByName;
+
+	TMap<FGameplayTag, float> ZoneMultipliersByTag;
+
+	// Every zone looked up so far, with the multiplier it inherits from its parents when it doesn't have one.
+	mutable TMap<FGameplayTag, float> ResolvedZoneMultipliers;
+
+	// Indexed by the skinned asset's bone index.
+	mutable TMap<TObjectKey<USkinnedAsset>, TArray<float>> BoneMultipliersByAsset;
+
+	// Indexed by the replicated physical material index, 0 (no material) is always 1.
+	TArray<float> PhysicalMaterialMultipliers;
+
+	FSMBakedCurve Falloff;
+	bool bHasFalloff = false;
+};
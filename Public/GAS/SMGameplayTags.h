@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NativeGameplayTags.h"
+
+/**
+ * Gameplay tags the SpawnMaster module uses from code. They are registered natively, so using one is a plain copy
+ * instead of an FName hash and a tag manager lookup every time.
+ */
+namespace SMGameplayTags
+{
+	SPAWNMASTER_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Character_Aiming);
+	SPAWNMASTER_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Character_IsChangingEquippable);
+	SPAWNMASTER_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(EquippableSlot_NoSlot);
+	SPAWNMASTER_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Team_Survivor);
+	SPAWNMASTER_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Team_Zombie);
+}
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * The directions of every pellet in a cartridge, as structure of arrays. Generated 4 pellets at a time with vector
+ * math: the aim basis is built once, and each pellet is just two sin/cos pairs and a mix of the basis axes, instead of
+ * building and multiplying three quaternions per pellet.
+ */
+struct FSMPelletDirections
+{
+	/* Scatters numDirections directions in a cone around aimDir. exponent clusters them towards the center (1 is
+	 * uniform in angle). Draws two numbers per direction from stream, so the same stream state gives the same pattern. */
+	void Generate(const FVector& aimDir, float coneHalfAngleRad, float exponent, FRandomStream& stream, int32 numDirections);
+
+	int32 Num() const { return NumDirections; }
+
+	bool IsValidIndex(int32 directionIdx) const { return directionIdx >= 0 && directionIdx < NumDirections; }
+
+	FVector operator[](int32 directionIdx) const
+	{
+		checkSlow(IsValidIndex(directionIdx));
+		return FVector(X[directionIdx], Y[directionIdx], Z[directionIdx]);
+	}
+
+private:
+
+	// Padded to a multiple of 4, only the first NumDirections are valid.
+	TArray<float, TInlineAllocator<16>> X;
+	TArray<float, TInlineAllocator<16>> Y;
+	TArray<float, TInlineAllocator<16>> Z;
+
+	int32 NumDirections = 0;
+};
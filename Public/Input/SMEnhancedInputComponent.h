@@ -4,15 +4,51 @@
 
 #include "CoreMinimal.h"
 #include "EnhancedInputComponent.h"
+#include "GameplayAbilitySpecHandle.h"
 #include "SMEnhancedInputComponent.generated.h"
 
-struct FGameplayAbilitySpec;
+class USMAbilitySystemComponent;
+
 /**
- * 
+ * Routes ability input actions to the ability specs that use them.
+ *
+ * Every input action used by an ability is bound once for the lifetime of the component, the first time an ability
+ * with it is given. Giving and removing abilities after that only updates the action -> spec handle table, so pressing
+ * an action is a lookup of the specs bound to it instead of a binding per spec that has to be found and removed again.
  */
 UCLASS()
 class SPAWNMASTER_API USMEnhancedInputComponent : public UEnhancedInputComponent
 {
 	GENERATED_BODY()
-	
+
+public:
+
+	// Routes the input action to the spec. Binds the action if nothing has used it yet.
+	void AddAbilityInput(const UInputAction* inputAction, FGameplayAbilitySpecHandle handle, USMAbilitySystemComponent* abilitySystem);
+
+	void RemoveAbilityInput(FGameplayAbilitySpecHandle handle);
+
+	// Forgets every routed spec. Actions stay bound, they just don't do anything until a spec uses them again.
+	void ClearAbilityInputs();
+
+protected:
+
+	// Binds Started to pressed and Completed/Canceled to released, unless the action is already bound.
+	void BindAbilityInputAction(const UInputAction* inputAction);
+
+	void OnAbilityInputPressed(const UInputAction* inputAction);
+	void OnAbilityInputReleased(const UInputAction* inputAction);
+
+private:
+
+	// Specs of AbilitySystem each action is routed to.
+	TMultiMap<TObjectKey<UInputAction>, FGameplayAbilitySpecHandle> ActionToSpecs;
+
+	// The other way around, so removing a spec doesn't have to search.
+	TMap<FGameplayAbilitySpecHandle, TObjectKey<UInputAction>> SpecToAction;
+
+	// Actions that are already bound to OnAbilityInputPressed/Released.
+	TSet<TObjectKey<UInputAction>> BoundActions;
+
+	TWeakObjectPtr<USMAbilitySystemComponent> AbilitySystem;
 };
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Class.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/UObjectGlobals.h"
+
+struct FRichCurve;
+
+/**
+ * A float curve baked down to evenly spaced samples. Evaluating is a clamp, one multiply and a lerp between two
+ * neighbouring samples, instead of FRichCurve's key search and cubic interpolation. Outside of the baked range the
+ * first/last sample is returned, same as a curve with constant extrapolation.
+ */
+struct FSMBakedCurve
+{
+	static constexpr int32 SampleCount = 128;
+
+	// Bakes the curve across its own key range.
+	void Bake(const FRichCurve& curve);
+
+	// Bakes the curve across [minTime, maxTime].
+	void Bake(const FRichCurve& curve, float minTime, float maxTime);
+
+	FORCEINLINE float Eval(float time) const
+	{
+		const float sample = FMath::Clamp((time - MinTime) * InvSampleSpacing, 0.0f, static_cast<float>(SampleCount - 1));
+		const int32 sampleIdx = FMath::Min(static_cast<int32>(sample), SampleCount - 2);
+		return FMath::Lerp(Samples[sampleIdx], Samples[sampleIdx + 1], sample - static_cast<float>(sampleIdx));
+	}
+
+	// The curve returns its first sample for every time up to this one. Flat curves return it everywhere.
+	float GetFlatBelow() const { return InvSampleSpacing > 0.0f ? MinTime : MAX_flt; }
+
+private:
+
+	float MinTime = 0.0f;
+	float InvSampleSpacing = 0.0f;
+	float Samples[SampleCount] = {};
+};
+
+/**
+ * Baked curves shared between everything that bakes from the same source object (a class, a curve asset etc), so each
+ * gun class only bakes once. Game thread only. In editor builds an entry is thrown away when its source (or the class
+ * default object of a source class or one of its parents) or its dependency is edited, so curve tweaks show up without
+ * restarting.
+ */
+template<typename BakedType>
+class TSMBakedCurveCache
+{
+public:
+
+#if WITH_EDITOR
+	TSMBakedCurveCache()
+	{
+		PropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddRaw(this, &TSMBakedCurveCache::OnObjectPropertyChanged);
+	}
+
+	~TSMBakedCurveCache()
+	{
+		FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(PropertyChangedHandle);
+	}
+#endif
+
+	// dependency is an extra object the bake reads from that isn't the source, like a curve asset the class defaults point to.
+	template<typename BakeFuncType>
+	TSharedRef<const BakedType> FindOrBake(const UObject* source, BakeFuncType&& bakeFunc, const UObject* dependency = nullptr)
+	{
+		check(IsInGameThread());
+
+		if (const FEntry* entry = Entries.Find(source))
+		{
+			return entry->Baked;
+		}
+
+		TSharedRef<BakedType> newBaked = MakeShared<BakedType>();
+		bakeFunc(newBaked.Get());
+		Entries.Add(source, FEntry{ newBaked, dependency });
+		return newBaked;
+	}
+
+private:
+
+	struct FEntry
+	{
+		TSharedRef<const BakedType> Baked;
+		TObjectKey<UObject> Dependency;
+	};
+
+#if WITH_EDITOR
+	void OnObjectPropertyChanged(UObject* object, FPropertyChangedEvent& propertyChangedEvent)
+	{
+		if (!object)
+		{
+			return;
+		}
+
+		// Editing class defaults changes what every instance of the class (and its children) bakes from.
+		const UClass* changedClass = object->HasAnyFlags(RF_ClassDefaultObject) ? object->GetClass() : nullptr;
+		const TObjectKey<UObject> changedKey(object);
+		
+		for (typename TMap<TObjectKey<UObject>, FEntry>::TIterator it = Entries.CreateIterator(); it; ++it)
+		{
+			bool bChanged = it.Key() == changedKey || it.Value().Dependency == changedKey;
+			if (!bChanged && changedClass)
+			{
+				const UClass* sourceClass = Cast<UClass>(it.Key().ResolveObjectPtr());
+				bChanged = sourceClass && sourceClass->IsChildOf(changedClass);
+			}
+
+			if (bChanged)
+			{
+				it.RemoveCurrent();
+			}
+		}
+	}
+
+	FDelegateHandle PropertyChangedHandle;
+#endif
+
+	TMap<TObjectKey<UObject>, FEntry> Entries;
+};
@@ -4,12 +4,18 @@
 
 #include "CoreMinimal.h"
 #include "GameplayAbilitySpec.h"
+#include "GameplayEffectTypes.h"
 #include "GameplayTagContainer.h"
+#include "Items/SMBakedCurve.h"
 #include "SMItemBase.h"
 #include "GameFramework/Actor.h"
 #include "SMEquippableBase.generated.h"
 
 class USMGameplayAbility;
+class UGameplayAbility;
+class UGameplayEffect;
+class UAbilitySystemComponent;
+struct FGameplayEffectSpec;
 class ASMPlayerController;
 class ISMFirstPersonInterface;
 
@@ -39,6 +45,13 @@ struct FRecoilSettings
 	float RecoilResetSpeed;
 };
 
+// The X and Y channels of a recoil curve baked over 0-1, the range recoil is sampled in.
+struct FSMBakedRecoilCurve
+{
+	FSMBakedCurve X;
+	FSMBakedCurve Y;
+};
+
 // Cluster of animations that fit all ranges (First Person Arms and Equippable, Third Person Arms and Equippable)
 USTRUCT(BlueprintType)
 struct FEquippableAnimCluster
@@ -80,6 +93,9 @@ public:
 	
 	// ~ASMItemBase interface start
 	virtual void OnPickUp(USMEquippableInventoryComponent* inventory) override;
+	virtual bool CanPickUp() override;
+	virtual ENetDormancy GetDesiredNetDormancy() const override;
+	virtual bool CanBePickedUpBy(USMEquippableInventoryComponent* inventory) const override;
 	// ~ASMItemBase interface end
 
 	// Called when the player tries to equip this equippable.
@@ -197,12 +213,62 @@ public:
 	// Called when we want to hide the equippable. This does not mean that we have been dropped, but rather the player has unequipped this equippable.
 	void DetachFromPawn(bool bFirstPerson, bool bInstant = false);
 
+	/* With persistent equippable abilities (see USMCombatSettings) these only grant the abilities if they haven't been
+	 * yet and cancel them on remove, the abilities stay granted until we leave the inventory. */
 	void AddAbilitiesToOwner();
 	void RemoveAbilitiesFromOwner();
 	void CancelEquippableAbilities();
 
+	// Whether we are the equippable currently in our owner's hands.
+	bool IsEquipped() const;
+
 	// Called when explicitly spawned in from Spawn Actor From Class
 	virtual void OnExplicitlySpawnedIn();
+
+	void SetActorToReceivePostSpawn(AActor* receiver) { ActorToReceivePostSpawn = receiver; }
+
+	/* Damage
+	***********************************************************************************/
+
+public:
+
+	/* Spec every damage application of the ability is copied from, so the source side (BaseDamage, source tags and the
+	 * effect context) is only captured once instead of per hit. One per ability, since the context and captured tags
+	 * come from it. Rebuilt when the effect, level or owner ability system changes, when the owner's BaseDamage changes
+	 * and on every equip. Returns null if it can't be made. */
+	const FGameplayEffectSpec* GetDamageSpecTemplate(const UGameplayAbility* ability, TSubclassOf<UGameplayEffect> effectClass, float level);
+
+	// Throws every damage spec template away, the next GetDamageSpecTemplate calls make new ones.
+	void InvalidateDamageSpecTemplates();
+
+private:
+
+	void OnBaseDamageChanged(const FOnAttributeChangeData& changeData);
+
+	TMap<TObjectKey<UGameplayAbility>, FGameplayEffectSpecHandle> DamageSpecTemplates;
+
+	// Ability system DamageSpecTemplates were captured from, OnBaseDamageChanged is bound on it.
+	TWeakObjectPtr<UAbilitySystemComponent> DamageSpecTemplateSource;
+	FDelegateHandle BaseDamageChangedHandle;
+
+	/* Pooling
+	***********************************************************************************/
+
+public:
+
+	// Called by USMEquippablePoolSubsystem when putting this equippable in the pool. Puts everything back to how it
+	// was when spawned (ammo, ability handles, first pickup etc) and hides it. Override to reset any extra state.
+	virtual void ResetForPool();
+
+	// Called by USMEquippablePoolSubsystem when this equippable is taken back out of the pool. Acts like being spawned in again.
+	void OnAcquiredFromPool(const FTransform& transform, AActor* receiver);
+
+	bool IsInPool() const { return bIsInPool; }
+
+	// Seconds a dropped equippable (including everything dropped when its owner dies) can lie in the world before it goes
+	// back in the equippable pool. 0 keeps it in the world until someone picks it up.
+	UPROPERTY(EditDefaultsOnly, Category = "Equippable|Pooling", meta=(ClampMin="0"))
+	float DroppedLifeSpan = 0.f;
 	
 	ISMFirstPersonInterface* GetOwnerFirstPersonInterface() const { return OwnerFirstPersonInterface; }
 
@@ -210,6 +276,10 @@ private:
 
 	void OnUnEquipAnimationFinished(bool bFirstPerson);
 	void OnEquippableReadyToFire() const;
+	void OnDroppedLifeSpanExpired();
+
+	void GiveAbilitiesToOwner(USMAbilitySystemComponent* ASC);
+	void ClearAbilitiesFromOwner(USMAbilitySystemComponent* ASC);
 	
 	UPROPERTY(BlueprintReadOnly, Category = "Equippable", meta=(AllowPrivateAccess=true))
 	TArray<FGameplayAbilitySpecHandle> AbilitySpecHandles;
@@ -230,6 +300,9 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Equippable)
 	FRecoilSettings RecoilSettings;
 
+	// RecoilSettings.RecoilCurve baked in PostInitializeComponents, shared with everything using the same curve asset.
+	TSharedPtr<const FSMBakedRecoilCurve> BakedRecoilCurve;
+
 	// Time it takes for the equippable to be ready for use when the equippable starts being equipped.
 	UPROPERTY(EditDefaultsOnly, Category = Equippable)
 	float EquippableReadyTime = 0.0f;
@@ -315,6 +388,12 @@ protected:
 	
 	void OnOwnerUpdated(AActor* NewOwner);
 
+	// Turns the world mesh (visibility, physics, collision) and movement replication on or off.
+	void SetWorldMeshActive(bool bActive);
+
+	// Puts this equippable back in the equippable pool, or destroys it if there isn't one.
+	void ReleaseToPool();
+
 private:
 
 	UPROPERTY(BlueprintReadOnly, Category = Equippable, meta=(AllowPrivateAccess=true, ExposeOnSpawn))
@@ -322,10 +401,14 @@ private:
 	
 	bool bIsBeingInteracted = false;
 
+	// True while sitting unused in the equippable pool.
+	bool bIsInPool = false;
+
 	int32 EquippableInteractionCount;
 	
 	ISMFirstPersonInterface* OwnerFirstPersonInterface = nullptr;
 
 	mutable FTimerHandle UnEquipTimerTimerHandle;
 	mutable FTimerHandle EquipTimerTimerHandle;
+	FTimerHandle DroppedLifeSpanTimerHandle;
 };
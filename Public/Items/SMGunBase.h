@@ -3,9 +3,20 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Items/SMBakedCurve.h"
 #include "Items/SMEquippableBase.h"
 #include "SMGunBase.generated.h"
 
+// The heat curves of a gun class, baked so the per shot/cooldown math doesn't evaluate rich curves.
+struct FSMGunBakedCurves
+{
+	FSMBakedCurve HeatToSpread;
+	FSMBakedCurve HeatToCooldownPerSecond;
+	FSMBakedCurve HeatToHeatPerShot;
+	FSMBakedCurve RecoilHeatToCooldownPerSecond;
+	FSMBakedCurve RecoilHeatToHeatPerShot;
+};
+
 /**
  * 
  */
@@ -15,14 +26,20 @@ class ASMGunBase : public ASMEquippableBase
 	GENERATED_BODY()
 
 public:
-	ASMGunBase();
-	
-	virtual void Tick(float DeltaSeconds) override;
+
+	// ~Start of AActor Interface
+	virtual void PostInitializeComponents() override;
+	virtual void BeginPlay() override;
+	// ~End of AActor Interface
 
 	// ~Start of ASMItemBase Interface 
 	virtual void OnPickUp(USMEquippableInventoryComponent* inventory) override;
 	// ~End of ASMItemBase Interface 
 
+	// ~Start of ASMEquippableBase Interface
+	virtual void ResetForPool() override;
+	// ~End of ASMEquippableBase Interface
+
 protected:
 
 	/* Empty Reloads
@@ -43,10 +60,18 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Equippable|Gun Spread", meta=(ClampMin=0.0f, ClampMax=1.0f))
 	float AimSpreadMultiplier = 0.25f;
 	
-	float CurrentHeat = 0.0f;
-	float CurrentRecoilHeat = 0.0f;
+	// Heat values are only brought up to date when read (see UpdateHeat), so the gun never has to tick. Mutable so const getters can do that.
+	mutable float CurrentHeat = 0.0f;
+	mutable float CurrentRecoilHeat = 0.0f;
     
-	float CurrentSpreadAngle = 0.0f;
+	mutable float CurrentSpreadAngle = 0.0f;
+
+	// World time the heat values above were last brought up to date.
+	mutable float LastHeatUpdateTime = 0.0f;
+
+	// Cached from ComputeHeatRange in PostInitializeComponents.
+	float MinHeatRange = 0.0f;
+	float MaxHeatRange = 0.0f;
 
 	/* Curves
 	***********************************************************************************/
@@ -54,7 +79,7 @@ protected:
 	// A curve that maps the heat to the spread angle
 	// The X range of this curve typically sets the min/max heat range of the weapon
 	// The Y range of this curve is used to define the min and maximum spread angle
-	UPROPERTY(EditAnywhere, Category = "Equippable|Gun Spread")
+	UPROPERTY(EditDefaultsOnly, Category = "Equippable|Gun Spread")
 	FRuntimeFloatCurve HeatToSpreadCurve;
 	
 	// A curve that maps the current heat to the heat cooldown rate per second
@@ -83,6 +108,9 @@ protected:
 	// but can be other shapes to do things like punish overheating by adding progressively more heat.
 	UPROPERTY(EditDefaultsOnly, Category = "Equippable|Recoil")
 	FRuntimeFloatCurve RecoilHeatToHeatPerShotCurve;
+
+	// The curves above baked once per class, set in PostInitializeComponents. Everything at runtime reads these.
+	TSharedPtr<const FSMGunBakedCurves> BakedCurves;
 	
 	/* Spread and Heat
 	***********************************************************************************/
@@ -91,13 +119,24 @@ protected:
 	
 	void ComputeHeatRange(float& MinHeat, float& MaxHeat);
 
-	void UpdateSpread(float deltaSeconds);
+	// Cools heat and recoil heat down from LastHeatUpdateTime to now (see CoolDownHeat).
+	void UpdateHeat() const;
 
 	virtual float GetRecoilHeatMultiplier() override { return GetCurrentRecoilHeat(); };
 
 public:
 
-	FORCEINLINE float GetCurrentRecoilHeat() const { return CurrentRecoilHeat; }
+	/* Cools heat and recoil heat down over elapsedSeconds, the same explicit Euler update the old per-frame tick did.
+	 * Runs in fixed HeatUpdateStep sized steps while a cooldown rate still depends on the heat, and solves the rest in
+	 * one go once both rates are constant (below the cooldown curves' first key, or flat). Heat is clamped to
+	 * [minHeat, maxHeat] like the tick did, recoil heat isn't clamped while cooling. */
+	static void CoolDownHeat(const FSMGunBakedCurves& curves, float minHeat, float maxHeat, float elapsedSeconds, float& heat, float& recoilHeat);
+
+	float GetCurrentRecoilHeat() const
+	{
+		UpdateHeat();
+		return CurrentRecoilHeat;
+	}
 	
 	/* Other (uncategorized)
 	***********************************************************************************/
@@ -128,9 +167,16 @@ public:
 	/** Returns the current spread angle (in degrees, diametrical) */
 	float GetCalculatedSpreadAngle() const
 	{
+		UpdateHeat();
 		return CurrentSpreadAngle;
 	}
 	
+	/** Returns the spread angle at the lowest heat, the tightest this gun can ever shoot */
+	float GetMinSpreadAngle() const
+	{
+		return BakedCurves->HeatToSpread.Eval(MinHeatRange);
+	}
+	
 	float GetMaxDamageRange() const
 	{
 		// @TODO: expose
@@ -139,12 +185,8 @@ public:
 
 private:
 
-	inline float ClampHeat(float NewHeat)
+	inline float ClampHeat(float NewHeat) const
 	{
-		float MinHeat;
-		float MaxHeat;
-		ComputeHeatRange(/*out*/ MinHeat, /*out*/ MaxHeat);
-
-		return FMath::Clamp(NewHeat, MinHeat, MaxHeat);
+		return FMath::Clamp(NewHeat, MinHeatRange, MaxHeatRange);
 	}
 };
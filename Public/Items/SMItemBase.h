@@ -16,7 +16,11 @@ class ASMItemBase : public AActor
 public:	
 	ASMItemBase();
 
-	virtual void NotifyActorBeginOverlap(AActor* OtherActor) override;
+	// ~AActor interface begin
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void SetOwner(AActor* NewOwner) override;
+	// ~AActor interface end
 
 	/* Components
 	***********************************************************************************/
@@ -27,17 +31,14 @@ protected:
 	UPROPERTY(VisibleDefaultsOnly, Category = Item)
 	UStaticMeshComponent* WorldMeshComponent;
 
-	// The collision sphere that detects actors that have an inventory component.
+	// Only used for its radius, which is how close an actor with an inventory needs to be to pick this item up. Has no
+	// collision, USMPickupSubsystem does the actual proximity checks.
 	UPROPERTY(VisibleDefaultsOnly, Category = Item)
 	USphereComponent* SphereCollisionComponent;
 	
 	/* Item Functions
 	***********************************************************************************/
 
-protected:
-
-	virtual void PickUpTick();
-	
 public:
 	
 	// Called when an actor with an inventory attempts to "pick up" this item.
@@ -46,6 +47,36 @@ public:
 	// Called when an actor with an inventory component tries to pick up this item.
 	virtual bool CanPickUp();
 
+	// Cheap check done by the pickup subsystem before OnPickUp, so we don't call OnPickUp every frame for inventories that can't take this item.
+	virtual bool CanBePickedUpBy(USMEquippableInventoryComponent* inventory) const { return inventory != nullptr; }
+
+	// Returns if this item can be picked up and the re-pickup delay has passed.
+	bool IsReadyForPickUp(float worldTime) { return worldTime >= DropTime && CanPickUp(); }
+
+	// How close an inventory owner needs to be to pick this item up.
+	float GetPickUpRadius() const { return SphereCollisionComponent->GetScaledSphereRadius(); }
+
+	/* Replication Policy
+	***********************************************************************************/
+
+public:
+
+	// Applies GetDesiredNetDormancy. Server only, call whenever something GetDesiredNetDormancy depends on changes.
+	void RefreshNetDormancy();
+
+protected:
+
+	// Dropped items replicate movement until their physics goes to sleep, then go dormant until something wakes them.
+	virtual ENetDormancy GetDesiredNetDormancy() const;
+
+	UFUNCTION()
+	void OnWorldMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName);
+
+	UFUNCTION()
+	void OnWorldMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName);
+
+public:
+
 	// Sets the last time in world seconds when this item was dropped.
 	void SetDropTime(float dropTime);
 
@@ -79,6 +110,7 @@ private:
 
 	float DropTime = 0.0f;
 
-	FTimerHandle PickupTickTimerHandle;
+	// True while the world mesh rigid body is asleep. Server only.
+	bool bWorldMeshAsleep = false;
 	
 };
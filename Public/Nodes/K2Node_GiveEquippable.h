@@ -23,6 +23,17 @@ class SPAWNMASTER_API UK2Node_GiveEquippable : public UK2Node_ConstructObjectFro
 
 	//~ Begin UK2Node Interface
 	virtual void GetMenuActions(FBlueprintActionDatabaseRegistrar& ActionRegistrar) const override;
-	//virtual void ExpandNode(class FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph) override;
+	virtual void ExpandNode(class FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph) override;
 	//~ End UK2Node Interface
+
+protected:
+	
+	//~ Begin UK2Node_ConstructObjectFromClass Interface
+	virtual UClass* GetClassPinBaseClass() const override;
+	virtual bool UseWorldContext() const override { return false; }
+	// Expose On Spawn pins aren't supported, GiveNewEquippable may hand back an equippable from the pool that has already been spawned.
+	virtual void CreatePinsForClass(UClass* InClass, TArray<UEdGraphPin*>* OutClassPins = nullptr) override {}
+	//~ End UK2Node_ConstructObjectFromClass Interface
+
+	UEdGraphPin* GetReceiverPin() const;
 };
@@ -18,6 +18,7 @@ class USMEquippableInventoryComponent;
 class USMPawnComponent;
 class USMHealthComponent;
 class USMAbilitySystemComponent;
+class USMHitboxSet;
 
 USTRUCT(BlueprintType)
 struct FAbilityClassWithLevel
@@ -94,9 +95,19 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Character")
 	TSubclassOf<UAnimInstance> UnarmedAnimationBlueprint;
 
+	// Capsules bullets hit instead of the mesh. The mesh ignores the bullet channel when this is set.
+	UPROPERTY(EditDefaultsOnly, Category = "Character")
+	USMHitboxSet* HitboxSet = nullptr;
+
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Character")
 	bool GetIsSprinting() const { return bIsSprinting; }
 
+public:
+
+	const USMHitboxSet* GetHitboxSet() const { return HitboxSet; }
+
+protected:
+
 #pragma endregion BlueprintExposed
 	
 	
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "GameplayTagContainer.h"
+#include "SMCombatSettings.generated.h"
+
+class UPhysicalMaterial;
+
+// A team, and the teams it won't fight.
+USTRUCT()
+struct FSMTeamDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Team", meta=(Categories="Team"))
+	FGameplayTag Team;
+
+	// Teams that are friendly to this one. Works both ways, so only one of the two teams needs to list the other.
+	UPROPERTY(EditAnywhere, Category = "Team", meta=(Categories="Team"))
+	FGameplayTagContainer Allies;
+};
+
+/**
+ * Project wide combat settings, found under Project Settings -> Game -> SpawnMaster Combat.
+ */
+UCLASS(Config=Game, DefaultConfig, meta=(DisplayName="SpawnMaster Combat"))
+class USMCombatSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the index hits on this physical material are sent over the network as. 0 means not in the table.
+	uint8 GetPhysicalMaterialIndex(const UPhysicalMaterial* physicalMaterial) const;
+
+	UPhysicalMaterial* GetPhysicalMaterialFromIndex(uint8 physicalMaterialIndex) const;
+
+	const TArray<FSMTeamDefinition>& GetTeams() const { return Teams; }
+
+	bool UsePersistentEquippableAbilities() const { return bPersistentEquippableAbilities; }
+
+protected:
+
+	/* Physical materials bullet hits can report. Hits only send an index into this list, so it must be the same on
+	 * clients and server, and materials only need to be in here if something (damage, impact effects) cares about them. */
+	UPROPERTY(Config, EditAnywhere, Category = "Networking", meta=(MaxLength=255))
+	TArray<TSoftObjectPtr<UPhysicalMaterial>> ReplicatedPhysicalMaterials;
+
+	/* Teams are hostile to every other team unless they are allies in here, and friendly to themselves. Only teams that
+	 * have allies need to be listed, any other team tag works without being in here. See USMTeamSubsystem. */
+	UPROPERTY(Config, EditAnywhere, Category = "Teams")
+	TArray<FSMTeamDefinition> Teams;
+
+	/* Grant the abilities of every equippable in an inventory once, when it's picked up, instead of giving and clearing
+	 * them on every equip. Abilities of equippables that aren't equipped just can't activate. Saves replicating ability
+	 * specs and rebinding their input on every weapon swap, at the cost of more specs per character. */
+	UPROPERTY(Config, EditAnywhere, Category = "Equippables")
+	bool bPersistentEquippableAbilities = false;
+};
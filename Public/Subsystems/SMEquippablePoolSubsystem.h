@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SMEquippablePoolSubsystem.generated.h"
+
+class ASMEquippableBase;
+
+// Equippables of a single class waiting to be reused.
+USTRUCT()
+struct FEquippablePool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<ASMEquippableBase*> PooledEquippables;
+};
+
+/**
+ * Keeps equippables that are no longer needed around so they can be handed out again, instead of spawning and
+ * destroying an actor (and its meshes) every time. Server only, pooled equippables are hidden and dormant.
+ */
+UCLASS()
+class USMEquippablePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static USMEquippablePoolSubsystem* Get(const UWorld* World);
+
+	// ~UWorldSubsystem interface begin
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// ~UWorldSubsystem interface end
+
+	/* Takes an equippable of the given class from the pool, or spawns a new one if the pool is empty. Either way the
+	 * equippable goes through OnExplicitlySpawnedIn, so it will be given to receiver if one is passed in. */
+	UFUNCTION(BlueprintCallable, Category = "Equippable Pool", meta=(DeterminesOutputType="equippableClass"))
+	ASMEquippableBase* AcquireEquippable(TSubclassOf<ASMEquippableBase> equippableClass, const FTransform& transform, AActor* receiver);
+
+	// Resets the equippable and puts it back in the pool. The equippable must not be in an inventory.
+	UFUNCTION(BlueprintCallable, Category = "Equippable Pool")
+	void ReleaseEquippable(ASMEquippableBase* equippable);
+
+protected:
+
+	// The most equippables of a single class we keep around, anything released past this is destroyed.
+	int32 MaxPooledPerClass = 16;
+
+private:
+
+	UPROPERTY()
+	TMap<UClass*, FEquippablePool> Pools;
+};
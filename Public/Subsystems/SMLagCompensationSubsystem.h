@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SMLagCompensationSubsystem.generated.h"
+
+class ACharacter;
+class USkeletalMeshComponent;
+class AController;
+class UPhysicalMaterial;
+class USMHitboxSet;
+struct FCollisionQueryParams;
+
+// A capsule (or sphere when both ends are the same) attached to a bone of a character.
+struct FSMHitboxDef
+{
+	// Bone on the character mesh, INDEX_NONE means the character's collision capsule.
+	int32 BoneIndex = INDEX_NONE;
+
+	// Ends of the capsule relative to the bone.
+	FVector LocalStart = FVector::ZeroVector;
+	FVector LocalEnd = FVector::ZeroVector;
+
+	// Only set for hitboxes from a hitbox set.
+	FGameplayTag HitZone;
+
+	// Index into USMCombatSettings::ReplicatedPhysicalMaterials, 0 for none.
+	uint8 PhysicalMaterialIndex = 0;
+};
+
+// The hitbox ConfirmHit matched a hit to, for scoring the hit without trusting what the client said it hit.
+struct FSMConfirmedHitbox
+{
+	// Mesh BoneIndex is on, null when the hitbox is the character's collision capsule.
+	USkeletalMeshComponent* Mesh = nullptr;
+	int32 BoneIndex = INDEX_NONE;
+
+	// Index into USMCombatSettings::ReplicatedPhysicalMaterials, 0 for none.
+	uint8 PhysicalMaterialIndex = 0;
+
+	// Only set for hitboxes from a hitbox set.
+	FGameplayTag HitZone;
+};
+
+/**
+ * Where the hitboxes of a single character were over the last HistoryFrames recorded frames.
+ *
+ * Stored as structure of arrays so validating a shot can go through 4 hitboxes at once. Each frame is a block of
+ * 6 * NumPaddedHitboxes floats: all start X, all start Y, all start Z, then the same for the ends.
+ */
+struct FSMHitboxHistory
+{
+	TWeakObjectPtr<ACharacter> Character;
+
+	TArray<FSMHitboxDef> Hitboxes;
+
+	// Hitboxes.Num() rounded up to a multiple of 4.
+	int32 NumPaddedHitboxes = 0;
+
+	// Capsule radius of each hitbox, NumPaddedHitboxes long. Doesn't change over time.
+	TArray<float> Radii;
+
+	// HistoryFrames blocks of hitbox positions, used as a ring buffer.
+	TArray<float> Positions;
+
+	// World time each frame was recorded at.
+	TArray<float> FrameTimes;
+
+	// The most recently recorded frame, and how many frames are valid.
+	int32 NewestFrame = INDEX_NONE;
+	int32 NumFrames = 0;
+
+	// Hitboxes came from a hitbox set, so bullets trace them instead of the mesh (see TraceHitboxes).
+	bool bTraceable = false;
+
+	// Reported by hits from TraceHitboxes.
+	TWeakObjectPtr<UPhysicalMaterial> PhysicalMaterial;
+
+	// Sphere around every hitbox of the newest frame, so traces can skip characters they don't come near.
+	FVector BoundsCenter = FVector::ZeroVector;
+	float BoundsRadius = 0.0f;
+
+	const float* GetFrame(int32 frame) const { return Positions.GetData() + frame * 6 * NumPaddedHitboxes; }
+	float* GetFrame(int32 frame) { return Positions.GetData() + frame * 6 * NumPaddedHitboxes; }
+};
+
+/**
+ * Server side lag compensation. Registered characters have their hitboxes (their hitbox set, or the capsules and
+ * spheres of their physics asset) recorded every frame into a fixed size ring buffer, so a hit a client reports can be
+ * checked against where the character actually was on that client's screen, without asking the physics scene.
+ *
+ * Characters with a hitbox set are also registered on clients, because bullets hit their hitboxes (TraceHitboxes)
+ * instead of their mesh everywhere.
+ */
+UCLASS()
+class USMLagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Recorded frames per character. With MinRecordInterval this covers at least half a second.
+	static constexpr int32 HistoryFrames = 32;
+
+	// Hitboxes past this are ignored, so memory per character is bounded.
+	static constexpr int32 MaxHitboxesPerCharacter = 24;
+
+	static USMLagCompensationSubsystem* Get(const UWorld* World);
+
+	// ~UWorldSubsystem interface begin
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// ~UWorldSubsystem interface end
+
+	// ~FTickableGameObject interface begin
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+	// ~FTickableGameObject interface end
+
+	/* Starts recording the character's hitboxes, from the hitbox set if there is one or the physics asset otherwise.
+	 * Characters without a hitbox set are only needed on the server. */
+	void RegisterCharacter(ACharacter* character, const USMHitboxSet* hitboxSet = nullptr);
+
+	void UnregisterCharacter(ACharacter* character);
+
+	/* How far behind the latest replicated state simulated proxies are drawn, from viewer's movement smoothing (everyone
+	 * else uses the same settings). The client sends it with every shot. */
+	static float GetInterpolationDelay(const ACharacter* viewer);
+
+	/* Server time the client controlling shooter saw when it fired: a round trip back (the state reaching the client and
+	 * the shot coming back) plus the interpolation delay it sent, capped at the shooter's own. Never more than
+	 * spawnmaster.LagCompensation.MaxRewind seconds back, however laggy the client is or claims to be. */
+	float GetShotTime(const AController* shooter, float interpolationDelay) const;
+
+	/* Returns whether the segment traceStart -> traceEnd passed through one of hitActor's hitboxes at shotTime, and fills
+	 * outHitbox with the first one it entered. Actors that aren't registered (walls, props etc) can't be checked, they
+	 * always return true and leave outHitbox alone. */
+	bool ConfirmHit(const AActor* hitActor, const FVector& traceStart, const FVector& traceEnd, float shotTime, FSMConfirmedHitbox* outHitbox = nullptr) const;
+
+	/* Traces the segment against the current hitboxes of every character with a hitbox set, with the hitboxes inflated
+	 * by sweepRadius. Fills outHit with the first hitbox entered, its index goes in FHitResult::Item. Only reads, so it
+	 * is safe to call from worker threads while the game thread waits on them. */
+	bool TraceHitboxes(const FVector& traceStart, const FVector& traceEnd, float sweepRadius, const FCollisionQueryParams& params, FHitResult& outHit) const;
+
+	// Hit zone of a hit returned by TraceHitboxes, empty for any other hit. Damage is scored by it instead of the bone.
+	FGameplayTag GetHitZone(const FHitResult& hit) const;
+
+protected:
+
+	// Builds the hitbox list for a character from its hitbox set, or its mesh's physics asset without one.
+	void BuildHitboxes(ACharacter* character, const USMHitboxSet* hitboxSet, FSMHitboxHistory& history) const;
+
+	void RecordFrame(FSMHitboxHistory& history, float worldTime) const;
+
+	// Recording more often than this just shortens how far back we can rewind.
+	float MinRecordInterval = 1.0f / 60.0f;
+
+private:
+
+	// Keys are only used for lookup, the history holds a weak pointer to the character.
+	TMap<const AActor*, FSMHitboxHistory> Histories;
+
+	float LastRecordTime = -1.0f;
+};
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SMMontageReplicationSubsystem.generated.h"
+
+class USMAbilitySystemComponent;
+
+// An ability system that has replicated montages playing, and when its montage positions were last synced.
+struct FSMMontageRepEntry
+{
+	TWeakObjectPtr<USMAbilitySystemComponent> AbilitySystem;
+
+	float LastPositionSyncTime = -1.0f;
+};
+
+// A player that montage positions are synced for.
+struct FSMMontageViewer
+{
+	FVector Location = FVector::ZeroVector;
+
+	// The viewer's own pawn. It plays its montages locally, so it doesn't count as a viewer of itself.
+	const AActor* Pawn = nullptr;
+};
+
+/**
+ * Schedules montage replication for the whole world.
+ *
+ * Starting or stopping a montage wants the avatar to replicate right away, but with lots of pawns firing, reloading
+ * and equipping at once, forcing a net update every time keeps all of them at top priority. Requests are coalesced
+ * here to at most one per actor per frame, with a budget per frame.
+ *
+ * The server also resyncs the positions of playing montages here, less often the further away the closest viewer is,
+ * and not at all past FarDistance or when the pawn isn't relevant to anyone. Those pawns only replicate starts and
+ * stops, montages that stop or finish on their own are checked for every frame no matter the distance. Clients skip position corrections for pawns that far from their own view for the same reason.
+ */
+UCLASS()
+class USMMontageReplicationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static USMMontageReplicationSubsystem* Get(const UWorld* World);
+
+	// ~UWorldSubsystem interface begin
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// ~UWorldSubsystem interface end
+
+	// ~FTickableGameObject interface begin
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+	// ~FTickableGameObject interface end
+
+	// Asks for the actor to be net updated, at most once per frame no matter how often this is called.
+	void RequestNetUpdate(AActor* actor);
+
+	// Server only. Starts syncing the montage positions of the ability system, until it has no montages playing.
+	void RegisterAbilitySystem(USMAbilitySystemComponent* abilitySystem);
+
+	// Whether a local viewer is close enough to location for montage position corrections to be worth it.
+	bool IsWithinPositionSyncRange(const FVector& location) const;
+
+	// Counts towards the montage bandwidth stat.
+	static void AddBytesSent(int32 numBytes);
+
+protected:
+
+	// Where every player is looking from, refreshed each tick.
+	void GatherViewers();
+
+	// Sends montage stops for every registered ability system, and resyncs the montage positions of those that are due.
+	void SyncMontagePositions(float worldTime);
+
+	void FlushNetUpdates();
+
+	void UpdateBandwidthStat(float worldTime);
+
+private:
+
+	TArray<TWeakObjectPtr<AActor>> PendingNetUpdates;
+
+	TMap<TObjectKey<USMAbilitySystemComponent>, FSMMontageRepEntry> AbilitySystems;
+
+	TArray<FSMMontageViewer> Viewers;
+
+	float BandwidthWindowStartTime = -1.0f;
+};
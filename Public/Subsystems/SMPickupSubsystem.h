@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SMPickupSubsystem.generated.h"
+
+class ASMItemBase;
+class USMEquippableInventoryComponent;
+
+/**
+ * Handles picking up dropped items for the whole world, server only.
+ *
+ * Items used to each run their own overlap sphere and pickup timer, which meant every zombie walking over loot
+ * generated overlap events. Instead, dropped items and inventories register here, and once per frame we bucket the
+ * dropped items into a uniform grid and check each inventory that actually has room against the cells around it.
+ */
+UCLASS()
+class USMPickupSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static USMPickupSubsystem* Get(const UWorld* World);
+
+	// ~UWorldSubsystem interface begin
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// ~UWorldSubsystem interface end
+
+	// ~FTickableGameObject interface begin
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool IsTickable() const override;
+	// ~FTickableGameObject interface end
+
+	// Adds an item that is lying in the world and can be picked up.
+	void RegisterItem(ASMItemBase* item);
+
+	// Removes an item, should be called when it gets picked up or destroyed.
+	void UnregisterItem(ASMItemBase* item);
+
+	// Adds an inventory that can pick up items.
+	void RegisterInventory(USMEquippableInventoryComponent* inventory);
+
+	void UnregisterInventory(USMEquippableInventoryComponent* inventory);
+
+protected:
+
+	// Returns the grid cell a location falls in.
+	FIntPoint GetCellForLocation(const FVector& location) const;
+
+	// Puts every item that can currently be picked up in ItemGrid.
+	void BuildItemGrid(float worldTime);
+
+	// Tries to pick up any items close enough to the inventory owner.
+	void PickUpItemsNearInventory(USMEquippableInventoryComponent* inventory);
+
+	// Size of a grid cell in cm. Should be around the size of the largest pickup radius plus a character radius.
+	float CellSize = 256.f;
+
+	// Seconds before an item that was offered to an inventory but stayed in the world is offered again. Same rate the
+	// old per item pickup timer ran at.
+	float PickUpRetryInterval = 0.25f;
+
+private:
+
+	// Items that don't have an owner. Not kept in any order.
+	UPROPERTY()
+	TArray<ASMItemBase*> Items;
+
+	UPROPERTY()
+	TArray<USMEquippableInventoryComponent*> Inventories;
+
+	// Rebuilt each tick. Cell -> items in that cell that can be picked up this frame.
+	TMultiMap<FIntPoint, ASMItemBase*> ItemGrid;
+
+	// Largest pickup radius of any item we have seen, used to know how many cells around an inventory need checking.
+	float MaxItemPickUpRadius = 0.f;
+};
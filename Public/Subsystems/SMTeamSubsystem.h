@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SMTeamSubsystem.generated.h"
+
+// Actors of one team, in no particular order.
+USTRUCT()
+struct FSMTeamMembers
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AActor*> Actors;
+};
+
+/**
+ * Keeps track of which team every actor with a health component is on, for the whole world.
+ *
+ * Team tags are given a dense index the first time they are seen (0 is no team), and the hostility between every pair
+ * of teams is kept as one bitmask per team, so checking two actors is a map lookup each and a bit test instead of
+ * finding both of their health components. Members are also kept per team for bulk queries like the zombie AI
+ * looking for targets.
+ *
+ * Teams are hostile to every other team unless USMCombatSettings makes them allies. Actors without a team are
+ * hostile to everyone, actors that aren't registered (no health component) are hostile to no one.
+ */
+UCLASS()
+class USMTeamSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static USMTeamSubsystem* Get(const UWorld* World);
+
+	// ~UWorldSubsystem interface begin
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// ~UWorldSubsystem interface end
+
+	// Dense index of the team, 0 for no team (or when there are too many teams). Gives new teams an index.
+	uint8 GetTeamIndex(const FGameplayTag& team);
+
+	// Tag of a dense team index, empty for no team.
+	FGameplayTag GetTeamTag(uint8 teamIndex) const;
+
+	// Registers the actor as a member of the team, or moves it over if it was on another one.
+	void SetActorTeam(AActor* actor, const FGameplayTag& team);
+
+	void UnregisterActor(AActor* actor);
+
+	// Team index of the actor, INDEX_NONE if it isn't registered.
+	int32 GetActorTeamIndex(const AActor* actor) const;
+
+	FGameplayTag GetActorTeam(const AActor* actor) const;
+
+	bool AreTeamsHostile(uint8 teamIndexA, uint8 teamIndexB) const { return (HostileMasks[teamIndexA] & (1u << teamIndexB)) != 0; }
+
+	// Whether the two actors should fight. False if either isn't registered.
+	bool AreHostile(const AActor* actorA, const AActor* actorB) const;
+
+	// Every registered pawn hostile to the querier within the radius of the origin. Doesn't clear outPawns.
+	void GetHostilePawnsInRadius(const AActor* querier, const FVector& origin, float radius, TArray<APawn*>& outPawns) const;
+
+	// Teams fit in a 32 bit mask, no team included.
+	static constexpr int32 MaxTeams = 32;
+
+protected:
+
+	// Works out HostileMasks from AllyMasks.
+	void RebuildHostileMasks();
+
+private:
+
+	// Dense index -> team tag, index 0 is no team.
+	TArray<FGameplayTag> TeamTags;
+
+	// Bit N set when the team is allied with team N.
+	TArray<uint32> AllyMasks;
+
+	// Bit N set when the team is hostile to team N.
+	TArray<uint32> HostileMasks;
+
+	// Registered actors, indexed by team.
+	UPROPERTY()
+	TArray<FSMTeamMembers> TeamMembers;
+
+	TMap<TObjectKey<AActor>, uint8> ActorTeamIndices;
+};
@@ -15,11 +15,17 @@ public class SpawnMaster : ModuleRules
 			"GameplayTags", 
 			"GameplayTasks", 
 			"Core", 
-			"CoreUObject", "Engine", "InputCore", "EnhancedInput", "ModularGameplay"
+			"CoreUObject", "Engine", "InputCore", "EnhancedInput", "ModularGameplay", "NetCore", "DeveloperSettings"
 		});
 
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
 
+		// Needed by the custom Blueprint nodes (K2Node_GiveEquippable).
+		if (Target.bBuildEditor)
+		{
+			PrivateDependencyModuleNames.AddRange(new string[] { "UnrealEd", "BlueprintGraph", "KismetCompiler" });
+		}
+
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
 		